@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cstdint>
+#include "rng.h"
+
+enum class GrannyState : uint8_t { PATROL, CHASE, SEARCH };
+
+// Granny agents stored as a structure of arrays: one vector per component,
+// indexed by agent, so the AI streams through contiguous memory and can be
+// split into index ranges across threads
+struct GrannyPool {
+    std::vector<sf::Vector2f> position;
+    std::vector<sf::Vector2f> velocity;
+    std::vector<sf::Vector2f> spawn;
+    std::vector<GrannyState> state;
+    std::vector<float> awareness;
+    std::vector<sf::Vector2f> lastSeenPosition;
+    std::vector<float> searchTimer;
+    std::vector<sf::Vector2f> patrolTarget;
+    std::vector<float> patrolTimer;
+    std::vector<Rng> rng;
+    std::vector<int> room; // Last room the agent was inside, -1 if unknown
+    std::vector<sf::Vector2f> facing; // Unit vector, the way the agent last moved
+    std::vector<uint8_t> seesPlayer; // Latest sight result; refreshed within the perception budget
+    std::vector<uint8_t> caughtPlayer; // Set during the update, consumed afterwards
+
+    size_t size() const { return position.size(); }
+
+    void add(sf::Vector2f spawnPosition, uint32_t seed) {
+        uint32_t index = static_cast<uint32_t>(size());
+        position.push_back(spawnPosition);
+        velocity.push_back(sf::Vector2f(0, 0));
+        spawn.push_back(spawnPosition);
+        state.push_back(GrannyState::PATROL);
+        awareness.push_back(0);
+        lastSeenPosition.push_back(spawnPosition);
+        searchTimer.push_back(0);
+        patrolTarget.push_back(spawnPosition);
+        patrolTimer.push_back(0);
+        rng.push_back(Rng(mixSeed(seed, index)));
+        room.push_back(-1);
+        facing.push_back(sf::Vector2f(1, 0));
+        seesPlayer.push_back(0);
+        caughtPlayer.push_back(0);
+    }
+
+    void clear() {
+        position.clear();
+        velocity.clear();
+        spawn.clear();
+        state.clear();
+        awareness.clear();
+        lastSeenPosition.clear();
+        searchTimer.clear();
+        patrolTarget.clear();
+        patrolTimer.clear();
+        rng.clear();
+        room.clear();
+        facing.clear();
+        seesPlayer.clear();
+        caughtPlayer.clear();
+    }
+
+    // Back to the spawn point with no memory of the player
+    void resetAgent(size_t i) {
+        position[i] = spawn[i];
+        velocity[i] = sf::Vector2f(0, 0);
+        state[i] = GrannyState::PATROL;
+        awareness[i] = 0;
+        lastSeenPosition[i] = spawn[i];
+        searchTimer[i] = 0;
+        patrolTarget[i] = spawn[i];
+        patrolTimer[i] = 0;
+        room[i] = -1;
+        facing[i] = sf::Vector2f(1, 0);
+        seesPlayer[i] = 0;
+        caughtPlayer[i] = 0;
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+
+// Counts every heap allocation the program makes, on any thread, by
+// replacing the global operator new. Include it from one .c file only;
+// the replacements are program-wide definitions. Reading the count is a
+// relaxed atomic load, cheap enough to check around every tick. None of
+// the replacements are inlined, so GCC does not pair a free() with a new
+// and warn.
+namespace AllocCounter {
+inline std::atomic<uint64_t>& counter() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+inline uint64_t count() { return counter().load(std::memory_order_relaxed); }
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    AllocCounter::counter().fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    AllocCounter::counter().fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+[[gnu::noinline]] void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,168 @@
+// Batch runner: plays thousands of independent seeded games headless with
+// bot players, spread over all cores, for balancing Granny. Each episode
+// copies a prepared simulation, so results depend only on the seed and
+// settings, not on the thread count. Prints outcome rates, catches, days
+// survived, time to win and episodes per second per core.
+//
+//   g++ -std=c++17 -O2 -pthread batch_runner.c -o batch_runner
+//   ./batch_runner [--episodes n] [--threads n] [--seed n] [--rate hz]
+//                  [--bot seeker|scripted] [--level file.lvl]
+//                  [--granny-speed v] [--catch-radius v] [--search-time s]
+//                  [--noise-search-time s] [--max-minutes m]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "simulation.h"
+#include "bot_player.h"
+#include "job_system.h"
+#include "level_file.h"
+
+enum class Outcome : uint8_t { WON, CAUGHT, OUT_OF_DAYS, TIMED_OUT };
+
+struct Episode {
+    Outcome outcome;
+    int catches;
+    float daysSurvived;  // Whole days plus the fraction of the last one
+    float seconds;       // Game time played
+    int itemsCollected;
+};
+
+struct Settings {
+    long episodes = 1000;
+    unsigned threads = std::thread::hardware_concurrency();
+    uint32_t seed = 1;
+    long rate = 60;
+    BotPlayer::Kind bot = BotPlayer::SEEKER;
+    float maxMinutes = 30; // Game minutes before an episode is abandoned
+};
+
+Episode play(const Simulation& prototype, const Settings& settings, uint32_t seed) {
+    Simulation sim = prototype;
+    sim.setSeed(seed);
+    sim.reset();
+    BotPlayer bot(settings.bot, mixSeed(seed, 0xb07u));
+
+    float dt = 1.0f / settings.rate;
+    long maxTicks = static_cast<long>(settings.maxMinutes * 60 * settings.rate);
+    Episode episode = {Outcome::TIMED_OUT, 0, 0, 0, 0};
+    long tick = 0;
+    for (; tick < maxTicks && !sim.gameOver && !sim.gameWon; tick++) {
+        sim.step(dt, bot.think(sim, dt));
+        episode.catches += sim.playerWasCaught;
+    }
+
+    if (sim.gameWon) episode.outcome = Outcome::WON;
+    else if (sim.gameOver) episode.outcome = sim.health <= 0 ? Outcome::CAUGHT : Outcome::OUT_OF_DAYS;
+    episode.daysSurvived = (sim.day - 1) + (sim.time - 7.0f) / 17.0f;
+    episode.seconds = tick * dt;
+    for (const auto& item : sim.items) {
+        episode.itemsCollected += item.collected;
+    }
+    return episode;
+}
+
+double mean(const std::vector<float>& values) {
+    double sum = 0;
+    for (float value : values) sum += value;
+    return values.empty() ? 0 : sum / values.size();
+}
+
+float median(std::vector<float> values) {
+    if (values.empty()) return 0;
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    Settings settings;
+    Simulation prototype;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--episodes") == 0 && hasValue) {
+            settings.episodes = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            settings.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            settings.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+            settings.rate = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--bot") == 0 && hasValue) {
+            std::string name = argv[++i];
+            if (name != "seeker" && name != "scripted") {
+                std::cerr << "Unknown bot " << name << "\n";
+                return 1;
+            }
+            settings.bot = name == "seeker" ? BotPlayer::SEEKER : BotPlayer::SCRIPTED;
+        } else if (std::strcmp(argv[i], "--level") == 0 && hasValue) {
+            LevelFile level;
+            if (!level.loadFromFile(argv[++i])) return 1;
+            prototype.loadLevel(level);
+        } else if (std::strcmp(argv[i], "--granny-speed") == 0 && hasValue) {
+            prototype.grannySpeed = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--catch-radius") == 0 && hasValue) {
+            prototype.catchRadius = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--search-time") == 0 && hasValue) {
+            prototype.searchTime = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--noise-search-time") == 0 && hasValue) {
+            prototype.noiseSearchTime = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-minutes") == 0 && hasValue) {
+            settings.maxMinutes = static_cast<float>(std::atof(argv[++i]));
+        } else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    if (settings.episodes <= 0 || settings.rate <= 0 || settings.maxMinutes <= 0) {
+        std::cerr << "episodes, rate and max minutes must be positive\n";
+        return 1;
+    }
+
+    // One episode per job; each writes only its own slot
+    std::vector<Episode> episodes(settings.episodes);
+    JobSystem jobs(settings.threads);
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    jobs.parallelFor(episodes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            episodes[i] = play(prototype, settings, mixSeed(settings.seed, static_cast<uint32_t>(i)));
+        }
+    });
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    long outcomes[4] = {0, 0, 0, 0};
+    long caughtAtLeastOnce = 0;
+    std::vector<float> catches, days, winSeconds, items;
+    for (const auto& episode : episodes) {
+        outcomes[static_cast<int>(episode.outcome)]++;
+        caughtAtLeastOnce += episode.catches > 0;
+        catches.push_back(static_cast<float>(episode.catches));
+        days.push_back(episode.daysSurvived);
+        items.push_back(static_cast<float>(episode.itemsCollected));
+        if (episode.outcome == Outcome::WON) winSeconds.push_back(episode.seconds);
+    }
+
+    double count = static_cast<double>(episodes.size());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "episodes:           " << episodes.size() << " (" << (settings.bot == BotPlayer::SEEKER ? "seeker" : "scripted")
+              << " bot, " << settings.rate << " Hz, granny speed " << prototype.grannySpeed << ", catch radius "
+              << prototype.catchRadius << ", search " << prototype.searchTime << "/" << prototype.noiseSearchTime << " s)\n";
+    std::cout << "won:                " << outcomes[0] / count << "\n";
+    std::cout << "caught out:         " << outcomes[1] / count << "\n";
+    std::cout << "out of days:        " << outcomes[2] / count << "\n";
+    std::cout << "timed out:          " << outcomes[3] / count << "\n";
+    std::cout << "catch rate:         " << caughtAtLeastOnce / count << " (" << mean(catches) << " catches/episode)\n";
+    std::cout << "days survived:      " << mean(days) << " mean\n";
+    std::cout << "items collected:    " << mean(items) << " mean\n";
+    std::cout << "time to win (s):    " << mean(winSeconds) << " mean, " << median(winSeconds) << " median\n";
+    std::cout << std::setprecision(1);
+    std::cout << "threads:            " << jobs.threadCount() << "\n";
+    std::cout << "episodes/sec:       " << count / elapsed << "\n";
+    std::cout << "episodes/sec/core:  " << count / elapsed / jobs.threadCount() << "\n";
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Granny AI scaling benchmark: steps the simulation with 1, 100 and 10,000
+// agents (or the counts given), serially and on the job system, and reports
+// time per tick and per agent update.
+//
+//   g++ -std=c++17 -O2 -pthread bench_agents.c -o bench_agents
+//   ./bench_agents [threads] [agents...]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "simulation.h"
+
+// Mean seconds per tick over enough ticks to cover ~2M agent updates
+double secondsPerTick(size_t agents, JobSystem* jobs) {
+    Simulation sim;
+    sim.jobs = jobs;
+    sim.grannies.clear();
+    Rng rng(777);
+    for (size_t i = 0; i < agents; i++) {
+        sim.addGranny(sf::Vector2f(static_cast<float>(rng.nextInt(1100) + 50),
+                                   static_cast<float>(rng.nextInt(700) + 50)));
+    }
+
+    long ticks = std::max<long>(60, static_cast<long>(2000000 / agents));
+    PlayerInput idle;
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    for (long tick = 0; tick < ticks; tick++) {
+        sim.step(Simulation::fixedDt, idle);
+        if (sim.gameOver || sim.gameWon) {
+            sim.reset();
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count() / ticks;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    std::vector<size_t> counts;
+    for (int i = 2; i < argc; i++) {
+        counts.push_back(static_cast<size_t>(std::atol(argv[i])));
+    }
+    if (counts.empty()) {
+        counts = {1, 100, 10000};
+    }
+
+    JobSystem jobs(threads);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "threads: " << jobs.threadCount() << "\n";
+    std::cout << std::setw(8) << "agents" << std::setw(16) << "serial ms/tick" << std::setw(16) << "jobs ms/tick"
+              << std::setw(16) << "jobs ns/agent" << std::setw(10) << "speedup" << "\n";
+    for (size_t count : counts) {
+        if (count == 0) continue;
+        double serial = secondsPerTick(count, nullptr);
+        double parallel = secondsPerTick(count, &jobs);
+        std::cout << std::setw(8) << count << std::setw(16) << serial * 1e3 << std::setw(16) << parallel * 1e3
+                  << std::setw(16) << parallel * 1e9 / count << std::setw(10) << serial / parallel << "\n";
+    }
+    return 0;
+}
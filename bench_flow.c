@@ -0,0 +1,89 @@
+// Flow field benchmark: full rebuild cost on square grids of increasing
+// size, how many ticks a time-sliced rebuild takes, and per-agent sampling
+// cost. Use it to pick a cell size for a given map.
+//
+//   g++ -std=c++17 -O2 bench_flow.c -o bench_flow
+//   ./bench_flow [budget cells per tick]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "flow_field.h"
+#include "rng.h"
+
+// Rooms of createRoom()-style walls, each with a gap in its right and
+// bottom wall so the whole grid is connected
+std::vector<sf::FloatRect> makeWalls(float extent) {
+    std::vector<sf::FloatRect> walls;
+    for (float y = 0; y < extent; y += 300) {
+        for (float x = 0; x < extent; x += 300) {
+            walls.push_back(sf::FloatRect(x, y, 300, 20));
+            walls.push_back(sf::FloatRect(x, y, 20, 300));
+            walls.push_back(sf::FloatRect(x + 280, y, 20, 120));
+            walls.push_back(sf::FloatRect(x + 280, y + 180, 20, 120));
+            walls.push_back(sf::FloatRect(x, y + 280, 120, 20));
+            walls.push_back(sf::FloatRect(x + 180, y + 280, 120, 20));
+        }
+    }
+    return walls;
+}
+
+int main(int argc, char** argv) {
+    size_t budget = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 4096;
+    const float cellSize = 20.0f;
+    using Clock = std::chrono::steady_clock;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::setw(10) << "grid" << std::setw(12) << "cells" << std::setw(14) << "rebuild ms"
+              << std::setw(14) << "ns/cell" << std::setw(16) << "sliced ticks" << std::setw(14) << "sample ns" << "\n";
+    for (int side : {64, 128, 256, 512, 1024, 2048}) {
+        float extent = side * cellSize;
+        FlowField field;
+        field.build(makeWalls(extent), sf::FloatRect(0, 0, extent, extent), cellSize);
+
+        // Full rebuilds towards the centres of different rooms
+        Rng rng(99);
+        int rooms = static_cast<int>(extent / 300);
+        int rebuilds = side <= 256 ? 20 : 4;
+        double seconds = 0;
+        for (int r = 0; r < rebuilds; r++) {
+            sf::Vector2f target(150 + 300.0f * (r % rooms), 150 + 300.0f * ((r / rooms) % rooms));
+            field.setTarget(target + sf::Vector2f(static_cast<float>(r % 2) * cellSize, 0));
+            Clock::time_point start = Clock::now();
+            field.update();
+            seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        double rebuildMs = seconds / rebuilds * 1e3;
+
+        // Same rebuild spread over ticks
+        field.setTarget(sf::Vector2f(extent / 2 + 1, extent / 2 + 1));
+        int ticks = 0;
+        while (field.rebuilding()) {
+            field.update(budget);
+            ticks++;
+        }
+
+        // Per-agent O(1) lookups
+        const int samples = 1000000;
+        std::vector<sf::Vector2f> positions(1024);
+        for (auto& p : positions) {
+            p = sf::Vector2f(static_cast<float>(rng.nextInt(static_cast<int>(extent))),
+                             static_cast<float>(rng.nextInt(static_cast<int>(extent))));
+        }
+        volatile float sum = 0; // Keeps the lookups from being optimized away
+        Clock::time_point start = Clock::now();
+        for (int s = 0; s < samples; s++) {
+            sf::Vector2f d = field.direction(positions[s & 1023]);
+            sum = sum + d.x + d.y;
+        }
+        double sampleNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+
+        std::cout << std::setw(6) << side << "^2  " << std::setw(12) << field.cellCount() << std::setw(14) << rebuildMs
+                  << std::setw(14) << rebuildMs * 1e6 / field.cellCount() << std::setw(16) << ticks
+                  << std::setw(14) << sampleNs << "\n";
+    }
+    std::cout << "slice budget: " << budget << " cells per tick\n";
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Level load benchmark: maps a compiled level and reports the time to
+// open it, copy it into the simulation and build the search structures
+// (wall grid, navigation graph, flow field). With --builtin it also
+// fails unless the level is exactly the house the game builds without
+// one, so levels/house.txt cannot drift from createMap().
+//
+//   g++ -std=c++17 -O2 -pthread bench_level.c -o bench_level
+//   ./level_compiler --grid 10000 big.lvl
+//   ./bench_level big.lvl
+//   ./level_compiler levels/house.txt house.lvl
+//   ./bench_level house.lvl --builtin
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include "simulation.h"
+#include "level_file.h"
+
+// Names the first part of the loaded map that differs from the built-in
+// one, or returns null when they are the same
+const char* builtinDifference(const Simulation& loaded) {
+    Simulation builtin;
+    if (loaded.worldBounds != builtin.worldBounds) return "world";
+    if (loaded.playerSpawn != builtin.playerSpawn) return "player";
+    if (loaded.exitArea != builtin.exitArea) return "exit";
+    if (loaded.rooms != builtin.rooms) return "rooms";
+    if (loaded.walls != builtin.walls) return "walls";
+    if (loaded.doors != builtin.doors) return "doors";
+    if (loaded.hidingSpots != builtin.hidingSpots) return "closets";
+    if (loaded.items.size() != builtin.items.size()) return "items";
+    for (size_t i = 0; i < loaded.items.size(); i++) {
+        if (loaded.items[i].type != builtin.items[i].type || loaded.items[i].bounds != builtin.items[i].bounds) {
+            return "items";
+        }
+    }
+    if (loaded.grannies.spawn != builtin.grannies.spawn) return "grannies";
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    bool builtin = argc == 3 && std::strcmp(argv[2], "--builtin") == 0;
+    if (argc != 2 && !builtin) {
+        std::cerr << "usage: " << argv[0] << " level.lvl [--builtin]\n";
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    Simulation sim;
+    Clock::time_point start = Clock::now();
+    LevelFile level;
+    if (!level.loadFromFile(argv[1])) return 1;
+    Clock::time_point opened = Clock::now();
+
+    // loadLevel() split into its copy and index phases, to time each
+    const LevelHeader& header = level.header();
+    sim.rooms.assign(level.rooms(), level.rooms() + header.roomCount);
+    sim.walls.assign(level.walls(), level.walls() + header.wallCount);
+    sim.doors.assign(level.doors(), level.doors() + header.doorCount);
+    sim.hidingSpots.assign(level.hidingSpots(), level.hidingSpots() + header.hidingSpotCount);
+    Clock::time_point copied = Clock::now();
+
+    sim.loadLevel(level);
+    Clock::time_point loaded = Clock::now();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << argv[1] << ": " << header.roomCount << " rooms, " << header.wallCount << " walls, "
+              << header.doorCount << " doors, " << sim.navGraph.doorCount() << " linked, "
+              << sim.flowField.cellCount() << " flow cells\n";
+    std::cout << "open + validate  " << std::setw(10) << ms(opened - start) << " ms\n";
+    std::cout << "copy geometry    " << std::setw(10) << ms(copied - opened) << " ms\n";
+    std::cout << "loadLevel total  " << std::setw(10) << ms(loaded - copied) << " ms\n";
+    if (builtin) {
+        const char* difference = builtinDifference(sim);
+        if (difference) {
+            std::cout << "differs from the built-in house: " << difference << "\n";
+            return 1;
+        }
+        std::cout << "same as the built-in house\n";
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Navigation benchmark: builds a grid house with the given number of rooms
+// and reports uncached A* latency and cached route lookups.
+//
+//   g++ -std=c++17 -O2 -pthread bench_nav.c -o bench_nav
+//   ./bench_nav [rooms] [queries]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+#include <cmath>
+#include "nav_graph.h"
+#include "rng.h"
+#include "bench_util.h"
+
+// Rooms on a square grid, 300 px rooms with 50 px gaps; a random spanning
+// tree of doors keeps every room reachable and extra doors add loops
+void makeHouse(int roomCount, Rng& rng, std::vector<sf::FloatRect>& rooms, std::vector<sf::FloatRect>& doors) {
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(roomCount))));
+    for (int i = 0; i < roomCount; i++) {
+        rooms.push_back(sf::FloatRect((i % columns) * 350.0f, (i / columns) * 350.0f, 300, 300));
+    }
+
+    std::vector<int> parent(roomCount);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto root = [&](int r) {
+        while (parent[r] != r) r = parent[r] = parent[parent[r]];
+        return r;
+    };
+
+    std::vector<std::pair<int, int>> neighbours;
+    for (int i = 0; i < roomCount; i++) {
+        if (i % columns + 1 < columns && i + 1 < roomCount) neighbours.push_back({i, i + 1});
+        if (i + columns < roomCount) neighbours.push_back({i, i + columns});
+    }
+    for (size_t i = neighbours.size(); i > 1; i--) {
+        std::swap(neighbours[i - 1], neighbours[rng.nextInt(static_cast<int>(i))]);
+    }
+    for (const auto& pair : neighbours) {
+        bool joinsTrees = root(pair.first) != root(pair.second);
+        if (!joinsTrees && rng.nextInt(100) >= 30) continue;
+        parent[root(pair.first)] = root(pair.second);
+
+        const sf::FloatRect& a = rooms[pair.first];
+        if (pair.second == pair.first + 1) {
+            doors.push_back(sf::FloatRect(a.left + a.width + 15, a.top + 120, 20, 60));
+        } else {
+            doors.push_back(sf::FloatRect(a.left + 120, a.top + a.height + 15, 60, 20));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int roomCount = argc > 1 ? std::atoi(argv[1]) : 400;
+    int queries = argc > 2 ? std::atoi(argv[2]) : 20000;
+    if (roomCount < 2 || queries <= 0) {
+        std::cerr << "usage: " << argv[0] << " [rooms >= 2] [queries]\n";
+        return 1;
+    }
+
+    Rng rng(4242);
+    std::vector<sf::FloatRect> rooms, doors;
+    makeHouse(roomCount, rng, rooms, doors);
+    NavGraph graph;
+    graph.build(rooms, doors);
+
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (auto& pair : pairs) {
+        pair.first = rng.nextInt(roomCount);
+        pair.second = rng.nextInt(roomCount);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> astar, cached;
+    std::vector<int> path;
+    size_t totalLength = 0;
+    for (const auto& pair : pairs) {
+        Clock::time_point start = Clock::now();
+        graph.findPath(pair.first, pair.second, path);
+        astar.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        totalLength += path.size();
+    }
+
+    // Warm the cache, then time the lookups agents do every tick
+    for (const auto& pair : pairs) {
+        graph.nextDoor(pair.first, pair.second);
+    }
+    int routed = 0;
+    for (const auto& pair : pairs) {
+        Clock::time_point start = Clock::now();
+        routed += graph.nextDoor(pair.first, pair.second) >= 0;
+        cached.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    std::sort(astar.begin(), astar.end());
+    std::sort(cached.begin(), cached.end());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << roomCount << " rooms, " << graph.doorCount() << " doors, " << queries << " queries, "
+              << "mean path " << static_cast<double>(totalLength) / queries << " doors\n";
+    std::cout << std::setw(16) << "" << std::setw(12) << "mean us" << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us" << "\n";
+    std::cout << std::setw(16) << "a* (uncached)" << std::setw(12) << std::accumulate(astar.begin(), astar.end(), 0.0) / queries
+              << std::setw(12) << percentile(astar, 50) << std::setw(12) << percentile(astar, 99) << "\n";
+    std::cout << std::setw(16) << "cached route" << std::setw(12) << std::accumulate(cached.begin(), cached.end(), 0.0) / queries
+              << std::setw(12) << percentile(cached, 50) << std::setw(12) << percentile(cached, 99) << "\n";
+    std::cout << "cached routes: " << graph.cachedRoutes() << " (" << routed << " queries needed a door)\n";
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Co-op network benchmark: runs a server and two to four clients in one
+// process over loopback, in real time at 60 Hz, with the clients wandering
+// at random. NetLink's simulator can drop and delay datagrams in both
+// directions. Reports each client's bandwidth both ways (payload, and with
+// IP and UDP headers), snapshot sizes, round-trip time, how long an input
+// takes to show up in a snapshot, how often prediction was corrected, and
+// how many snapshots went out whole because their base was too old.
+// Fails if a client did not get in, or if any state a client decoded
+// differs from the one the server sent it.
+//
+//   g++ -std=c++17 -O2 -pthread bench_net.c -o bench_net -lsfml-network -lsfml-system
+//   ./bench_net [clients] [seconds] [loss %] [latency ms] [jitter ms] [level.lvl]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <cstdlib>
+#include "simulation.h"
+#include "sim_snapshot.h"
+#include "coop_server.h"
+#include "coop_client.h"
+#include "level_file.h"
+#include "rng.h"
+#include "bench_util.h"
+
+double mean(const std::vector<double>& values) {
+    return values.empty() ? 0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+}
+
+// New buttons every half second or so: a direction, sometimes running.
+// Restarts when the game is over so the run keeps moving.
+PlayerInput wander(Rng& rng, long tick, uint8_t& buttons, const SimSnapshot& view) {
+    if (tick % 30 == 0) {
+        static const uint8_t directions[] = {
+            PlayerInput::UP, PlayerInput::DOWN, PlayerInput::LEFT, PlayerInput::RIGHT,
+            PlayerInput::UP | PlayerInput::LEFT, PlayerInput::UP | PlayerInput::RIGHT,
+            PlayerInput::DOWN | PlayerInput::LEFT, PlayerInput::DOWN | PlayerInput::RIGHT, 0};
+        buttons = directions[rng.nextInt(9)];
+        if (rng.nextInt(4) == 0) buttons |= PlayerInput::RUN;
+    }
+    PlayerInput input;
+    input.buttons = buttons;
+    if (view.gameOver || view.gameWon) input.press(PlayerInput::RESTART);
+    return input;
+}
+
+int main(int argc, char** argv) {
+    int clientCount = argc > 1 ? std::atoi(argv[1]) : 4;
+    float seconds = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 10.0f;
+    NetLink::Conditions conditions;
+    conditions.loss = argc > 3 ? static_cast<float>(std::atof(argv[3])) / 100 : 0;
+    conditions.latency = argc > 4 ? static_cast<float>(std::atof(argv[4])) / 1000 : 0;
+    conditions.jitter = argc > 5 ? static_cast<float>(std::atof(argv[5])) / 1000 : 0;
+    if (clientCount < 1 || clientCount > static_cast<int>(CoopServer::maxClients) || seconds <= 0 ||
+        conditions.loss < 0 || conditions.loss >= 1) {
+        std::cerr << "usage: " << argv[0] << " [clients] [seconds] [loss %] [latency ms] [jitter ms] [level.lvl]\n";
+        return 1;
+    }
+
+    // The server and the clients each load the map, as separate machines would
+    CoopServer server;
+    Simulation world;
+    if (argc > 6) {
+        LevelFile level;
+        if (!level.loadFromFile(argv[6])) return 1;
+        server.sim.loadLevel(level);
+        world.loadLevel(level);
+    }
+    server.link.simulate(conditions, 1);
+    if (!server.start(0)) return 1;
+    unsigned short port = server.link.localPort();
+
+    std::vector<std::unique_ptr<CoopClient>> clients;
+    std::vector<SimSnapshot> views(clientCount);
+    std::vector<Rng> rngs;
+    std::vector<uint8_t> buttons(clientCount);
+    std::vector<uint32_t> checked(clientCount);
+    std::vector<std::vector<double>> rtts(clientCount), confirms(clientCount);
+    for (int c = 0; c < clientCount; c++) {
+        clients.emplace_back(new CoopClient(world));
+        clients[c]->link.simulate(conditions, 2 + c);
+        if (!clients[c]->connect(sf::IpAddress::LocalHost, port)) return 1;
+        rngs.emplace_back(100 + c);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    long frames = static_cast<long>(seconds / Simulation::fixedDt);
+    long mismatches = 0, statesChecked = 0;
+    std::vector<double> serverTimes;
+    serverTimes.reserve(frames);
+    Clock::time_point frameStart = Clock::now();
+    for (long frame = 0; frame < frames; frame++) {
+        Clock::time_point start = Clock::now();
+        server.step();
+        serverTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        for (int c = 0; c < clientCount; c++) {
+            CoopClient& client = *clients[c];
+            const CoopClient::Stats& before = client.getStats();
+            uint64_t rttSamples = before.rttSamples, confirmSamples = before.confirmSamples;
+            client.tick(wander(rngs[c], frame, buttons[c], views[c]));
+            client.capture(views[c]);
+
+            const CoopClient::Stats& stats = client.getStats();
+            if (stats.rttSamples != rttSamples) rtts[c].push_back(stats.rttMs);
+            if (stats.confirmSamples != confirmSamples) confirms[c].push_back(stats.confirmMs);
+
+            // Every newly decoded state must be exactly what was sent
+            uint32_t tick = client.newestReceived();
+            if (tick != checked[c]) {
+                checked[c] = tick;
+                const NetState* got = client.received(tick);
+                const NetState* sent = server.sentState(client.getSlot(), tick);
+                if (got && sent) {
+                    statesChecked++;
+                    mismatches += got->values != sent->values;
+                }
+            }
+        }
+
+        frameStart += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frameStart);
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "clients:   " << clientCount << ", " << seconds << " s, " << server.sim.grannies.size() << " grannies, "
+              << server.sim.items.size() << " items\n";
+    std::cout << "link:      loss " << conditions.loss * 100 << "%, latency " << conditions.latency * 1000 << " ms, jitter "
+              << conditions.jitter * 1000 << " ms (each way)\n";
+    std::cout << "\nclient  down kbps (+hdr)   up kbps (+hdr)   snapshot B  full  rtt ms mean/p99   input->seen ms   corrections\n";
+    bool connected = true;
+    uint64_t fullSnapshots = 0, snapshots = 0;
+    for (int c = 0; c < clientCount; c++) {
+        const CoopClient& client = *clients[c];
+        if (client.getStatus() != CoopClient::Status::PLAYING) {
+            std::cout << std::setw(6) << c << "  not connected\n";
+            connected = false;
+            continue;
+        }
+        const CoopServer::ClientStats& down = server.clientStats(client.getSlot());
+        const NetLink::Stats& up = client.link.getStats();
+        const CoopClient::Stats& stats = client.getStats();
+        fullSnapshots += down.fullSnapshots;
+        snapshots += down.snapshots;
+        auto kbps = [&](uint64_t bytes, uint64_t packets, bool headers) {
+            return (bytes + (headers ? packets * NetLink::headerBytes : 0)) * 8 / seconds / 1000;
+        };
+        std::sort(rtts[c].begin(), rtts[c].end());
+        std::sort(confirms[c].begin(), confirms[c].end());
+        std::cout << std::setw(6) << c << "  " << std::setw(6) << kbps(down.bytesSent, down.packetsSent, false) << " ("
+                  << std::setw(6) << kbps(down.bytesSent, down.packetsSent, true) << ")  " << std::setw(6)
+                  << kbps(up.bytesSent, up.packetsSent, false) << " (" << std::setw(6) << kbps(up.bytesSent, up.packetsSent, true)
+                  << ")  " << std::setw(10) << (down.snapshots ? static_cast<double>(down.bytesSent) / down.snapshots : 0.0)
+                  << "  " << std::setw(4) << down.fullSnapshots << "  " << std::setw(7) << mean(rtts[c]) << " / "
+                  << std::setw(6) << percentile(rtts[c], 99) << "  " << std::setw(7) << mean(confirms[c]) << " / "
+                  << std::setw(6) << percentile(confirms[c], 99) << "  " << std::setw(5) << stats.corrections << " (max "
+                  << stats.correctionMax << " u)\n";
+    }
+    std::cout << "\nfull snapshots: " << fullSnapshots << " of " << snapshots << " (deltas need a round trip under "
+              << maxRoundTripMs << " ms)\n";
+    std::sort(serverTimes.begin(), serverTimes.end());
+    std::cout << "\nserver step (ms): p50 " << std::setprecision(3) << percentile(serverTimes, 50) << "  p99 "
+              << percentile(serverTimes, 99) << "\n";
+    std::cout << "decoded states checked: " << statesChecked << ", mismatches " << mismatches << "\n";
+    return connected && statesChecked > 0 && mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// First-person raycaster benchmark: renders the view from every room,
+// turning, at several resolutions, serially and on the job system, and
+// reports milliseconds and frames per second. It first checks the grid
+// raycast against a brute-force test of every wall and fails on a mismatch.
+//
+//   g++ -std=c++17 -O2 -mavx2 -pthread bench_raycast.c -o bench_raycast
+//   ./bench_raycast [threads] [frames] [level.lvl]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include "simulation.h"
+#include "raycaster.h"
+#include "level_file.h"
+#include "bench_util.h"
+
+// Nearest wall face along the ray by testing every wall
+float bruteForceRay(const std::vector<sf::FloatRect>& walls, sf::Vector2f start, sf::Vector2f direction, float maxT) {
+    float best = maxT;
+    for (const auto& wall : walls) {
+        float t1x = (wall.left - start.x) / direction.x, t2x = (wall.left + wall.width - start.x) / direction.x;
+        float t1y = (wall.top - start.y) / direction.y, t2y = (wall.top + wall.height - start.y) / direction.y;
+        float tNear = std::max(std::min(t1x, t2x), std::min(t1y, t2y));
+        float tFar = std::min(std::max(t1x, t2x), std::max(t1y, t2y));
+        if (tNear >= 0 && tNear <= tFar) best = std::min(best, tNear);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    int frames = argc > 2 ? std::atoi(argv[2]) : 240;
+    if (frames <= 0) {
+        std::cerr << "usage: " << argv[0] << " [threads] [frames] [level.lvl]\n";
+        return 1;
+    }
+    Simulation sim;
+    if (argc > 3) {
+        LevelFile level;
+        if (!level.loadFromFile(argv[3])) return 1;
+        sim.loadLevel(level);
+    }
+
+    // Eyes at room centres, looking all round
+    std::vector<Raycaster::Camera> cameras;
+    for (int i = 0; i < frames; i++) {
+        const sf::FloatRect& room = sim.rooms[i % sim.rooms.size()];
+        Raycaster::Camera camera;
+        camera.position = sf::Vector2f(room.left + room.width / 2, room.top + room.height / 2);
+        camera.angle = i * 0.21f;
+        camera.fov = 1.2f;
+        camera.viewDistance = 560.0f;
+        cameras.push_back(camera);
+    }
+
+    long mismatches = 0;
+    Rng rng(99);
+    for (int i = 0; i < 20000; i++) {
+        const Raycaster::Camera& camera = cameras[i % cameras.size()];
+        float angle = rng.nextInt(36000) * (6.2831853f / 36000);
+        sf::Vector2f direction(std::cos(angle), std::sin(angle));
+        int side;
+        float grid = sim.wallGrid.castRay(camera.position, direction, camera.viewDistance, side);
+        float brute = bruteForceRay(sim.walls, camera.position, direction, camera.viewDistance);
+        mismatches += std::abs(grid - brute) > 0.01f;
+    }
+
+    std::vector<Raycaster::Billboard> billboards;
+    for (size_t i = 0; i < sim.grannies.size(); i++) {
+        billboards.push_back({sim.grannyCenter(i), sim.grannySize.x, 120.0f, Raycaster::rgba(255, 0, 255)});
+    }
+
+    JobSystem jobs(threads);
+    const unsigned resolutions[][2] = {{1200, 800}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+    using Clock = std::chrono::steady_clock;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << sim.walls.size() << " walls, " << frames << " frames, " << jobs.threadCount() << " threads\n";
+    std::cout << std::setw(12) << "resolution" << std::setw(10) << "threads" << std::setw(10) << "mean ms"
+              << std::setw(10) << "p99 ms" << std::setw(10) << "fps" << "\n";
+    for (const auto& resolution : resolutions) {
+        Raycaster raycaster;
+        raycaster.resize(resolution[0], resolution[1]);
+        for (JobSystem* pool : {static_cast<JobSystem*>(nullptr), &jobs}) {
+            std::vector<double> times;
+            for (const auto& camera : cameras) {
+                Clock::time_point start = Clock::now();
+                raycaster.render(sim.wallGrid, camera, billboards, pool);
+                times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+            double mean = 0;
+            for (double t : times) mean += t;
+            mean /= times.size();
+            std::sort(times.begin(), times.end());
+            std::cout << std::setw(6) << resolution[0] << "x" << std::setw(5) << std::left << resolution[1] << std::right
+                      << std::setw(10) << (pool ? pool->threadCount() : 1) << std::setw(10) << mean
+                      << std::setw(10) << percentile(times, 99) << std::setw(10) << 1000.0 / mean << "\n";
+        }
+    }
+    std::cout << "ray mismatches: " << mismatches << "\n";
+    return mismatches == 0 ? 0 : 1;
+}
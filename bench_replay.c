@@ -0,0 +1,109 @@
+// Replay benchmark: steps the simulation through a recorded input trace
+// (from the game's --record option or --generate here), checks the final
+// state matches the recording and reports per-tick latency with the
+// slowest ticks, so a reported frame spike can be rerun and bisected.
+//
+//   g++ -std=c++17 -O2 -pthread bench_replay.c -o bench_replay
+//   ./bench_replay --generate ticks trace.rep
+//   ./bench_replay trace.rep [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "simulation.h"
+#include "replay.h"
+#include "bench_util.h"
+
+int generate(long ticks, const char* filename) {
+    Replay replay;
+    replay.start(12345, Simulation::fixedDt);
+    Simulation sim;
+    sim.setSeed(replay.seed);
+    for (long tick = 0; tick < ticks; tick++) {
+        PlayerInput input = scriptedInput(tick, true); // bench_sim's circuit, restarting each lap
+        replay.record(input);
+        sim.step(replay.dt, input);
+    }
+    replay.finalHash = sim.stateHash();
+    if (!replay.saveToFile(filename)) return 1;
+    std::cout << "wrote " << ticks << " ticks to " << filename << " (hash " << std::hex << replay.finalHash << ")\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && std::strcmp(argv[1], "--generate") == 0) {
+        long ticks = std::atol(argv[2]);
+        if (ticks <= 0) {
+            std::cerr << "usage: " << argv[0] << " --generate ticks file\n";
+            return 1;
+        }
+        return generate(ticks, argv[3]);
+    }
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " file [threads] | --generate ticks file\n";
+        return 1;
+    }
+
+    Replay replay;
+    if (!replay.loadFromFile(argv[1], 0)) return 1; // Always the built-in house
+    if (replay.inputs.empty()) {
+        std::cerr << "replay " << argv[1] << " has no ticks\n";
+        return 1;
+    }
+
+    // Routing and RNG are per agent, so the job system must not change the outcome
+    std::unique_ptr<JobSystem> jobs;
+    Simulation sim;
+    if (argc == 3) {
+        jobs.reset(new JobSystem(static_cast<unsigned>(std::atoi(argv[2]))));
+        sim.jobs = jobs.get();
+    }
+    sim.setSeed(replay.seed);
+
+    size_t ticks = replay.inputs.size();
+    std::vector<double> latencies(ticks);
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    for (size_t tick = 0; tick < ticks; tick++) {
+        Clock::time_point tickStart = Clock::now();
+        sim.step(replay.dt, replay.inputs[tick]);
+        latencies[tick] = std::chrono::duration<double, std::nano>(Clock::now() - tickStart).count();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t hash = sim.stateHash();
+
+    std::vector<size_t> slowest(ticks);
+    std::iota(slowest.begin(), slowest.end(), 0);
+    size_t shown = std::min<size_t>(5, ticks);
+    std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(),
+                      [&](size_t a, size_t b) { return latencies[a] > latencies[b]; });
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "ticks:        " << ticks << " (seed " << replay.seed << ", dt " << replay.dt * 1000.0f << " ms)\n";
+    std::cout << "ticks/sec:    " << ticks / elapsed << "\n";
+    std::cout << "tick latency (ns):\n";
+    std::cout << "  p50         " << percentile(sorted, 50) << "\n";
+    std::cout << "  p99         " << percentile(sorted, 99) << "\n";
+    std::cout << "  max         " << sorted.back() << "\n";
+    std::cout << "slowest ticks:";
+    for (size_t i = 0; i < shown; i++) {
+        std::cout << " " << slowest[i] << " (" << latencies[slowest[i]] << ")";
+    }
+    std::cout << "\n";
+
+    std::cout << std::hex << "final hash:   " << hash;
+    if (replay.finalHash != 0 && hash != replay.finalHash) {
+        std::cout << " MISMATCH (recorded " << replay.finalHash << ")\n";
+        return 1;
+    }
+    std::cout << (replay.finalHash != 0 ? " matches recording\n" : " (recording has no hash)\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Headless simulation benchmark: steps the game logic at a fixed dt with
+// scripted input and reports ticks/sec plus per-tick latency percentiles.
+// Any tick rate can be given; the script follows game time, and the run
+// fails if the player or Granny ever ends a tick inside a wall, or if any
+// tick after the first ten game seconds allocates.
+//
+//   g++ -std=c++17 -O2 bench_sim.c -o bench_sim
+//   ./bench_sim [ticks] [ticks per second]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "simulation.h"
+#include "alloc_counter.h"
+#include "bench_util.h"
+
+int main(int argc, char** argv) {
+    long ticks = argc > 1 ? std::atol(argv[1]) : 1000000;
+    long rate = argc > 2 ? std::atol(argv[2]) : 60;
+    if (ticks <= 0 || rate <= 0) {
+        std::cerr << "usage: " << argv[0] << " [ticks] [ticks per second]\n";
+        return 1;
+    }
+    float dt = 1.0f / rate;
+
+    Simulation sim;
+    sim.setSeed(12345);
+    std::vector<double> latencies(ticks);
+    long resets = 0;
+    long insideWalls = 0;
+    long warmupTicks = 10 * rate;
+    long allocatingTicks = 0;
+    uint64_t allocations = 0;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    for (long tick = 0; tick < ticks; tick++) {
+        PlayerInput input = scriptedInput(tick * 60 / rate);
+
+        uint64_t allocationsBefore = AllocCounter::count();
+        Clock::time_point tickStart = Clock::now();
+        sim.step(dt, input);
+        Clock::time_point tickEnd = Clock::now();
+
+        insideWalls += sim.wallGrid.overlapsBox(sim.playerBounds());
+        for (size_t i = 0; i < sim.grannies.size(); i++) {
+            insideWalls += sim.wallGrid.overlapsBox(sim.grannyBounds(i));
+        }
+
+        latencies[tick] = std::chrono::duration<double, std::nano>(tickEnd - tickStart).count();
+        if (sim.gameOver || sim.gameWon) {
+            sim.reset();
+            resets++;
+        }
+        uint64_t made = AllocCounter::count() - allocationsBefore;
+        if (tick >= warmupTicks && made > 0) {
+            allocatingTicks++;
+            allocations += made;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "ticks:        " << ticks << " (dt " << dt * 1000.0f << " ms, "
+              << resets << " game resets)\n";
+    std::cout << "ticks/sec:    " << ticks / elapsed << "\n";
+    std::cout << "tick latency (ns):\n";
+    std::cout << "  p50         " << percentile(latencies, 50) << "\n";
+    std::cout << "  p90         " << percentile(latencies, 90) << "\n";
+    std::cout << "  p99         " << percentile(latencies, 99) << "\n";
+    std::cout << "  p99.9       " << percentile(latencies, 99.9) << "\n";
+    std::cout << "  max         " << latencies.back() << "\n";
+    std::cout << "inside walls: " << insideWalls << "\n";
+    std::cout << "allocating ticks: " << allocatingTicks << " (" << allocations << " allocations)\n";
+    return insideWalls == 0 && allocatingTicks == 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// Save state benchmark: plays a seeker bot and captures the whole game
+// state every tick into a rewind buffer. Reports the snapshot size, the
+// bytes each recorded tick costs, and capture, restore, record and rewind
+// times. It fails if a restored state hashes differently from the original,
+// a rewind does not return the exact bytes recorded, or two forks from one
+// state drift apart.
+//
+//   g++ -std=c++17 -O2 -pthread bench_snapshot.c -o bench_snapshot
+//   ./bench_snapshot [ticks] [level.lvl]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "simulation.h"
+#include "save_state.h"
+#include "bot_player.h"
+#include "level_file.h"
+#include "bench_util.h"
+
+int main(int argc, char** argv) {
+    long ticks = argc > 1 ? std::atol(argv[1]) : 100000;
+    if (ticks <= 0) {
+        std::cerr << "usage: " << argv[0] << " [ticks] [level.lvl]\n";
+        return 1;
+    }
+
+    Simulation sim;
+    if (argc > 2) {
+        LevelFile level;
+        if (!level.loadFromFile(argv[2])) return 1;
+        sim.loadLevel(level);
+    }
+    sim.setSeed(12345);
+    float dt = Simulation::fixedDt;
+    const size_t rewindFrames = 10 * 60; // Ten seconds
+    BotPlayer bot(BotPlayer::SEEKER, 7);
+
+    using Clock = std::chrono::steady_clock;
+    auto ns = [](Clock::duration d) { return std::chrono::duration<double, std::nano>(d).count(); };
+
+    SaveState state;
+    SaveState decoded;
+    RewindBuffer rewind(rewindFrames); // Sized like the game's
+    Simulation restored = sim;
+    std::vector<double> captureTimes(ticks), pushTimes(ticks), restoreTimes(ticks);
+    std::deque<std::vector<uint8_t>> recent; // Last rewindFrames states, to check rewinds against
+    long mismatches = 0;
+    for (long tick = 0; tick < ticks; tick++) {
+        sim.step(dt, bot.think(sim, dt));
+        if (sim.gameOver || sim.gameWon) sim.reset();
+
+        Clock::time_point start = Clock::now();
+        state.capture(sim);
+        Clock::time_point captured = Clock::now();
+        rewind.push(state);
+        Clock::time_point pushed = Clock::now();
+        bool ok = state.restore(restored);
+        Clock::time_point restoredAt = Clock::now();
+
+        captureTimes[tick] = ns(captured - start);
+        pushTimes[tick] = ns(pushed - captured);
+        restoreTimes[tick] = ns(restoredAt - pushed);
+        mismatches += !ok || restored.stateHash() != sim.stateHash();
+
+        recent.push_back(state.buffer());
+        if (recent.size() > rewindFrames) recent.pop_front();
+    }
+
+    // Rewind a copy of the buffer by one, five and ten seconds
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "rewind (us):\n";
+    for (size_t seconds : {1, 5, 10}) {
+        size_t back = std::min(seconds * 60, rewind.frameCount()) - 1;
+        RewindBuffer copy = rewind;
+        Clock::time_point start = Clock::now();
+        bool ok = copy.rewind(back, decoded);
+        double took = ns(Clock::now() - start) / 1000.0;
+        mismatches += !ok || decoded.buffer() != recent[recent.size() - 1 - back];
+        std::cout << "  " << std::setw(2) << seconds << " s       " << took << "\n";
+    }
+
+    // Two forks from the same state must play out the same
+    Simulation forkA = sim, forkB = sim;
+    state.capture(sim);
+    state.restore(forkA);
+    state.restore(forkB);
+    BotPlayer botA(BotPlayer::SCRIPTED), botB(BotPlayer::SCRIPTED);
+    for (int tick = 0; tick < 3600; tick++) {
+        forkA.step(dt, botA.think(forkA, dt));
+        forkB.step(dt, botB.think(forkB, dt));
+    }
+    bool forksMatch = forkA.stateHash() == forkB.stateHash();
+
+    std::sort(captureTimes.begin(), captureTimes.end());
+    std::sort(pushTimes.begin(), pushTimes.end());
+    std::sort(restoreTimes.begin(), restoreTimes.end());
+    std::cout << "ticks:          " << ticks << " (" << sim.grannies.size() << " grannies, "
+              << sim.items.size() << " items)\n";
+    std::cout << "snapshot bytes: " << state.size() << "\n";
+    std::cout << "bytes/tick:     " << static_cast<double>(rewind.byteCount()) / rewind.frameCount()
+              << " in the rewind buffer (" << rewind.frameCount() << " ticks, "
+              << rewind.byteCount() << " bytes of a " << rewind.capacity() << "-byte ring)\n";
+    std::cout << "time (ns)       p50       p99\n";
+    std::cout << "  capture  " << std::setw(10) << percentile(captureTimes, 50) << std::setw(10) << percentile(captureTimes, 99) << "\n";
+    std::cout << "  restore  " << std::setw(10) << percentile(restoreTimes, 50) << std::setw(10) << percentile(restoreTimes, 99) << "\n";
+    std::cout << "  record   " << std::setw(10) << percentile(pushTimes, 50) << std::setw(10) << percentile(pushTimes, 99) << "\n";
+    std::cout << "mismatches:     " << mismatches << "\n";
+    std::cout << "forks match:    " << (forksMatch ? "yes" : "no") << "\n";
+    return mismatches == 0 && forksMatch ? 0 : 1;
+}
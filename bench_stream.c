@@ -0,0 +1,130 @@
+// World streaming benchmark: flies the view back and forth across the
+// level at a steady speed, one update per 60 Hz frame, and reports the
+// chunk pool against baking the whole map, loads and evictions, frames
+// that showed a chunk before it was ready, and the main-thread cost of an
+// update. At points along the way it lets the stream settle, then fails if
+// any wall or closet in view is in a chunk that is not resident.
+//
+//   g++ -std=c++17 -O2 -pthread bench_stream.c -o bench_stream -lsfml-graphics -lsfml-window -lsfml-system
+//   ./bench_stream [speed] [seconds] [level.lvl]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include "simulation.h"
+#include "world_stream.h"
+#include "level_file.h"
+#include "bench_util.h"
+
+// View rectangle around center, with lo3ba's 64-unit culling margin
+sf::FloatRect viewAround(sf::Vector2f center) {
+    return sf::FloatRect(center.x - 664, center.y - 464, 1328, 928);
+}
+
+// Walls and closets in view whose chunk is not drawn
+long uncovered(const WorldStream& stream, const Simulation& sim, const sf::FloatRect& view) {
+    long count = 0;
+    for (const auto* rects : {&sim.walls, &sim.hidingSpots}) {
+        for (const auto& bounds : *rects) {
+            count += bounds.intersects(view) && !stream.resident(stream.chunkOf(bounds));
+        }
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    float speed = argc > 1 ? static_cast<float>(std::atof(argv[1])) : 600.0f;
+    float seconds = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 20.0f;
+    if (speed <= 0 || seconds <= 0) {
+        std::cerr << "usage: " << argv[0] << " [speed] [seconds] [level.lvl]\n";
+        return 1;
+    }
+    Simulation sim;
+    if (argc > 3) {
+        LevelFile level;
+        if (!level.loadFromFile(argv[3])) return 1;
+        sim.loadLevel(level);
+    }
+
+    // Rows across the world, turning at each edge
+    const sf::FloatRect& world = sim.worldBounds;
+    float rowGap = std::max(400.0f, world.height / 8);
+    std::vector<sf::Vector2f> path;
+    for (float y = world.top + 200; y < world.top + world.height; y += rowGap) {
+        bool rightwards = path.size() % 4 == 0;
+        path.push_back(sf::Vector2f(rightwards ? world.left : world.left + world.width, y));
+        path.push_back(sf::Vector2f(rightwards ? world.left + world.width : world.left, y));
+    }
+
+    SpriteAtlas atlas;
+    WorldStream stream;
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point buildStart = Clock::now();
+    stream.build(sim.walls, sim.hidingSpots, world, atlas, path[0]);
+    double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+    const float dt = 1.0f / 60;
+    int frames = static_cast<int>(seconds / dt);
+    std::vector<double> updateTimes;
+    updateTimes.reserve(frames);
+    long lateFrames = 0, uncoveredObjects = 0, checks = 0;
+    unsigned maxResident = 0;
+    size_t leg = 0;
+    sf::Vector2f position = path[0];
+    Clock::time_point frameStart = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        // Along the path, back to the start at its end
+        sf::Vector2f target = path[(leg + 1) % path.size()];
+        sf::Vector2f d = target - position;
+        float length = std::sqrt(d.x * d.x + d.y * d.y);
+        sf::Vector2f velocity = length > 0 ? d * (speed / length) : sf::Vector2f();
+        if (length <= speed * dt) {
+            position = target;
+            leg = (leg + 1) % path.size();
+        } else {
+            position += velocity * dt;
+        }
+
+        Clock::time_point start = Clock::now();
+        stream.update(position, velocity);
+        updateTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        lateFrames += stream.missing(viewAround(position)) > 0;
+        maxResident = std::max(maxResident, stream.stats().resident);
+
+        // Every two seconds, stop and check once everything has arrived
+        if (frame % 120 == 119) {
+            while (stream.stats().pending > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                stream.update(position, sf::Vector2f());
+            }
+            uncoveredObjects += uncovered(stream, sim, viewAround(position));
+            checks++;
+            frameStart = Clock::now();
+        }
+
+        // Frames are paced as they would be on a 60 Hz display
+        frameStart += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(frameStart);
+    }
+
+    WorldStream::Stats stats = stream.stats();
+    size_t objects = sim.walls.size() + sim.hidingSpots.size();
+    std::sort(updateTimes.begin(), updateTimes.end());
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "objects:        " << objects << " in " << stats.chunks << " chunks\n";
+    std::cout << "build:          " << buildMs << " ms\n";
+    std::cout << "slot pool:      " << stats.slots << " slots, " << stats.poolBytes / 1024 << " KiB (whole map "
+              << objects * 6 * sizeof(sf::Vertex) / 1024 << " KiB)\n";
+    std::cout << "resident:       " << maxResident << " chunks at most\n";
+    std::cout << "flight:         " << frames << " frames at " << speed << " units/s\n";
+    std::cout << "loads:          " << stats.loads << ", evictions " << stats.evictions << "\n";
+    std::cout << "late frames:    " << lateFrames << " (a chunk in view not ready yet)\n";
+    std::cout << "update (ms):    p50 " << percentile(updateTimes, 50) << "  p99 " << percentile(updateTimes, 99)
+              << "  max " << updateTimes.back() << "\n";
+    std::cout << "settled checks: " << checks << ", uncovered objects " << uncoveredObjects << "\n";
+    return uncoveredObjects == 0 ? 0 : 1;
+}
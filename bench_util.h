@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "simulation.h"
+
+// Helpers shared by the bench_*.c programs
+
+// Value at percentile p (0 to 100) of an ascending list, or 0 if it is empty
+inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[index];
+}
+
+// Walk a fixed circuit so the player bumps into walls, picks up items
+// and wanders into Granny's view; tick counts 60 Hz ticks. The last of
+// the eight legs stands still, or restarts the game if restart is set.
+inline PlayerInput scriptedInput(long tick, bool restart = false) {
+    PlayerInput input;
+    switch ((tick / 90) % 8) {
+        case 0: input.press(PlayerInput::RIGHT); break;
+        case 1: input.press(PlayerInput::DOWN); break;
+        case 2: input.press(PlayerInput::RIGHT); input.press(PlayerInput::DOWN); break;
+        case 3: input.press(PlayerInput::LEFT); break;
+        case 4: input.press(PlayerInput::UP); break;
+        case 5: input.press(PlayerInput::LEFT); input.press(PlayerInput::UP); break;
+        case 6: input.press(PlayerInput::RIGHT); input.press(PlayerInput::UP); break;
+        case 7: if (restart) input.press(PlayerInput::RESTART); break;
+    }
+    return input;
+}
@@ -0,0 +1,151 @@
+// Visibility polygon benchmark: time per polygon with the wall grid and
+// with the flat wall list, at a flashlight radius and at a radius that
+// takes in thousands of wall edges. Every polygon is checked against
+// brute-force rays over all walls, and the run fails on a mismatch.
+//
+//   g++ -std=c++17 -O2 bench_visibility.c -o bench_visibility
+//   ./bench_visibility [walls] [polygons]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include "visibility.h"
+#include "wall_grid.h"
+
+// Rooms of createRoom()-style walls on a grid, with a doorway in the right
+// and bottom wall of each
+std::vector<sf::FloatRect> makeWalls(size_t count) {
+    std::vector<sf::FloatRect> walls;
+    int columns = static_cast<int>(std::sqrt(count / 6.0)) + 1;
+    for (int room = 0; walls.size() < count; room++) {
+        float x = (room % columns) * 300.0f;
+        float y = (room / columns) * 300.0f;
+        walls.push_back(sf::FloatRect(x, y, 300, 20));
+        walls.push_back(sf::FloatRect(x, y, 20, 300));
+        walls.push_back(sf::FloatRect(x + 280, y, 20, 120));
+        walls.push_back(sf::FloatRect(x + 280, y + 180, 20, 120));
+        walls.push_back(sf::FloatRect(x, y + 280, 120, 20));
+        walls.push_back(sf::FloatRect(x + 180, y + 280, 120, 20));
+    }
+    walls.resize(count);
+    return walls;
+}
+
+// Nearest wall along the ray, or radius when nothing is closer
+float castRay(sf::Vector2f origin, sf::Vector2f direction, float radius, const std::vector<sf::FloatRect>& walls) {
+    float nearest = radius;
+    for (const auto& wall : walls) {
+        float t0 = 0, t1 = nearest;
+        float bounds[2][2] = {{wall.left, wall.left + wall.width}, {wall.top, wall.top + wall.height}};
+        float start[2] = {origin.x, origin.y};
+        float step[2] = {direction.x, direction.y};
+        bool hit = true;
+        for (int axis = 0; axis < 2 && hit; axis++) {
+            if (step[axis] == 0) {
+                hit = start[axis] >= bounds[axis][0] && start[axis] <= bounds[axis][1];
+                continue;
+            }
+            float a = (bounds[axis][0] - start[axis]) / step[axis];
+            float b = (bounds[axis][1] - start[axis]) / step[axis];
+            t0 = std::max(t0, std::min(a, b));
+            t1 = std::min(t1, std::max(a, b));
+            hit = t0 <= t1;
+        }
+        if (hit) nearest = std::min(nearest, t0);
+    }
+    return nearest;
+}
+
+// Distance to the polygon's edge along angle, from the fan's triangles
+float polygonDistance(const VisibilityPolygon& polygon, float angle) {
+    sf::Vector2f origin = polygon.origin();
+    sf::Vector2f direction(std::cos(angle), std::sin(angle));
+    const std::vector<sf::Vector2f>& points = polygon.points();
+    float best = -1;
+    for (size_t i = 0; i + 1 < points.size(); i++) {
+        sf::Vector2f a = points[i] - origin, b = points[i + 1] - origin;
+        float crossA = a.x * direction.y - a.y * direction.x;
+        float crossB = b.x * direction.y - b.y * direction.x;
+        // Ray passes between a and b, on the same side of the origin
+        if (crossA < 0 || crossB > 0 || a.x * direction.x + a.y * direction.y + b.x * direction.x + b.y * direction.y < 0) continue;
+        sf::Vector2f edge = b - a;
+        float denominator = direction.x * edge.y - direction.y * edge.x;
+        if (denominator == 0) continue;
+        best = std::max(best, (a.x * edge.y - a.y * edge.x) / denominator);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t wallCount = argc > 1 ? std::atol(argv[1]) : 6000;
+    size_t polygonCount = argc > 2 ? std::atol(argv[2]) : 2000;
+    if (wallCount == 0 || polygonCount == 0) {
+        std::cerr << "usage: " << argv[0] << " [walls] [polygons]\n";
+        return 1;
+    }
+
+    std::vector<sf::FloatRect> walls = makeWalls(wallCount);
+    WallGrid grid;
+    grid.build(walls);
+    float extent = static_cast<float>(std::sqrt(wallCount / 6.0) + 1) * 300.0f;
+
+    // Viewers inside rooms, clear of the walls
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> room(0, static_cast<int>(extent / 300) - 1);
+    std::uniform_real_distribution<float> inside(25, 275);
+    std::vector<sf::Vector2f> origins(polygonCount);
+    for (auto& origin : origins) {
+        origin = sf::Vector2f(room(rng) * 300.0f + inside(rng), room(rng) * 300.0f + inside(rng));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << wallCount << " walls, " << polygonCount << " polygons\n";
+    std::cout << std::left << std::setw(10) << "radius" << std::setw(8) << "index" << std::right
+              << std::setw(12) << "edges/poly" << std::setw(12) << "us/poly" << std::setw(12) << "worst us" << "\n";
+
+    long mismatches = 0;
+    VisibilityPolygon polygon;
+    for (float radius : {400.0f, 2500.0f}) {
+        for (const WallGrid* index : {static_cast<const WallGrid*>(&grid), static_cast<const WallGrid*>(nullptr)}) {
+            double total = 0, worst = 0;
+            size_t edges = 0;
+            for (size_t i = 0; i < polygonCount; i++) {
+                Clock::time_point start = Clock::now();
+                polygon.compute(origins[i], radius, walls, index);
+                double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+                total += us;
+                worst = std::max(worst, us);
+                edges += polygon.segmentCount();
+
+                // Sampled against brute force; arcs are drawn as chords
+                if (i % 50 == 0) {
+                    for (int k = 0; k < 360; k++) {
+                        float angle = -3.14159265f + (k + 0.37f) * 3.14159265f / 180;
+                        float expected = castRay(origins[i], {std::cos(angle), std::sin(angle)}, radius, walls);
+                        float actual = polygonDistance(polygon, angle);
+                        if (std::abs(actual - expected) > 0.5f + radius * 0.003f) mismatches++;
+                    }
+                }
+            }
+            std::cout << std::left << std::setw(10) << radius << std::setw(8) << (index ? "grid" : "flat")
+                      << std::right << std::setw(12) << edges / polygonCount << std::setw(12) << total / polygonCount
+                      << std::setw(12) << worst << "\n";
+        }
+    }
+
+    // Flashlight cone, as drawn in the game
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < polygonCount; i++) {
+        polygon.compute(origins[i], 400, walls, &grid, static_cast<float>(i), 0.6f);
+    }
+    std::cout << "cone 400 grid        " << std::setw(12)
+              << std::chrono::duration<double, std::micro>(Clock::now() - start).count() / polygonCount << " us/poly\n";
+
+    std::cout << "mismatches: " << mismatches << "\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+// Wall narrow-phase microbenchmark: compares the original per-edge
+// lineIntersectsRect()/FloatRect::intersects scan with the SoA slab kernels
+// (scalar, SSE, AVX) and the grid, and fails if any result differs.
+//
+//   g++ -std=c++17 -O2 bench_walls.c -o bench_walls            (SSE2)
+//   g++ -std=c++17 -O2 -mavx2 bench_walls.c -o bench_walls     (AVX)
+//   ./bench_walls [walls] [queries]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include "wall_boxes.h"
+#include "wall_grid.h"
+
+struct Segment {
+    sf::Vector2f p1;
+    sf::Vector2f p2;
+};
+
+// Rooms laid out on a grid like createMap(), four walls each
+std::vector<sf::FloatRect> makeWalls(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> size(150, 350);
+    std::vector<sf::FloatRect> walls;
+    int columns = static_cast<int>(std::sqrt(count / 4.0)) + 1;
+    for (int room = 0; walls.size() < count; room++) {
+        float x = (room % columns) * 400.0f + 50;
+        float y = (room / columns) * 400.0f + 50;
+        float width = std::floor(size(rng));
+        float height = std::floor(size(rng));
+        walls.push_back(sf::FloatRect(x, y, width, 20));
+        walls.push_back(sf::FloatRect(x, y + height - 20, width, 20));
+        walls.push_back(sf::FloatRect(x, y, 20, height));
+        walls.push_back(sf::FloatRect(x + width - 20, y, 20, height));
+    }
+    walls.resize(count);
+    return walls;
+}
+
+template <typename Fn>
+double nsPerQuery(size_t queries, int repeats, Fn&& run) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeats; r++) {
+        run();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (queries * repeats);
+}
+
+int main(int argc, char** argv) {
+    size_t wallCount = argc > 1 ? std::atol(argv[1]) : 4096;
+    size_t queryCount = argc > 2 ? std::atol(argv[2]) : 20000;
+    if (wallCount == 0 || queryCount == 0) {
+        std::cerr << "usage: " << argv[0] << " [walls] [queries]\n";
+        return 1;
+    }
+
+    std::mt19937 rng(12345);
+    std::vector<sf::FloatRect> walls = makeWalls(wallCount, rng);
+    WallBoxes boxes;
+    boxes.assign(walls);
+    WallGrid grid;
+    grid.build(walls);
+
+    // Agent-to-player rays (up to ~300 px) and player-sized boxes
+    float extent = static_cast<float>(std::sqrt(wallCount / 4.0) + 1) * 400.0f;
+    std::uniform_real_distribution<float> position(0, extent);
+    std::uniform_real_distribution<float> offset(-300, 300);
+    std::vector<Segment> segments(queryCount);
+    std::vector<sf::FloatRect> areas(queryCount);
+    for (size_t i = 0; i < queryCount; i++) {
+        sf::Vector2f p(position(rng), position(rng));
+        sf::Vector2f d(offset(rng), offset(rng));
+        if (i % 4 == 0) d.x = 0;
+        if (i % 4 == 1) d.y = 0;
+        segments[i] = {p, p + d};
+        areas[i] = sf::FloatRect(p, sf::Vector2f(30, 50));
+    }
+
+    // Grazing cases random segments almost never hit: axis-aligned
+    // segments along each edge of the first walls and through each corner,
+    // both ways round. Lengths are powers of two so the slab parameters are
+    // exact.
+    std::vector<Segment> edgeSegments;
+    auto addEdge = [&](sf::Vector2f p1, sf::Vector2f p2) {
+        edgeSegments.push_back({p1, p2});
+        edgeSegments.push_back({p2, p1});
+    };
+    for (size_t w = 0; w < walls.size() && w < 64; w++) {
+        float left = walls[w].left, top = walls[w].top;
+        float right = left + walls[w].width, bottom = top + walls[w].height;
+        for (float y : {top, bottom}) {
+            addEdge(sf::Vector2f(left + 4, y), sf::Vector2f(right - 4, y)); // Within the edge
+            addEdge(sf::Vector2f(left, y), sf::Vector2f(right, y));         // The whole edge
+            addEdge(sf::Vector2f(left - 16, y), sf::Vector2f(right + 16, y));
+        }
+        for (float x : {left, right}) {
+            addEdge(sf::Vector2f(x, top + 4), sf::Vector2f(x, bottom - 4));
+            addEdge(sf::Vector2f(x, top), sf::Vector2f(x, bottom));
+            addEdge(sf::Vector2f(x, top - 16), sf::Vector2f(x, bottom + 16));
+        }
+        for (sf::Vector2f corner : {sf::Vector2f(left, top), sf::Vector2f(right, top), sf::Vector2f(left, bottom),
+                                    sf::Vector2f(right, bottom)}) {
+            for (sf::Vector2f d : {sf::Vector2f(16, 0), sf::Vector2f(0, 16)}) {
+                addEdge(corner - d, corner + d); // Through it
+                addEdge(corner - d, corner);     // Ending on it, from either side
+                addEdge(corner, corner + d);
+            }
+        }
+    }
+
+    // Reference results from the original implementation
+    std::vector<char> expectedEdge(edgeSegments.size());
+    for (size_t i = 0; i < edgeSegments.size(); i++) {
+        for (const auto& wall : walls) {
+            if (lineIntersectsRect(edgeSegments[i].p1, edgeSegments[i].p2, wall)) {
+                expectedEdge[i] = 1;
+                break;
+            }
+        }
+    }
+    std::vector<char> expectedSegment(queryCount), expectedBox(queryCount);
+    for (size_t i = 0; i < queryCount; i++) {
+        for (const auto& wall : walls) {
+            if (!expectedSegment[i] && lineIntersectsRect(segments[i].p1, segments[i].p2, wall)) expectedSegment[i] = 1;
+            if (!expectedBox[i] && areas[i].intersects(wall)) expectedBox[i] = 1;
+        }
+    }
+
+    struct Variant {
+        std::string name;
+        bool (*segment)(const WallBoxes&, size_t, size_t, const SegmentQuery&);
+        bool (*box)(const WallBoxes&, size_t, size_t, const BoxQuery&);
+    };
+    std::vector<Variant> variants = {
+        {"soa scalar", anySegmentHitScalar, anyBoxOverlapScalar},
+#if defined(__SSE2__)
+        {"soa sse", anySegmentHitSse, anyBoxOverlapSse},
+#endif
+#if defined(__AVX__)
+        {"soa avx", anySegmentHitAvx, anyBoxOverlapAvx},
+#endif
+    };
+
+    // Exact agreement with the reference
+    long mismatches = 0;
+    for (size_t i = 0; i < queryCount; i++) {
+        SegmentQuery segment(segments[i].p1, segments[i].p2);
+        BoxQuery box(areas[i]);
+        for (const auto& variant : variants) {
+            mismatches += variant.segment(boxes, 0, boxes.size(), segment) != (expectedSegment[i] != 0);
+            mismatches += variant.box(boxes, 0, boxes.size(), box) != (expectedBox[i] != 0);
+        }
+        mismatches += grid.segmentBlocked(segments[i].p1, segments[i].p2) != (expectedSegment[i] != 0);
+        mismatches += grid.overlapsBox(areas[i]) != (expectedBox[i] != 0);
+    }
+    long edgeMismatches = 0;
+    for (size_t i = 0; i < edgeSegments.size(); i++) {
+        SegmentQuery segment(edgeSegments[i].p1, edgeSegments[i].p2);
+        for (const auto& variant : variants) {
+            edgeMismatches += variant.segment(boxes, 0, boxes.size(), segment) != (expectedEdge[i] != 0);
+        }
+        edgeMismatches += grid.segmentBlocked(edgeSegments[i].p1, edgeSegments[i].p2) != (expectedEdge[i] != 0);
+    }
+    mismatches += edgeMismatches;
+
+    int repeats = 3;
+    volatile long sink = 0; // Keeps the timed loops from being optimized away
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << wallCount << " walls, " << queryCount << " queries\n";
+    std::cout << std::left << std::setw(14) << "variant" << std::right << std::setw(14) << "segment ns/q"
+              << std::setw(14) << "box ns/q" << "\n";
+
+    auto report = [&](const std::string& name, double segmentNs, double boxNs) {
+        std::cout << std::left << std::setw(14) << name << std::right << std::setw(14) << segmentNs
+                  << std::setw(14) << boxNs << "\n";
+    };
+
+    report("original",
+        nsPerQuery(queryCount, repeats, [&] {
+            for (const auto& s : segments) {
+                for (const auto& wall : walls) {
+                    if (lineIntersectsRect(s.p1, s.p2, wall)) { sink++; break; }
+                }
+            }
+        }),
+        nsPerQuery(queryCount, repeats, [&] {
+            for (const auto& area : areas) {
+                for (const auto& wall : walls) {
+                    if (area.intersects(wall)) { sink++; break; }
+                }
+            }
+        }));
+
+    for (const auto& variant : variants) {
+        report(variant.name,
+            nsPerQuery(queryCount, repeats, [&] {
+                for (const auto& s : segments) {
+                    if (variant.segment(boxes, 0, boxes.size(), SegmentQuery(s.p1, s.p2))) sink++;
+                }
+            }),
+            nsPerQuery(queryCount, repeats, [&] {
+                for (const auto& area : areas) {
+                    if (variant.box(boxes, 0, boxes.size(), BoxQuery(area))) sink++;
+                }
+            }));
+    }
+
+    report("grid",
+        nsPerQuery(queryCount, repeats, [&] {
+            for (const auto& s : segments) if (grid.segmentBlocked(s.p1, s.p2)) sink++;
+        }),
+        nsPerQuery(queryCount, repeats, [&] {
+            for (const auto& area : areas) if (grid.overlapsBox(area)) sink++;
+        }));
+
+    std::cout << "mismatches:   " << mismatches << " (" << edgeMismatches << " of them in " << edgeSegments.size()
+              << " edge and corner segments)\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include "simulation.h"
+#include "rng.h"
+#include "flow_field.h"
+
+// Computer-controlled players for headless runs. A bot only reads the
+// simulation and returns the buttons to hold for the next tick, so it plugs
+// in wherever recorded or scripted input would.
+class BotPlayer {
+public:
+    enum Kind : uint8_t {
+        SCRIPTED, // Walks a fixed circuit by game time, like bench_sim
+        SEEKER    // Fetches the nearest item, then the exit; runs from Granny
+    };
+
+    // How close a chasing Granny may get before a seeker runs away, and
+    // how far away every chasing Granny must be before it stops running.
+    // The gap keeps it from turning round at the edge of fleeRadius and
+    // walking straight back into it.
+    static constexpr float fleeRadius = 220.0f;
+    static constexpr float releaseRadius = 330.0f;
+
+    // Seconds without getting closer to where it is heading (pushing into
+    // a wall, or running off and walking back again) before a seeker
+    // decides it is stuck. It then tries a random direction for
+    // wanderTime, and if it was on the room route, follows the field to
+    // that goal from then on.
+    static constexpr float stallTime = 1.0f;
+    static constexpr float wanderTime = 0.5f;
+
+    // How much less than the player's half size the field grows walls
+    // by, so doorways stay at least two cells wide in it
+    static constexpr float fieldSlack = 5.0f;
+    static constexpr float fieldCell = 20.0f;
+
+    explicit BotPlayer(Kind kind = SEEKER, uint32_t seed = 1)
+        : kind(kind), rng(seed), room(-1), entered(-1), elapsed(0), fleeing(false), wanderLeft(0), wanderButtons(0),
+          fieldReady(false), lost(false), bestRemaining(-1), progressTime(0) {}
+
+    PlayerInput think(const Simulation& sim, float dt) {
+        elapsed += dt;
+        return kind == SCRIPTED ? scripted() : seek(sim, dt);
+    }
+
+private:
+    Kind kind;
+    Rng rng;
+    int room; // Last room the player was inside, or is walking into
+    int entered; // Door just walked through, until inside the room beyond
+    float elapsed;
+    bool fleeing;
+    float wanderLeft;
+    uint8_t wanderButtons;
+    FlowField field; // Built the first time the bot needs it
+    bool fieldReady;
+    bool lost;
+    sf::Vector2f lostGoal; // Goal the room route got stuck on, if lost
+    sf::Vector2f heading; // Point the bot is walking to, unless fleeing
+    float bestRemaining; // Closest it has been to heading, or -1 for none yet
+    float progressTime; // Seconds since bestRemaining last went down
+
+    PlayerInput scripted() const {
+        PlayerInput input;
+        switch (static_cast<long>(elapsed / 1.5f) % 8) {
+            case 0: input.press(PlayerInput::RIGHT); break;
+            case 1: input.press(PlayerInput::DOWN); break;
+            case 2: input.press(PlayerInput::RIGHT); input.press(PlayerInput::DOWN); break;
+            case 3: input.press(PlayerInput::LEFT); break;
+            case 4: input.press(PlayerInput::UP); break;
+            case 5: input.press(PlayerInput::LEFT); input.press(PlayerInput::UP); break;
+            case 6: input.press(PlayerInput::RIGHT); input.press(PlayerInput::UP); break;
+            case 7: break;
+        }
+        return input;
+    }
+
+    PlayerInput seek(const Simulation& sim, float dt) {
+        sf::Vector2f position = sim.playerCenter();
+        int here = sim.navGraph.roomAt(position);
+        if (here >= 0) room = here;
+
+        if (wanderLeft > 0) {
+            wanderLeft -= dt;
+            PlayerInput input;
+            input.buttons = wanderButtons;
+            return input;
+        }
+
+        // With every item held, the exit lies outside the rooms; follow a
+        // flow field round the house to it. Otherwise walk the room route,
+        // unless that got stuck on this goal (say, outside the house with
+        // a wall between the player and the next door). The field's walls
+        // are grown by most of the player's half size, so a path the
+        // centre can follow leaves room for the whole box.
+        sf::Vector2f target = goal(sim);
+        bool onField = allCollected(sim) || (lost && target == lostGoal);
+        if (onField) {
+            if (!fieldReady) {
+                sf::Vector2f grow = sim.playerSize / 2.0f - sf::Vector2f(fieldSlack, fieldSlack);
+                std::vector<sf::FloatRect> grown;
+                grown.reserve(sim.walls.size());
+                for (const auto& wall : sim.walls) {
+                    grown.push_back(sf::FloatRect(wall.left - grow.x, wall.top - grow.y,
+                                                  wall.width + 2 * grow.x, wall.height + 2 * grow.y));
+                }
+                field.build(grown, sim.worldBounds, fieldCell);
+                fieldReady = true;
+            }
+            field.setTarget(target);
+            field.update();
+            // A goal in a cell the grown walls cover cannot be a target
+            onField = field.distance(target) == 0;
+        }
+        sf::Vector2f next, step;
+        float remaining;
+        if (onField) {
+            next = target;
+            remaining = static_cast<float>(fieldStep(sim, position, step));
+        } else {
+            next = waypoint(sim, target, dt);
+            sf::Vector2f d = next - position;
+            remaining = std::sqrt(d.x * d.x + d.y * d.y);
+        }
+
+        // Stuck is measured as no progress towards where the bot is
+        // heading, not as standing still: swinging between fleeing and
+        // coming back, or long ticks hopping over a narrow passage, keep
+        // the player moving without getting anywhere
+        if (next != heading || bestRemaining < 0) {
+            heading = next;
+            bestRemaining = remaining;
+            progressTime = 0;
+        } else if (remaining < bestRemaining - 0.5f) {
+            bestRemaining = remaining;
+            progressTime = 0;
+        } else {
+            progressTime += dt;
+        }
+        if (progressTime > stallTime) {
+            progressTime = 0;
+            bestRemaining = remaining;
+            fleeing = false;
+            if (!onField) {
+                lost = true;
+                lostGoal = target;
+            }
+            wanderLeft = wanderTime;
+            wanderButtons = static_cast<uint8_t>(1u << rng.nextInt(4));
+            PlayerInput input;
+            input.buttons = wanderButtons;
+            return input;
+        }
+
+        // Run straight away from the closest chasing Granny
+        float radius = fleeing ? releaseRadius : fleeRadius;
+        float nearest = radius * radius;
+        sf::Vector2f threat;
+        fleeing = false;
+        for (size_t i = 0; i < sim.grannies.size(); i++) {
+            if (sim.grannies.state[i] != GrannyState::CHASE) continue;
+            sf::Vector2f d = position - sim.grannyCenter(i);
+            float distanceSquared = d.x * d.x + d.y * d.y;
+            if (distanceSquared < nearest) {
+                nearest = distanceSquared;
+                threat = d;
+                fleeing = true;
+            }
+        }
+        if (fleeing) {
+            PlayerInput input = towards(threat, 0);
+            input.press(PlayerInput::RUN);
+            return input;
+        }
+
+        if (onField && step != position) return towards(step - position, 1.0f);
+        return towards(next - position, 4.0f);
+    }
+
+    // Steps to the field's target, and the centre of the next cell on the
+    // way there. Walking to cell centres rather than along directions
+    // lines the player up with gaps it barely fits through. A player
+    // pressed against a wall can have its centre in a cell the grown
+    // walls cover; it then heads for the best cell next to it.
+    uint32_t fieldStep(const Simulation& sim, sf::Vector2f position, sf::Vector2f& step) const {
+        sf::Vector2f origin(sim.worldBounds.left, sim.worldBounds.top);
+        auto centre = [&](sf::Vector2f point) {
+            return sf::Vector2f(origin.x + (std::floor((point.x - origin.x) / fieldCell) + 0.5f) * fieldCell,
+                                origin.y + (std::floor((point.y - origin.y) / fieldCell) + 0.5f) * fieldCell);
+        };
+        step = position;
+        uint32_t best = field.distance(position);
+        if (best != FlowField::unreachable) {
+            sf::Vector2f direction = field.direction(position);
+            if (direction.x != 0 || direction.y != 0) {
+                step = centre(position + sf::Vector2f(direction.x > 0.1f ? fieldCell : direction.x < -0.1f ? -fieldCell : 0,
+                                                      direction.y > 0.1f ? fieldCell : direction.y < -0.1f ? -fieldCell : 0));
+            }
+            return best;
+        }
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                sf::Vector2f neighbour = position + sf::Vector2f(dx * fieldCell, dy * fieldCell);
+                uint32_t distance = field.distance(neighbour);
+                if (distance < best) {
+                    best = distance;
+                    step = centre(neighbour);
+                }
+            }
+        }
+        return best;
+    }
+
+    static bool allCollected(const Simulation& sim) {
+        for (const auto& item : sim.items) {
+            if (!item.collected) return false;
+        }
+        return true;
+    }
+
+    // Nearest item still lying around, or the exit once they are all held
+    sf::Vector2f goal(const Simulation& sim) const {
+        sf::Vector2f position = sim.playerCenter();
+        const sf::FloatRect& exit = sim.exitArea;
+        sf::Vector2f best(exit.left + exit.width / 2, exit.top + exit.height / 2);
+        float bestDistance = -1;
+        for (const auto& item : sim.items) {
+            if (item.collected) continue;
+            sf::Vector2f center(item.bounds.left + item.bounds.width / 2, item.bounds.top + item.bounds.height / 2);
+            sf::Vector2f d = center - position;
+            float distance = d.x * d.x + d.y * d.y;
+            if (bestDistance < 0 || distance < bestDistance) {
+                best = center;
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+
+    // Next point on the way to target: the next door on the room route,
+    // then a point just inside the room beyond it, since doors sit in the
+    // gaps between rooms. A target outside every room (the exit) is reached
+    // by leaving through the door nearest to it.
+    sf::Vector2f waypoint(const Simulation& sim, sf::Vector2f target, float dt) {
+        sf::Vector2f position = sim.playerCenter();
+        int here = sim.navGraph.roomAt(position);
+        int targetRoom = sim.navGraph.roomAt(target);
+        if (here >= 0) entered = -1;
+        if (room < 0 || here == targetRoom) return target;
+        if (here < 0 && entered >= 0) return inside(sim, room, sim.navGraph.door(entered).center);
+
+        int door = -1;
+        if (targetRoom >= 0) {
+            door = sim.navGraph.nextDoor(room, targetRoom);
+        } else {
+            float best = -1;
+            sim.navGraph.forEachDoor(room, [&](int candidate) {
+                sf::Vector2f d = sim.navGraph.door(candidate).center - target;
+                float distance = d.x * d.x + d.y * d.y;
+                if (best < 0 || distance < best) {
+                    best = distance;
+                    door = candidate;
+                }
+            });
+        }
+        if (door < 0) return target;
+
+        // At the door: a whole step counts as arrived, or long ticks would
+        // hop back and forth over it
+        sf::Vector2f toDoor = sim.navGraph.door(door).center - position;
+        float arrive = std::max(Simulation::doorArriveRadius, sim.playerSpeed * dt);
+        if (toDoor.x * toDoor.x + toDoor.y * toDoor.y < arrive * arrive) {
+            if (targetRoom < 0) return target; // Out of the house
+            room = sim.navGraph.otherSide(door, room);
+            entered = door;
+            return inside(sim, room, sim.navGraph.door(door).center);
+        }
+        return sim.navGraph.door(door).center;
+    }
+
+    // Point of room nearest to point, kept clear of its walls
+    static sf::Vector2f inside(const Simulation& sim, int room, sf::Vector2f point) {
+        const sf::FloatRect& r = sim.rooms[room];
+        float margin = std::min(40.0f, std::min(r.width, r.height) / 2);
+        return sf::Vector2f(std::max(r.left + margin, std::min(r.left + r.width - margin, point.x)),
+                            std::max(r.top + margin, std::min(r.top + r.height - margin, point.y)));
+    }
+
+    // Buttons for moving along direction; axes within deadZone are left alone
+    static PlayerInput towards(sf::Vector2f direction, float deadZone) {
+        PlayerInput input;
+        if (direction.x > deadZone) input.press(PlayerInput::RIGHT);
+        if (direction.x < -deadZone) input.press(PlayerInput::LEFT);
+        if (direction.y > deadZone) input.press(PlayerInput::DOWN);
+        if (direction.y < -deadZone) input.press(PlayerInput::UP);
+        return input;
+    }
+};
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "simulation.h"
+#include "sim_snapshot.h"
+#include "net_protocol.h"
+#include "net_link.h"
+
+// Co-op client. Ticks at the simulation rate: sends the tick's buttons
+// (with the last few again, in case earlier packets were lost) and moves
+// its own player at once with the same movement code the server runs, so
+// the player never waits a round trip. Each snapshot says which input the
+// server had applied; if the position predicted for that input disagrees,
+// the client starts again from the server's and replays the inputs it has
+// not heard about. Grannies and the other players are drawn
+// interpolationDelay behind the newest snapshot, between two received
+// states, so one lost snapshot does not make them stop.
+class CoopClient {
+public:
+    static constexpr size_t historySize = snapshotHistory; // Received states kept for bases and interpolation
+    static constexpr size_t inputWindow = maxRoundTripTicks + 16; // Unconfirmed inputs that can still be replayed
+    static constexpr uint8_t inputRedundancy = 8; // Inputs repeated in every packet
+    static constexpr uint32_t helloIntervalMs = 250;
+    static constexpr float interpolationDelay = 0.1f; // Seconds; two snapshot intervals
+    static constexpr float correctionThreshold = 0.5f; // Units; closer counts as agreeing
+
+    enum class Status { CONNECTING, PLAYING, REJECTED };
+
+    struct Stats {
+        uint64_t snapshots = 0;
+        uint64_t lateSnapshots = 0; // Older than one already received
+        uint64_t undecodable = 0;   // Base no longer held
+        uint64_t corrections = 0;   // Predictions the server disagreed with
+        float correctionTotal = 0;  // Sum of their sizes in units
+        float correctionMax = 0;
+
+        // Newest samples, with counts so a reader can tell when one is new
+        uint64_t rttSamples = 0;
+        float rttMs = 0;     // Round trip, minus the time the server held the input
+        uint64_t confirmSamples = 0;
+        float confirmMs = 0; // From sending an input to a snapshot that includes it
+    };
+
+    NetLink link;
+
+    explicit CoopClient(const Simulation& world)
+        : world(world), status(Status::CONNECTING), rejectReason(NetReject::SERVER_FULL), slot(0), serverPort(0),
+          lastHello(0), seq(0), newestTick(0), confirmedSeq(0), teleports(-1), itemsVersion(0), clockOffset(0),
+          haveClock(false), history(historySize) {
+        hash = mapHash(world);
+        startState(startBase, world);
+        predicted = world.playerSpawn;
+    }
+
+    ~CoopClient() {
+        if (status == Status::PLAYING) {
+            out.begin(NetPacket::BYE);
+            link.send(out.data(), out.size(), serverAddress, serverPort);
+            link.flush();
+        }
+    }
+
+    bool connect(const sf::IpAddress& address, unsigned short port) {
+        if (!link.bind()) return false;
+        serverAddress = address;
+        serverPort = port;
+        sendHello();
+        return true;
+    }
+
+    // One client tick: reads what the server sent, then, once playing,
+    // predicts and sends this tick's input
+    void tick(const PlayerInput& input) {
+        receivePackets();
+        uint32_t now = NetLink::nowMs();
+        if (status == Status::CONNECTING && now - lastHello >= helloIntervalMs) sendHello();
+        if (status != Status::PLAYING) {
+            link.flush();
+            return;
+        }
+
+        seq++;
+        size_t k = seq % inputWindow;
+        buttons[k] = input.buttons;
+        sentMs[k] = now;
+        predicted = predict(predicted, input);
+        predictedAt[k] = predicted;
+
+        out.begin(NetPacket::INPUT);
+        out.putU32(newestTick);
+        out.putU32(now);
+        out.putU32(seq);
+        uint8_t count = static_cast<uint8_t>(std::min<uint32_t>(seq, inputRedundancy));
+        out.putU8(count);
+        for (uint8_t i = 0; i < count; i++) {
+            out.putU8(buttons[(seq - i) % inputWindow]);
+        }
+        link.send(out.data(), out.size(), serverAddress, serverPort);
+        link.flush();
+    }
+
+    // What to draw this tick, in the same form as a local game's snapshot
+    void capture(SimSnapshot& snapshot) {
+        const NetState* newest = received(newestTick);
+        if (!newest) {
+            snapshot.capture(world); // The map as it starts, until the server says otherwise
+            snapshot.playerPosition = predicted;
+            return;
+        }
+        snapshot.playerPosition = predicted;
+
+        // The two states either side of the render time
+        float renderTick = estimatedTick() - interpolationDelay / Simulation::fixedDt;
+        const NetState* from = nullptr;
+        const NetState* to = nullptr;
+        for (const NetState& state : history) {
+            if (state.tick == 0) continue;
+            if (state.tick <= renderTick) {
+                if (!from || state.tick > from->tick) from = &state;
+            } else if (!to || state.tick < to->tick) {
+                to = &state;
+            }
+        }
+        if (!to) to = from;
+        if (!from || from->values[NetState::TELEPORTS] != to->values[NetState::TELEPORTS]) from = to;
+        float t = to->tick > from->tick ? (renderTick - from->tick) / (to->tick - from->tick) : 1.0f;
+        t = std::max(0.0f, std::min(1.0f, t));
+
+        snapshot.partnerPositions.clear();
+        snapshot.partnerPositions.reserve(NetState::maxPlayers - 1);
+        for (size_t s = 0; s < NetState::maxPlayers; s++) {
+            if (s == slot || !to->playerPresent(s)) continue;
+            sf::Vector2f a = from->playerPresent(s) ? from->player(s) : to->player(s);
+            snapshot.partnerPositions.push_back(lerp(a, to->player(s), t));
+        }
+        snapshot.grannyPositions.resize(to->grannyCount);
+        for (size_t i = 0; i < to->grannyCount; i++) {
+            snapshot.grannyPositions[i] = lerp(from->granny(i), to->granny(i), t);
+        }
+
+        // The rest from the newest state
+        bool itemsChanged = snapshot.itemsCollected.size() != newest->itemCount;
+        snapshot.itemsCollected.resize(newest->itemCount);
+        for (size_t i = 0; i < newest->itemCount; i++) {
+            uint8_t collected = newest->itemCollected(i);
+            itemsChanged |= snapshot.itemsCollected[i] != collected;
+            snapshot.itemsCollected[i] = collected;
+        }
+        if (itemsChanged) itemsVersion++;
+        snapshot.itemsVersion = itemsVersion;
+        snapshot.health = static_cast<float>(newest->values[NetState::HEALTH]);
+        snapshot.day = newest->values[NetState::DAY];
+        snapshot.time = newest->time();
+        snapshot.gameOver = newest->flag(NetState::GAME_OVER);
+        snapshot.gameWon = newest->flag(NetState::GAME_WON);
+        snapshot.catches = static_cast<unsigned>(newest->values[NetState::CATCHES]);
+        snapshot.teleports = static_cast<unsigned>(newest->values[NetState::TELEPORTS]);
+    }
+
+    Status getStatus() const { return status; }
+    NetReject getRejectReason() const { return rejectReason; }
+    size_t getSlot() const { return slot; }
+    const Stats& getStats() const { return stats; }
+    sf::Vector2f predictedPosition() const { return predicted; }
+    uint32_t newestReceived() const { return newestTick; }
+
+    // The state received for tick, while it is still held
+    const NetState* received(uint32_t tick) const {
+        const NetState& state = history[(tick / snapshotInterval) % historySize];
+        return state.tick == tick && tick != 0 ? &state : nullptr;
+    }
+
+private:
+    const Simulation& world;
+    Status status;
+    NetReject rejectReason;
+    size_t slot;
+    sf::IpAddress serverAddress;
+    unsigned short serverPort;
+    uint32_t hash;
+    uint32_t lastHello;
+
+    // Inputs by sequence number, what was predicted after each, and when
+    // each was sent
+    uint32_t seq;
+    uint8_t buttons[inputWindow] = {};
+    sf::Vector2f predictedAt[inputWindow];
+    uint32_t sentMs[inputWindow] = {};
+    sf::Vector2f predicted;
+
+    uint32_t newestTick;
+    uint32_t confirmedSeq;
+    int32_t teleports; // Of the newest snapshot; -1 before the first
+    unsigned itemsVersion;
+
+    // Arrival time minus tick time of snapshots, smoothed: the clock the
+    // interpolation runs on
+    double clockOffset;
+    bool haveClock;
+
+    std::vector<NetState> history;
+    NetState startBase; // Snapshots with no base are deltas from this
+    NetState decoded;
+    PacketWriter out;
+    uint8_t packet[maxPacketSize];
+    Stats stats;
+
+    void sendHello() {
+        lastHello = NetLink::nowMs();
+        out.begin(NetPacket::HELLO);
+        out.putU32(hash);
+        link.send(out.data(), out.size(), serverAddress, serverPort);
+    }
+
+    sf::Vector2f predict(sf::Vector2f position, PlayerInput input) const {
+        const NetState* newest = received(newestTick);
+        if (newest && (newest->flag(NetState::GAME_OVER) || newest->flag(NetState::GAME_WON))) return position;
+        return world.movePlayer(position, world.velocityFor(input), Simulation::fixedDt);
+    }
+
+    float estimatedTick() const {
+        if (!haveClock) return static_cast<float>(newestTick);
+        return static_cast<float>((NetLink::nowMs() - clockOffset) / (1000.0 * Simulation::fixedDt));
+    }
+
+    void receivePackets() {
+        size_t size;
+        sf::IpAddress address;
+        unsigned short port;
+        while (link.receive(packet, size, address, port)) {
+            if (address != serverAddress || port != serverPort) continue;
+            PacketReader in(packet, size);
+            NetPacket type;
+            if (!in.begin(type)) continue;
+            if (type == NetPacket::WELCOME && status == Status::CONNECTING) {
+                uint8_t welcomed = in.getU8();
+                if (!in.ok() || welcomed >= NetState::maxPlayers) continue;
+                slot = welcomed;
+                status = Status::PLAYING;
+            } else if (type == NetPacket::REJECT && status == Status::CONNECTING) {
+                rejectReason = static_cast<NetReject>(in.getU8());
+                if (in.ok()) status = Status::REJECTED;
+            } else if (type == NetPacket::SNAPSHOT && status == Status::PLAYING) {
+                readSnapshot(in);
+            }
+        }
+    }
+
+    void readSnapshot(PacketReader& in) {
+        uint32_t tick = in.getU32();
+        uint32_t baseTick = in.getU32();
+        uint32_t inputSeq = in.getU32();
+        uint32_t echoTime = in.getU32();
+        uint16_t holdTime = in.getU16();
+        uint16_t grannies = in.getU16();
+        uint16_t items = in.getU16();
+        if (!in.ok() || tick == 0 || received(tick)) return;
+        if (grannies != startBase.grannyCount || items != startBase.itemCount) return;
+
+        const NetState* base = baseTick == 0 ? &startBase : received(baseTick);
+        if (!base) {
+            stats.undecodable++;
+            return;
+        }
+        decoded.tick = tick;
+        decoded.grannyCount = grannies;
+        decoded.itemCount = items;
+        decoded.values.assign(base->values.begin(), base->values.end());
+        if (!readDelta(in, decoded)) return;
+        std::swap(history[(tick / snapshotInterval) % historySize], decoded);
+        stats.snapshots++;
+
+        uint32_t now = NetLink::nowMs();
+        double offset = now - tick * (1000.0 * Simulation::fixedDt);
+        clockOffset = haveClock ? clockOffset + (offset - clockOffset) * 0.05 : offset;
+        haveClock = true;
+
+        if (tick < newestTick) {
+            stats.lateSnapshots++;
+            return;
+        }
+        newestTick = tick;
+        if (echoTime != 0 && now - echoTime >= holdTime) {
+            stats.rttMs = static_cast<float>(now - echoTime - holdTime);
+            stats.rttSamples++;
+        }
+        reconcile(*received(tick), inputSeq, now);
+    }
+
+    // Keeps the prediction if the server put the player where it was
+    // predicted to be after inputSeq; otherwise replays the later inputs
+    // from the server's position
+    void reconcile(const NetState& state, uint32_t inputSeq, uint32_t now) {
+        if (inputSeq > seq) return;
+        if (inputSeq > confirmedSeq) {
+            stats.confirmMs = static_cast<float>(now - sentMs[inputSeq % inputWindow]);
+            stats.confirmSamples++;
+            confirmedSeq = inputSeq;
+        }
+        sf::Vector2f server = state.player(slot);
+        bool teleported = state.values[NetState::TELEPORTS] != teleports;
+        teleports = state.values[NetState::TELEPORTS];
+        if (!teleported && inputSeq + inputWindow > seq && inputSeq > 0) {
+            sf::Vector2f expected = predictedAt[inputSeq % inputWindow];
+            if (NetState::quantize(expected.x) == NetState::quantize(server.x) &&
+                NetState::quantize(expected.y) == NetState::quantize(server.y)) {
+                return;
+            }
+        }
+
+        sf::Vector2f position = server;
+        if (inputSeq + inputWindow > seq) {
+            for (uint32_t s = inputSeq + 1; s <= seq; s++) {
+                PlayerInput input;
+                input.buttons = buttons[s % inputWindow];
+                position = predict(position, input);
+                predictedAt[s % inputWindow] = position;
+            }
+        }
+        sf::Vector2f d = position - predicted;
+        float error = std::sqrt(d.x * d.x + d.y * d.y);
+        if (!teleported && error > correctionThreshold) {
+            stats.corrections++;
+            stats.correctionTotal += error;
+            stats.correctionMax = std::max(stats.correctionMax, error);
+        }
+        predicted = position;
+    }
+};
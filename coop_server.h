@@ -0,0 +1,369 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "simulation.h"
+#include "net_protocol.h"
+#include "net_link.h"
+
+// Authoritative co-op server for up to four players. It owns the
+// Simulation and steps it at the fixed rate, applying each client's inputs
+// in order, one per tick. A client whose input has not arrived stands
+// still that tick rather than repeating an old one, so the server moves it
+// exactly as its own prediction did. Every snapshotInterval ticks each
+// client gets a snapshot, delta-encoded against the last state it
+// acknowledged. Each client has its own history of the states it was
+// sent, because when the byte budget runs out, the Grannies farthest from
+// its player are left as they were and sent later. The first client to
+// join plays the Simulation's player; later ones are partners.
+class CoopServer {
+public:
+    static constexpr unsigned short defaultPort = 41230;
+    static constexpr size_t historySize = snapshotHistory; // Sent states kept per client as delta bases
+    static constexpr size_t inputWindow = 64;       // Inputs a client may run ahead of the server
+    static constexpr uint32_t maxQueuedInputs = 6;  // More than this and the oldest are skipped
+    static constexpr uint32_t timeoutMs = 5000;     // Silence before a client is dropped
+    static constexpr size_t snapshotBudget = 900;   // Bytes of field changes per snapshot
+
+    struct ClientStats {
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t packetsSent = 0;
+        uint64_t packetsReceived = 0;
+        uint64_t snapshots = 0;
+        uint64_t fullSnapshots = 0; // With no base the client had
+        uint64_t skippedInputs = 0; // Dropped to keep its queue short
+    };
+
+    static constexpr size_t maxClients = NetState::maxPlayers;
+
+    // Load a level into it before start()
+    Simulation sim;
+    NetLink link;
+
+    CoopServer() : tick(0), catches(0), teleports(0), clients(maxClients) {}
+
+    bool start(unsigned short port = defaultPort) {
+        hash = mapHash(sim);
+        startState(startBase, sim);
+        return link.bind(port);
+    }
+
+    // One server tick: reads every waiting packet, steps the simulation
+    // if anyone is playing, and sends snapshots when one is due
+    void step() {
+        receivePackets();
+        uint32_t now = NetLink::nowMs();
+        for (size_t s = 0; s < clients.size(); s++) {
+            if (clients[s].connected && now - clients[s].lastHeard > timeoutMs) disconnect(s);
+        }
+        if (clientCount() == 0) {
+            link.flush();
+            return;
+        }
+
+        // Next input of every client, in player order
+        PlayerInput inputs[maxClients];
+        for (Client& client : clients) {
+            if (client.connected) inputs[client.player] = nextInput(client);
+        }
+        bool ended = sim.gameOver || sim.gameWon;
+        sim.step(Simulation::fixedDt, inputs[0], sim.partners.empty() ? nullptr : inputs + 1);
+        tick++;
+        if (sim.playerWasCaught) {
+            catches++;
+            teleports++;
+        }
+        if (ended && !sim.gameOver && !sim.gameWon) {
+            teleports++;
+        }
+
+        if (tick % snapshotInterval == 0) {
+            captureTruth();
+            for (size_t s = 0; s < clients.size(); s++) {
+                if (clients[s].connected) sendSnapshot(s);
+            }
+        }
+        link.flush();
+    }
+
+    unsigned clientCount() const {
+        unsigned count = 0;
+        for (const Client& client : clients) count += client.connected;
+        return count;
+    }
+
+    uint32_t currentTick() const { return tick; }
+    bool connected(size_t slot) const { return clients[slot].connected; }
+    const ClientStats& clientStats(size_t slot) const { return clients[slot].stats; }
+
+    // The state sent to a client at tick, while it is still in the history
+    const NetState* sentState(size_t slot, uint32_t sentTick) const {
+        const NetState& state = clients[slot].history[(sentTick / snapshotInterval) % historySize];
+        return state.tick == sentTick && sentTick != 0 ? &state : nullptr;
+    }
+
+private:
+    struct Client {
+        bool connected = false;
+        sf::IpAddress address;
+        unsigned short port = 0;
+        size_t player = 0;        // Simulation player number, 0 or 1 + partner index
+        uint32_t lastHeard = 0;   // NetLink::nowMs()
+
+        // Inputs by sequence number, in a window ahead of the last applied
+        uint32_t newestSeq = 0;
+        uint32_t appliedSeq = 0;
+        uint8_t buttons[inputWindow] = {};
+        uint32_t buttonSeq[inputWindow] = {};
+
+        // Latency: the newest input packet's timestamp, and when it came
+        uint32_t echoTime = 0;
+        uint32_t echoReceived = 0;
+
+        uint32_t ackTick = 0; // Newest snapshot the client has
+        std::vector<NetState> history = std::vector<NetState>(historySize);
+        std::vector<uint32_t> grannyOrder; // Nearest its player first; reused
+        ClientStats stats;
+    };
+
+    uint32_t tick;
+    uint32_t catches;
+    uint32_t teleports;
+    uint32_t hash;
+    std::vector<Client> clients;
+    NetState truth; // This tick's state, before any budget
+    NetState startBase; // The base of snapshots to a client with none
+    PacketWriter out;
+    uint8_t packet[maxPacketSize];
+
+    void receivePackets() {
+        size_t size;
+        sf::IpAddress address;
+        unsigned short port;
+        while (link.receive(packet, size, address, port)) {
+            PacketReader in(packet, size);
+            NetPacket type;
+            if (!in.begin(type)) continue;
+            int s = findClient(address, port);
+            if (type == NetPacket::HELLO) {
+                uint32_t clientHash = in.getU32();
+                if (in.ok()) welcome(s, clientHash, address, port);
+                continue;
+            }
+            if (s < 0) continue;
+            Client& client = clients[s];
+            client.lastHeard = NetLink::nowMs();
+            client.stats.packetsReceived++;
+            client.stats.bytesReceived += size;
+            if (type == NetPacket::BYE) {
+                disconnect(s);
+            } else if (type == NetPacket::INPUT) {
+                readInput(client, in);
+            }
+        }
+    }
+
+    int findClient(const sf::IpAddress& address, unsigned short port) const {
+        for (size_t s = 0; s < clients.size(); s++) {
+            if (clients[s].connected && clients[s].address == address && clients[s].port == port) {
+                return static_cast<int>(s);
+            }
+        }
+        return -1;
+    }
+
+    // Also answers a repeated HELLO, in case the first WELCOME was lost
+    void welcome(int s, uint32_t clientHash, const sf::IpAddress& address, unsigned short port) {
+        if (clientHash != hash) {
+            reject(NetReject::WRONG_MAP, address, port);
+            return;
+        }
+        if (s < 0) {
+            for (size_t free = 0; free < clients.size(); free++) {
+                if (!clients[free].connected) {
+                    s = static_cast<int>(free);
+                    break;
+                }
+            }
+            if (s < 0) {
+                reject(NetReject::SERVER_FULL, address, port);
+                return;
+            }
+            join(s, address, port);
+        }
+        out.begin(NetPacket::WELCOME);
+        out.putU8(static_cast<uint8_t>(s));
+        sendTo(clients[s], out);
+    }
+
+    void reject(NetReject reason, const sf::IpAddress& address, unsigned short port) {
+        out.begin(NetPacket::REJECT);
+        out.putU8(static_cast<uint8_t>(reason));
+        link.send(out.data(), out.size(), address, port);
+    }
+
+    void join(size_t s, const sf::IpAddress& address, unsigned short port) {
+        Client& client = clients[s];
+        bool playerTaken = false;
+        for (const Client& other : clients) {
+            playerTaken |= other.connected && other.player == 0;
+        }
+        if (playerTaken) {
+            sim.addPartner();
+            client.player = sim.partners.size();
+        } else {
+            client.player = 0;
+        }
+        client.connected = true;
+        client.address = address;
+        client.port = port;
+        client.lastHeard = NetLink::nowMs();
+        client.newestSeq = client.appliedSeq = 0;
+        client.ackTick = 0;
+        client.echoTime = client.echoReceived = 0;
+        for (NetState& state : client.history) state.tick = 0;
+        client.stats = ClientStats();
+    }
+
+    // A partner leaving takes its body out of the game; the player's body
+    // stays, for whoever joins next
+    void disconnect(size_t s) {
+        Client& client = clients[s];
+        client.connected = false;
+        if (client.player == 0) return;
+        sim.partners.erase(sim.partners.begin() + static_cast<long>(client.player - 1));
+        for (Client& other : clients) {
+            if (other.connected && other.player > client.player) other.player--;
+        }
+    }
+
+    void readInput(Client& client, PacketReader& in) {
+        uint32_t ackTick = in.getU32();
+        uint32_t sendTime = in.getU32();
+        uint32_t newestSeq = in.getU32();
+        uint8_t count = in.getU8();
+        uint8_t received[255];
+        for (uint8_t k = 0; k < count; k++) {
+            received[k] = in.getU8();
+        }
+        if (!in.ok()) return;
+
+        if (ackTick > client.ackTick && ackTick <= tick) client.ackTick = ackTick;
+        if (sendTime - client.echoTime < 0x80000000u) {
+            client.echoTime = sendTime;
+            client.echoReceived = NetLink::nowMs();
+        }
+        for (uint8_t k = 0; k < count && k < newestSeq; k++) {
+            uint32_t seq = newestSeq - k;
+            if (seq <= client.appliedSeq || seq > client.appliedSeq + inputWindow) continue;
+            client.buttons[seq % inputWindow] = received[k];
+            client.buttonSeq[seq % inputWindow] = seq;
+        }
+        client.newestSeq = std::max(client.newestSeq, std::min<uint32_t>(newestSeq, client.appliedSeq + inputWindow));
+    }
+
+    PlayerInput nextInput(Client& client) {
+        PlayerInput input;
+        if (client.newestSeq - client.appliedSeq > maxQueuedInputs) {
+            uint32_t skip = client.newestSeq - client.appliedSeq - maxQueuedInputs;
+            client.appliedSeq += skip;
+            client.stats.skippedInputs += skip;
+        }
+        uint32_t seq = client.appliedSeq + 1;
+        if (seq <= client.newestSeq && client.buttonSeq[seq % inputWindow] == seq) {
+            input.buttons = client.buttons[seq % inputWindow];
+            client.appliedSeq = seq;
+        } else if (seq <= client.newestSeq) {
+            client.appliedSeq = seq; // Lost with every copy; skip it
+            client.stats.skippedInputs++;
+        }
+        return input;
+    }
+
+    void captureTruth() {
+        truth.reset(static_cast<uint16_t>(sim.grannies.size()), static_cast<uint16_t>(sim.items.size()));
+        truth.tick = tick;
+        truth.values[NetState::HEALTH] = sim.health;
+        truth.values[NetState::DAY] = sim.day;
+        truth.values[NetState::TIME] = static_cast<int32_t>(std::lround(sim.time * NetState::timeScale));
+        truth.values[NetState::FLAGS] = (sim.gameOver ? NetState::GAME_OVER : 0) | (sim.gameWon ? NetState::GAME_WON : 0);
+        truth.values[NetState::CATCHES] = static_cast<int32_t>(catches);
+        truth.values[NetState::TELEPORTS] = static_cast<int32_t>(teleports);
+        for (size_t s = 0; s < clients.size(); s++) {
+            if (clients[s].connected) truth.setPlayer(s, sim.playerPositionAt(clients[s].player), true);
+        }
+        for (size_t i = 0; i < sim.grannies.size(); i++) {
+            truth.setGranny(i, sim.grannies.position[i]);
+        }
+        for (size_t i = 0; i < sim.items.size(); i++) {
+            truth.values[truth.itemField(i)] = sim.items[i].collected;
+        }
+    }
+
+    void sendSnapshot(size_t s) {
+        Client& client = clients[s];
+        const NetState* base = sentState(s, client.ackTick);
+        if (!base || !base->sameShape(truth)) {
+            base = &startBase;
+            client.stats.fullSnapshots++;
+        }
+
+        // Everything but the Grannies always goes; they fill what is left
+        // of the budget, nearest this client's player first
+        NetState& next = client.history[(tick / snapshotInterval) % historySize];
+        next.tick = tick;
+        next.grannyCount = truth.grannyCount;
+        next.itemCount = truth.itemCount;
+        next.values.assign(base->values.begin(), base->values.end());
+        size_t budget = snapshotBudget;
+        auto take = [&](size_t f) {
+            size_t cost = fieldCost(next.values[f], truth.values[f]);
+            budget -= std::min(budget, cost);
+            next.values[f] = truth.values[f];
+        };
+        for (size_t f = 0; f < NetState::grannyField(0); f++) take(f);
+        for (size_t i = 0; i < truth.itemCount; i++) take(truth.itemField(i));
+
+        sf::Vector2f eye = sim.playerPositionAt(client.player);
+        client.grannyOrder.resize(truth.grannyCount);
+        for (uint32_t i = 0; i < truth.grannyCount; i++) client.grannyOrder[i] = i;
+        std::sort(client.grannyOrder.begin(), client.grannyOrder.end(), [&](uint32_t a, uint32_t b) {
+            sf::Vector2f da = sim.grannies.position[a] - eye, db = sim.grannies.position[b] - eye;
+            return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+        });
+        for (uint32_t i : client.grannyOrder) {
+            size_t f = NetState::grannyField(i);
+            size_t cost = fieldCost(next.values[f], truth.values[f]) + fieldCost(next.values[f + 1], truth.values[f + 1]);
+            if (cost > budget) break;
+            take(f);
+            take(f + 1);
+        }
+
+        uint32_t now = NetLink::nowMs();
+        out.begin(NetPacket::SNAPSHOT);
+        out.putU32(tick);
+        out.putU32(base == &startBase ? 0 : base->tick);
+        out.putU32(client.appliedSeq);
+        out.putU32(client.echoTime);
+        out.putU16(static_cast<uint16_t>(std::min<uint32_t>(now - client.echoReceived, 0xffff)));
+        out.putU16(next.grannyCount);
+        out.putU16(next.itemCount);
+        writeDelta(out, *base, next);
+        if (!out.ok()) {
+            next.tick = 0; // Never acknowledged, so never a base
+            return;
+        }
+        sendTo(client, out);
+        client.stats.snapshots++;
+    }
+
+    void sendTo(Client& client, const PacketWriter& packetOut) {
+        link.send(packetOut.data(), packetOut.size(), client.address, client.port);
+        client.stats.packetsSent++;
+        client.stats.bytesSent += packetOut.size();
+    }
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "wall_boxes.h"
+
+// Grid flow field towards a single target (the player). The integration
+// field holds BFS step counts from the target cell around walls, and the
+// direction field stores, per cell, which of the 8 neighbours leads
+// downhill. Agents sample the direction in O(1).
+//
+// A rebuild only starts when the target moves into a new cell, and it is
+// time-sliced: update() processes at most a given number of cells per
+// call. Sampling keeps using the last complete field until the new one is
+// swapped in.
+class FlowField {
+public:
+    static constexpr uint32_t unreachable = 0xffffffffu;
+    static constexpr uint8_t noDirection = 8;
+
+    FlowField() : cellSize(20.0f), columns(0), rows(0), active(0), phase(Phase::IDLE), directionCursor(0),
+                  queueHead(0), queueTail(0), buildTarget(-1), activeTarget(-1), pendingTarget(-1) {}
+
+    // Marks every cell overlapping a wall as blocked. Each wall is
+    // rasterised over the few cells it covers, with the same overlap test
+    // as WallGrid::overlapsBox, so large maps do not pay a query per cell.
+    void build(const std::vector<sf::FloatRect>& walls, const sf::FloatRect& worldBounds, float size = 20.0f) {
+        cellSize = size;
+        origin = sf::Vector2f(worldBounds.left, worldBounds.top);
+        columns = std::max(1, static_cast<int>(std::ceil(worldBounds.width / cellSize)));
+        rows = std::max(1, static_cast<int>(std::ceil(worldBounds.height / cellSize)));
+
+        blocked.assign(columns * rows, 0);
+        for (const auto& wall : walls) {
+            BoxQuery box(wall);
+            // One cell of slack either side; the exact test below decides
+            int x0 = std::max(0, static_cast<int>(std::floor((box.minX - origin.x) / cellSize)) - 1);
+            int y0 = std::max(0, static_cast<int>(std::floor((box.minY - origin.y) / cellSize)) - 1);
+            int x1 = std::min(columns - 1, static_cast<int>(std::floor((box.maxX - origin.x) / cellSize)) + 1);
+            int y1 = std::min(rows - 1, static_cast<int>(std::floor((box.maxY - origin.y) / cellSize)) + 1);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    uint8_t& cellBlocked = blocked[y * columns + x];
+                    if (cellBlocked) continue;
+                    BoxQuery cell(sf::FloatRect(origin.x + x * cellSize, origin.y + y * cellSize, cellSize, cellSize));
+                    cellBlocked = boxOverlapsBox(cell, box.minX, box.minY, box.maxX, box.maxY) ? 1 : 0;
+                }
+            }
+        }
+
+        for (Field& field : fields) {
+            field.integration.assign(columns * rows, unreachable);
+            field.direction.assign(columns * rows, noDirection);
+        }
+        queue.assign(columns * rows, 0);
+        phase = Phase::IDLE;
+        buildTarget = activeTarget = pendingTarget = -1;
+    }
+
+    // Drops the active field and any rebuild in progress, as if no target
+    // had been set since build(); the next field starts from scratch
+    void clear() {
+        active = 0;
+        phase = Phase::IDLE;
+        buildTarget = activeTarget = pendingTarget = -1;
+    }
+
+    // Requests a field towards target; ignored while the target stays in
+    // the same cell as the last requested one
+    void setTarget(sf::Vector2f target) {
+        int cell = cellAt(target);
+        if (cell < 0 || blocked[cell]) return;
+        int latest = pendingTarget >= 0 ? pendingTarget : (phase != Phase::IDLE ? buildTarget : activeTarget);
+        if (cell == latest) return;
+
+        pendingTarget = cell;
+        if (phase == Phase::IDLE) startBuild();
+    }
+
+    // Advances a pending rebuild by at most budget cells (0 = no limit).
+    // Returns true when a new field became active.
+    bool update(size_t budget = 0) {
+        if (phase == Phase::IDLE) return false;
+        if (budget == 0) budget = static_cast<size_t>(columns) * rows * 2;
+        Field& field = building();
+
+        // Integration: breadth-first from the target, 4-connected
+        while (phase == Phase::INTEGRATE && budget > 0) {
+            if (queueHead == queueTail) {
+                phase = Phase::DIRECTIONS;
+                directionCursor = 0;
+                break;
+            }
+            int cell = queue[queueHead++];
+            budget--;
+            int x = cell % columns, y = cell / columns;
+            uint32_t next = field.integration[cell] + 1;
+            const int offsets[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+            for (const auto& offset : offsets) {
+                int nx = x + offset[0], ny = y + offset[1];
+                if (nx < 0 || ny < 0 || nx >= columns || ny >= rows) continue;
+                int neighbour = ny * columns + nx;
+                if (blocked[neighbour] || field.integration[neighbour] != unreachable) continue;
+                field.integration[neighbour] = next;
+                queue[queueTail++] = neighbour;
+            }
+        }
+
+        // Directions: steepest descent over 8 neighbours without cutting corners
+        while (phase == Phase::DIRECTIONS && budget > 0) {
+            size_t end = std::min(directionCursor + budget, field.direction.size());
+            for (size_t cell = directionCursor; cell < end; cell++) {
+                field.direction[cell] = downhill(field, static_cast<int>(cell));
+            }
+            budget -= end - directionCursor;
+            directionCursor = end;
+            if (directionCursor == field.direction.size()) {
+                active = 1 - active;
+                activeTarget = buildTarget;
+                phase = Phase::IDLE;
+                if (pendingTarget >= 0) startBuild();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ready() const { return activeTarget >= 0; }
+    bool rebuilding() const { return phase != Phase::IDLE; }
+
+    // Unit direction towards the target, or (0, 0) when position is outside
+    // the field, blocked, unreachable or already in the target cell
+    sf::Vector2f direction(sf::Vector2f position) const {
+        int cell = cellAt(position);
+        if (cell < 0 || activeTarget < 0) return sf::Vector2f(0, 0);
+        return directionVectors()[fields[active].direction[cell]];
+    }
+
+    // BFS steps to the target, or unreachable
+    uint32_t distance(sf::Vector2f position) const {
+        int cell = cellAt(position);
+        if (cell < 0 || activeTarget < 0) return unreachable;
+        return fields[active].integration[cell];
+    }
+
+    size_t cellCount() const { return blocked.size(); }
+
+private:
+    enum class Phase : uint8_t { IDLE, INTEGRATE, DIRECTIONS };
+
+    struct Field {
+        std::vector<uint32_t> integration;
+        std::vector<uint8_t> direction;
+    };
+
+    float cellSize;
+    sf::Vector2f origin;
+    int columns;
+    int rows;
+    std::vector<uint8_t> blocked;
+
+    // Double-buffered so agents keep sampling a complete field mid-rebuild
+    Field fields[2];
+    int active;
+
+    Phase phase;
+    size_t directionCursor;
+    std::vector<int> queue;
+    size_t queueHead;
+    size_t queueTail;
+    int buildTarget;
+    int activeTarget;
+    int pendingTarget;
+
+    Field& building() { return fields[1 - active]; }
+
+    void startBuild() {
+        Field& field = building();
+        std::fill(field.integration.begin(), field.integration.end(), unreachable);
+        buildTarget = pendingTarget;
+        pendingTarget = -1;
+        field.integration[buildTarget] = 0;
+        queue[0] = buildTarget;
+        queueHead = 0;
+        queueTail = 1;
+        phase = Phase::INTEGRATE;
+    }
+
+    int cellAt(sf::Vector2f position) const {
+        if (columns == 0) return -1;
+        int x = static_cast<int>(std::floor((position.x - origin.x) / cellSize));
+        int y = static_cast<int>(std::floor((position.y - origin.y) / cellSize));
+        if (x < 0 || y < 0 || x >= columns || y >= rows) return -1;
+        return y * columns + x;
+    }
+
+    uint8_t downhill(const Field& field, int cell) const {
+        uint32_t best = field.integration[cell];
+        if (best == unreachable || best == 0) return noDirection;
+
+        static const int offsets[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+        int x = cell % columns, y = cell / columns;
+        uint8_t result = noDirection;
+        for (uint8_t d = 0; d < 8; d++) {
+            int nx = x + offsets[d][0], ny = y + offsets[d][1];
+            if (nx < 0 || ny < 0 || nx >= columns || ny >= rows) continue;
+            if (offsets[d][0] != 0 && offsets[d][1] != 0 &&
+                (blocked[y * columns + nx] || blocked[ny * columns + x])) continue;
+            uint32_t value = field.integration[ny * columns + nx];
+            if (value < best) {
+                best = value;
+                result = d;
+            }
+        }
+        return result;
+    }
+
+    static const sf::Vector2f* directionVectors() {
+        static const float diagonal = 0.70710678f;
+        static const sf::Vector2f vectors[9] = {
+            {1, 0}, {diagonal, diagonal}, {0, 1}, {-diagonal, diagonal},
+            {-1, 0}, {-diagonal, -diagonal}, {0, -1}, {diagonal, -diagonal}, {0, 0}
+        };
+        return vectors;
+    }
+};
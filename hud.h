@@ -0,0 +1,160 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <iostream>
+
+// What the HUD displays, reduced to the precision it is shown at. The
+// cached texture is redrawn only when one of these changes.
+struct HudState {
+    int day = 0;
+    int minuteOfDay = 0;
+    int healthWidth = 0; // Health bar length in pixels
+    bool gameOver = false;
+    bool gameWon = false;
+    const sf::Font* font = nullptr;
+
+    bool operator==(const HudState& other) const {
+        return day == other.day && minuteOfDay == other.minuteOfDay && healthWidth == other.healthWidth &&
+               gameOver == other.gameOver && gameWon == other.gameWon && font == other.font;
+    }
+    bool operator!=(const HudState& other) const { return !(*this == other); }
+};
+
+// Retained UI layer: clock, health bar, inventory slots and end screens
+// are rendered into one texture when their values change, and each frame
+// draws that texture as a single quad. Redraws do not allocate: the clock
+// is written into a fixed-width string and the end texts are set once.
+class Hud : public sf::Drawable {
+public:
+    // Characters in the clock text; shorter times are padded with spaces
+    static constexpr size_t clockLength = 24;
+
+    Hud() : valid(false), redraws(0), clockString(std::string(clockLength, ' ')) {}
+
+    bool create(unsigned width, unsigned height) {
+        if (!layer.create(width, height)) {
+            std::cerr << "Failed to create HUD texture\n";
+            return false;
+        }
+        sprite.setTexture(layer.getTexture(), true);
+
+        // Day text
+        dayText.setCharacterSize(20);
+        dayText.setFillColor(sf::Color::White);
+        dayText.setPosition(20, 20);
+
+        // Health bar
+        healthBarBackground.setSize(sf::Vector2f(200, 20));
+        healthBarBackground.setPosition(20, 50);
+        healthBarBackground.setFillColor(sf::Color(50, 50, 50));
+
+        healthBar.setSize(sf::Vector2f(200, 20));
+        healthBar.setPosition(20, 50);
+        healthBar.setFillColor(sf::Color::Red);
+
+        // Inventory slots
+        for (int i = 0; i < 5; i++) {
+            sf::RectangleShape slot;
+            slot.setSize(sf::Vector2f(40, 40));
+            slot.setPosition(980 + i * 50, 750);
+            slot.setFillColor(sf::Color(50, 50, 50));
+            slot.setOutlineThickness(2);
+            slot.setOutlineColor(sf::Color::White);
+            inventorySlots.push_back(slot);
+        }
+
+        // End screens
+        overlay.setSize(sf::Vector2f(static_cast<float>(width), static_cast<float>(height)));
+        overlay.setFillColor(sf::Color(0, 0, 0, 200));
+
+        gameOverText.setCharacterSize(48);
+        gameOverText.setStyle(sf::Text::Bold);
+        gameOverText.setString("GAME OVER\nGranny caught you!\nPress R to restart");
+        gameOverText.setFillColor(sf::Color::Red);
+        gameOverText.setPosition(400, 300);
+
+        wonText.setCharacterSize(48);
+        wonText.setStyle(sf::Text::Bold);
+        wonText.setString("YOU ESCAPED!\nYou survived Granny's house!\nPress R to play again");
+        wonText.setFillColor(sf::Color::Green);
+        wonText.setPosition(350, 300);
+
+        valid = false;
+        return true;
+    }
+
+    // Redraws the layer if anything shown has changed
+    void update(const HudState& state) {
+        if (valid && state == shown) return;
+        shown = state;
+        valid = true;
+        redraws++;
+        redraw();
+    }
+
+    // Times the layer has been rendered, for the profiler overlay
+    unsigned redrawCount() const { return redraws; }
+
+private:
+    sf::RenderTexture layer;
+    sf::Sprite sprite;
+    HudState shown;
+    bool valid;
+    unsigned redraws;
+
+    sf::Text dayText;
+    sf::RectangleShape healthBar;
+    sf::RectangleShape healthBarBackground;
+    std::vector<sf::RectangleShape> inventorySlots;
+    sf::RectangleShape overlay;
+    sf::Text gameOverText;
+    sf::Text wonText;
+    sf::String clockString; // Always clockLength characters
+
+    void redraw() {
+        int hours = shown.minuteOfDay / 60;
+        int minutes = shown.minuteOfDay % 60;
+        int displayHours = hours % 12;
+        if (displayHours == 0) displayHours = 12;
+        char clock[clockLength + 1];
+        int length = std::snprintf(clock, sizeof(clock), "Day %d - %d:%02d %s", shown.day, displayHours, minutes,
+                                   hours >= 12 ? "PM" : "AM");
+        for (size_t i = 0; i < clockLength; i++) {
+            clockString[i] = i < static_cast<size_t>(length) ? static_cast<sf::Uint32>(clock[i]) : ' ';
+        }
+
+        layer.clear(sf::Color::Transparent);
+        if (shown.font) {
+            dayText.setFont(*shown.font);
+            dayText.setString(clockString);
+        }
+        healthBar.setSize(sf::Vector2f(static_cast<float>(shown.healthWidth), 20));
+
+        layer.draw(healthBarBackground);
+        layer.draw(healthBar);
+        if (shown.font) layer.draw(dayText);
+        for (const auto& slot : inventorySlots) {
+            layer.draw(slot);
+        }
+
+        if (shown.gameOver || shown.gameWon) {
+            layer.draw(overlay);
+            if (shown.font) {
+                sf::Text& endText = shown.gameOver ? gameOverText : wonText;
+                endText.setFont(*shown.font);
+                layer.draw(endText);
+            }
+        }
+        layer.display();
+    }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override {
+        // The layer was cleared to transparent and blended into, so its
+        // colors are already multiplied by alpha
+        states.blendMode = sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha);
+        target.draw(sprite, states);
+    }
+};
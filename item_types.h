@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Collectible item kinds. Stored as this one-byte id everywhere (items,
+// level files, sprite lookup); names only appear in level sources.
+enum class ItemType : uint8_t {
+    KEY,
+    HAMMER,
+    SCREWDRIVER,
+    BATTERY,
+    MASTER_KEY,
+    COUNT
+};
+
+inline const char* itemTypeName(ItemType type) {
+    static const char* const names[] = {"key", "hammer", "screwdriver", "battery", "master_key"};
+    return names[static_cast<size_t>(type)];
+}
+
+inline bool itemTypeFromName(const std::string& name, ItemType& type) {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ItemType::COUNT); i++) {
+        if (name == itemTypeName(static_cast<ItemType>(i))) {
+            type = static_cast<ItemType>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// Fixed pool of worker threads with one job queue each. A thread pops work
+// from the back of its own queue and, when that runs dry, steals from the
+// front of the others, so uneven ranges balance out. Queues are fixed-size
+// rings and jobs are a function pointer plus context, so dispatch does not
+// allocate.
+class JobSystem {
+public:
+    // threadCount includes the calling thread, which helps while it waits
+    explicit JobSystem(unsigned threadCount = std::thread::hardware_concurrency())
+        : pending(0), stopping(false) {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned i = 0; i < threadCount; i++) {
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (unsigned i = 1; i < threadCount; i++) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned threadCount() const {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    // Calls fn(begin, end) over [0, count) in chunks of at least grain items
+    // and returns once every chunk has run. Must be called from one thread
+    // at a time (the simulation thread).
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, Fn&& fn) {
+        if (count == 0) return;
+        grain = std::max<size_t>(1, grain);
+        size_t chunks = (count + grain - 1) / grain;
+        if (workers.empty() || chunks == 1) {
+            fn(size_t(0), count);
+            return;
+        }
+
+        // Never queue more chunks than the rings can hold
+        chunks = std::min(chunks, queues.size() * (queueCapacity / 2));
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        chunks = (count + chunkSize - 1) / chunkSize;
+
+        std::atomic<size_t> remaining(chunks);
+        Job job;
+        job.run = [](void* context, size_t begin, size_t end) {
+            (*static_cast<typename std::remove_reference<Fn>::type*>(context))(begin, end);
+        };
+        job.context = const_cast<void*>(static_cast<const void*>(&fn));
+        job.remaining = &remaining;
+
+        // Deal chunks round-robin so every thread starts with local work
+        pending.fetch_add(chunks);
+        for (size_t c = 0; c < chunks; c++) {
+            job.begin = c * chunkSize;
+            job.end = std::min(count, job.begin + chunkSize);
+            push(c % queues.size(), job);
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_all();
+
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!runOne(0)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    static constexpr size_t queueCapacity = 256;
+
+    struct Job {
+        void (*run)(void*, size_t, size_t);
+        void* context;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* remaining;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        Job jobs[queueCapacity];
+        size_t head = 0; // Next job to steal
+        size_t tail = 0; // One past the newest job
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending;
+    bool stopping;
+
+    void push(size_t queueIndex, const Job& job) {
+        Queue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs[queue.tail % queueCapacity] = job;
+        queue.tail++;
+    }
+
+    bool popOwn(size_t queueIndex, Job& job) {
+        Queue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head == queue.tail) return false;
+        queue.tail--;
+        job = queue.jobs[queue.tail % queueCapacity];
+        return true;
+    }
+
+    bool steal(size_t queueIndex, Job& job) {
+        Queue& queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head == queue.tail) return false;
+        job = queue.jobs[queue.head % queueCapacity];
+        queue.head++;
+        return true;
+    }
+
+    // Runs one job from our own queue or a victim's; false when all are empty
+    bool runOne(size_t self) {
+        Job job;
+        bool found = popOwn(self, job);
+        for (size_t i = 1; !found && i < queues.size(); i++) {
+            found = steal((self + i) % queues.size(), job);
+        }
+        if (!found) return false;
+
+        pending.fetch_sub(1);
+        job.run(job.context, job.begin, job.end);
+        job.remaining->fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void workerLoop(size_t self) {
+        while (true) {
+            if (runOne(self)) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending.load() > 0; });
+            if (stopping) return;
+        }
+    }
+};
@@ -0,0 +1,142 @@
+// Level compiler: turns a text level description (see levels/house.txt)
+// into the binary format read by LevelFile, or generates a large grid
+// house for load-time testing.
+//
+//   g++ -std=c++17 -O2 level_compiler.c -o level_compiler
+//   ./level_compiler levels/house.txt levels/house.lvl
+//   ./level_compiler --grid 10000 big.lvl
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "level_file.h"
+#include "item_types.h"
+#include "rng.h"
+
+// Same walls as Simulation::createRoom()
+void addRoom(LevelData& level, const sf::FloatRect& room) {
+    level.rooms.push_back(room);
+    level.walls.push_back(sf::FloatRect(room.left, room.top, room.width, 20));
+    level.walls.push_back(sf::FloatRect(room.left, room.top + room.height - 20, room.width, 20));
+    level.walls.push_back(sf::FloatRect(room.left, room.top, 20, room.height));
+    level.walls.push_back(sf::FloatRect(room.left + room.width - 20, room.top, 20, room.height));
+}
+
+LevelItem makeItem(ItemType type, float x, float y) {
+    LevelItem item;
+    item.type = static_cast<uint32_t>(type);
+    item.x = x;
+    item.y = y;
+    return item;
+}
+
+bool parseLevel(const char* filename, LevelData& level) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "Failed to open " << filename << "\n";
+        return false;
+    }
+
+    level.worldBounds = sf::FloatRect(0, 0, 1200, 800);
+    level.playerSpawn = sf::Vector2f(100, 100);
+    level.exitArea = sf::FloatRect(1000, 0, 200, 100);
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword)) continue;
+
+        sf::FloatRect rect;
+        sf::Vector2f point;
+        std::string name;
+        ItemType type;
+        bool ok = true;
+        if (keyword == "world") {
+            ok = static_cast<bool>(in >> level.worldBounds.width >> level.worldBounds.height);
+        } else if (keyword == "player") {
+            ok = static_cast<bool>(in >> level.playerSpawn.x >> level.playerSpawn.y);
+        } else if (keyword == "exit") {
+            ok = static_cast<bool>(in >> rect.left >> rect.top >> rect.width >> rect.height);
+            level.exitArea = rect;
+        } else if (keyword == "room" || keyword == "wall" || keyword == "door" || keyword == "closet") {
+            ok = static_cast<bool>(in >> rect.left >> rect.top >> rect.width >> rect.height);
+            if (keyword == "room") addRoom(level, rect);
+            else if (keyword == "wall") level.walls.push_back(rect);
+            else if (keyword == "door") level.doors.push_back(rect);
+            else level.hidingSpots.push_back(rect);
+        } else if (keyword == "item") {
+            ok = static_cast<bool>(in >> name >> point.x >> point.y) && itemTypeFromName(name, type);
+            if (ok) level.items.push_back(makeItem(type, point.x, point.y));
+        } else if (keyword == "granny") {
+            ok = static_cast<bool>(in >> point.x >> point.y);
+            level.grannySpawns.push_back(point);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::cerr << filename << ":" << lineNumber << ": cannot read \"" << line << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rooms on a square grid, 300 px rooms with 50 px gaps, each joined to its
+// right and lower neighbours; items and Grannies are scattered over rooms
+void generateGrid(int roomCount, LevelData& level) {
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(roomCount))));
+    int rows = (roomCount + columns - 1) / columns;
+    level.worldBounds = sf::FloatRect(0, 0, columns * 350.0f + 50, rows * 350.0f + 50);
+    level.playerSpawn = sf::Vector2f(100, 100);
+    level.exitArea = sf::FloatRect(level.worldBounds.width - 200, 0, 200, 100);
+
+    for (int i = 0; i < roomCount; i++) {
+        sf::FloatRect room(50 + (i % columns) * 350.0f, 50 + (i / columns) * 350.0f, 300, 300);
+        addRoom(level, room);
+        if (i % columns + 1 < columns && i + 1 < roomCount) {
+            level.doors.push_back(sf::FloatRect(room.left + room.width + 15, room.top + 120, 20, 60));
+        }
+        if (i + columns < roomCount) {
+            level.doors.push_back(sf::FloatRect(room.left + 120, room.top + room.height + 15, 60, 20));
+        }
+        if (i % 7 == 3) {
+            level.hidingSpots.push_back(sf::FloatRect(room.left + 30, room.top + 30, 80, 100));
+        }
+    }
+
+    Rng rng(2024);
+    for (uint8_t type = 0; type < static_cast<uint8_t>(ItemType::COUNT); type++) {
+        const sf::FloatRect& room = level.rooms[rng.nextInt(roomCount)];
+        level.items.push_back(makeItem(static_cast<ItemType>(type), room.left + 140, room.top + 140));
+    }
+    for (int i = 0; i < std::max(1, roomCount / 100); i++) {
+        const sf::FloatRect& room = level.rooms[rng.nextInt(roomCount)];
+        level.grannySpawns.push_back(sf::Vector2f(room.left + 130, room.top + 120));
+    }
+}
+
+int main(int argc, char** argv) {
+    LevelData level;
+    if (argc == 4 && std::strcmp(argv[1], "--grid") == 0 && std::atoi(argv[2]) > 0) {
+        generateGrid(std::atoi(argv[2]), level);
+    } else if (argc == 3) {
+        if (!parseLevel(argv[1], level)) return 1;
+    } else {
+        std::cerr << "usage: " << argv[0] << " input.txt output.lvl | --grid rooms output.lvl\n";
+        return 1;
+    }
+
+    const char* output = argv[argc - 1];
+    if (!writeLevelFile(output, level)) return 1;
+    std::cout << output << ": " << level.rooms.size() << " rooms, " << level.walls.size() << " walls, "
+              << level.doors.size() << " doors, " << level.hidingSpots.size() << " closets, "
+              << level.items.size() << " items, " << level.grannySpawns.size() << " grannies\n";
+    return 0;
+}
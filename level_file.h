@@ -0,0 +1,235 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define LEVEL_FILE_MMAP 1
+#endif
+
+// Compiled level, as written by level_compiler. A fixed header is followed
+// by flat arrays that are used in place: rectangles are four floats laid
+// out like sf::FloatRect, so a section is read as one block.
+//
+//   LevelHeader
+//   rooms[roomCount]        sf::FloatRect
+//   walls[wallCount]        sf::FloatRect
+//   doors[doorCount]        sf::FloatRect
+//   hidingSpots[...]        sf::FloatRect
+//   items[itemCount]        LevelItem
+//   grannySpawns[...]       sf::Vector2f
+struct LevelHeader {
+    char magic[4]; // "L3LV"
+    uint32_t version;
+    float worldWidth;
+    float worldHeight;
+    float playerSpawnX;
+    float playerSpawnY;
+    float exitX; // Area the player escapes through
+    float exitY;
+    float exitWidth;
+    float exitHeight;
+    uint32_t roomCount;
+    uint32_t wallCount;
+    uint32_t doorCount;
+    uint32_t hidingSpotCount;
+    uint32_t itemCount;
+    uint32_t grannySpawnCount;
+};
+
+struct LevelItem {
+    uint32_t type; // ItemType
+    float x;
+    float y;
+};
+
+static_assert(sizeof(sf::FloatRect) == 4 * sizeof(float), "level rects are stored as sf::FloatRect");
+static_assert(sizeof(sf::Vector2f) == 2 * sizeof(float), "level points are stored as sf::Vector2f");
+
+// Read-only view of a level file. Memory-mapped where the platform allows,
+// otherwise read into one buffer; either way the accessors point straight
+// into the file's bytes.
+class LevelFile {
+public:
+    static constexpr uint32_t version = 2;
+
+    LevelFile() : data(nullptr), size(0), mapped(false) {}
+
+    ~LevelFile() {
+        close();
+    }
+
+    LevelFile(const LevelFile&) = delete;
+    LevelFile& operator=(const LevelFile&) = delete;
+
+    bool loadFromFile(const std::string& filename) {
+        close();
+        if (!map(filename)) {
+            std::cerr << "Failed to open level " << filename << "\n";
+            return false;
+        }
+        if (!validate()) {
+            std::cerr << "Level " << filename << " is not a valid version " << version << " level\n";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    const LevelHeader& header() const { return *reinterpret_cast<const LevelHeader*>(data); }
+
+    sf::FloatRect worldBounds() const { return sf::FloatRect(0, 0, header().worldWidth, header().worldHeight); }
+    sf::Vector2f playerSpawn() const { return sf::Vector2f(header().playerSpawnX, header().playerSpawnY); }
+
+    const sf::FloatRect* rooms() const { return section<sf::FloatRect>(0); }
+    const sf::FloatRect* walls() const { return rooms() + header().roomCount; }
+    const sf::FloatRect* doors() const { return walls() + header().wallCount; }
+    const sf::FloatRect* hidingSpots() const { return doors() + header().doorCount; }
+    const LevelItem* items() const {
+        return reinterpret_cast<const LevelItem*>(hidingSpots() + header().hidingSpotCount);
+    }
+    const sf::Vector2f* grannySpawns() const {
+        return reinterpret_cast<const sf::Vector2f*>(items() + header().itemCount);
+    }
+
+    // FNV-1a over the whole file, so a replay can tell which level it was
+    // recorded on. Never 0, which stands for the built-in house.
+    uint64_t contentHash() const {
+        uint64_t hash = 14695981039346656037ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    bool mapped;
+    std::vector<char> buffer; // Used when the file could not be mapped
+
+    template <typename T>
+    const T* section(size_t offset) const {
+        return reinterpret_cast<const T*>(data + sizeof(LevelHeader) + offset);
+    }
+
+    static uint64_t expectedSize(const LevelHeader& h) {
+        uint64_t rects = static_cast<uint64_t>(h.roomCount) + h.wallCount + h.doorCount + h.hidingSpotCount;
+        return sizeof(LevelHeader) + rects * sizeof(sf::FloatRect) +
+               static_cast<uint64_t>(h.itemCount) * sizeof(LevelItem) +
+               static_cast<uint64_t>(h.grannySpawnCount) * sizeof(sf::Vector2f);
+    }
+
+    bool validate() const {
+        if (size < sizeof(LevelHeader)) return false;
+        const LevelHeader& h = header();
+        return std::memcmp(h.magic, "L3LV", 4) == 0 && h.version == version && expectedSize(h) == size;
+    }
+
+    bool map(const std::string& filename) {
+#ifdef LEVEL_FILE_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                void* view = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED) {
+                    data = static_cast<const char*>(view);
+                    size = static_cast<size_t>(info.st_size);
+                    mapped = true;
+                }
+            }
+            ::close(fd);
+            if (mapped) return true;
+        }
+#endif
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!file) return false;
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+    }
+
+    void close() {
+#ifdef LEVEL_FILE_MMAP
+        if (mapped) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        buffer.clear();
+    }
+};
+
+// Level contents to write; the compiler fills this from a text description
+struct LevelData {
+    sf::FloatRect worldBounds;
+    sf::Vector2f playerSpawn;
+    sf::FloatRect exitArea;
+    std::vector<sf::FloatRect> rooms;
+    std::vector<sf::FloatRect> walls;
+    std::vector<sf::FloatRect> doors;
+    std::vector<sf::FloatRect> hidingSpots;
+    std::vector<LevelItem> items;
+    std::vector<sf::Vector2f> grannySpawns;
+};
+
+inline bool writeLevelFile(const std::string& filename, const LevelData& level) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open level " << filename << " for writing\n";
+        return false;
+    }
+
+    LevelHeader header;
+    std::memcpy(header.magic, "L3LV", 4);
+    header.version = LevelFile::version;
+    header.worldWidth = level.worldBounds.width;
+    header.worldHeight = level.worldBounds.height;
+    header.playerSpawnX = level.playerSpawn.x;
+    header.playerSpawnY = level.playerSpawn.y;
+    header.exitX = level.exitArea.left;
+    header.exitY = level.exitArea.top;
+    header.exitWidth = level.exitArea.width;
+    header.exitHeight = level.exitArea.height;
+    header.roomCount = static_cast<uint32_t>(level.rooms.size());
+    header.wallCount = static_cast<uint32_t>(level.walls.size());
+    header.doorCount = static_cast<uint32_t>(level.doors.size());
+    header.hidingSpotCount = static_cast<uint32_t>(level.hidingSpots.size());
+    header.itemCount = static_cast<uint32_t>(level.items.size());
+    header.grannySpawnCount = static_cast<uint32_t>(level.grannySpawns.size());
+
+    auto writeArray = [&file](const auto& values) {
+        file.write(reinterpret_cast<const char*>(values.data()),
+                   static_cast<std::streamsize>(values.size() * sizeof(values[0])));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(level.rooms);
+    writeArray(level.walls);
+    writeArray(level.doors);
+    writeArray(level.hidingSpots);
+    writeArray(level.items);
+    writeArray(level.grannySpawns);
+    if (!file) {
+        std::cerr << "Failed to write level " << filename << "\n";
+        return false;
+    }
+    return true;
+}
@@ -4,75 +4,213 @@
 #include <vector>
 #include <cmath>
 #include <string>
-#include <map>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include <random>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include "simulation.h"
+#include "render_batch.h"
+#include "world_stream.h"
+#include "replay.h"
+#include "sim_snapshot.h"
+#include "save_state.h"
+#include "triple_buffer.h"
+#include "profiler.h"
+#include "resource_cache.h"
+#include "sprite_atlas.h"
+#include "hud.h"
+#include "minimap.h"
+#include "visibility.h"
+#include "raycaster.h"
+#include "job_system.h"
+#include "coop_server.h"
+#include "coop_client.h"
+#ifdef COUNT_ALLOCATIONS
+#include "alloc_counter.h"
+#endif
 
 class Game {
 private:
+    // Started before anything else, to time the first frame and asset loads
+    sf::Clock startupClock;
+    bool firstFrameShown;
+    bool assetsReady;
+    
     sf::RenderWindow window;
     sf::View gameView;
     sf::View uiView;
     
-    // Player
-    sf::RectangleShape player;
-    sf::Vector2f playerVelocity;
-    bool onGround;
-    float playerSpeed;
-    int health;
-    
-    // Granny
-    sf::RectangleShape granny;
-    sf::Texture grannyTexture;
-    sf::Vector2f grannyVelocity;
-    float grannySpeed;
-    enum class GrannyState { PATROL, CHASE, SEARCH };
-    GrannyState grannyState;
-    float awareness;
-    sf::Vector2f lastSeenPosition;
-    float searchTimer;
-    
-    // Map
-    std::vector<sf::RectangleShape> walls;
-    std::vector<sf::RectangleShape> doors;
-    std::vector<sf::RectangleShape> hidingSpots;
-    
-    // Items
-    struct Item {
-        sf::RectangleShape shape;
-        std::string type;
-        bool collected;
-        sf::Texture texture;
-    };
-    std::vector<Item> items;
+    // Simulation state (player, Granny, map, items, time). In pipelined
+    // mode only the simulation thread touches it after load.
+    Simulation sim;
+    
+    // Granny updates for big hordes, split across cores. Separate from
+    // renderJobs: a job system takes work from one thread at a time, and
+    // in pipelined mode the simulation has a thread of its own.
+    std::unique_ptr<JobSystem> simJobs;
+    
+    // The renderer draws from the two latest snapshots, blending positions
+    SimSnapshot previous;
+    SimSnapshot current;
+    sf::Vector2f playerDrawPosition;
+    std::vector<sf::Vector2f> grannyDrawPositions; // Only kept for the minimap and first person
+    float grannyBlend;
+    std::vector<sf::Vector2f> partnerDrawPositions;
+    unsigned catchesHeard;
+    
+    // Pipelined mode: the simulation ticks on its own thread and hands
+    // snapshots to the renderer through a lock-free triple buffer
+    TripleBuffer<SimSnapshot> snapshots;
+    std::atomic<bool> simulationRunning;
+    
+    // Counted on the simulation side and copied into every snapshot
+    uint64_t tickCount;
+    unsigned catches;
+    unsigned teleports;
+    
+    // Every sprite (items, Granny, player, closets) lives in one atlas, so
+    // the map and the dynamic layer each draw with a single texture
+    SpriteAtlas atlas;
+    ResourceHandle<sf::Image> grannyFace; // Plain magenta until loaded
+    
+    // Map (walls, doors and closets), streamed in chunks around the view
+    // and baked on a background thread, so only the ones near it are held
+    WorldStream mapStream;
+    CullCounts mapCulling;
+    CullCounts spriteCulling;
+    
+    // Items, Grannies and player, rebuilt every frame
+    sf::VertexArray dynamicGeometry;
+    
+    // Darkness: everything outside the player's lantern glow and flashlight
+    // cone is masked; both are visibility polygons against the walls
+    VisibilityPolygon lantern;
+    VisibilityPolygon flashlight;
+    sf::RenderTexture darkness;
+    sf::Sprite darknessSprite;
+    sf::VertexArray lightGeometry;
+    float playerFacing; // Radians, the way the player last moved
+    
+    // First-person view (V): raycast on the CPU, columns and rows split
+    // across renderJobs, and uploaded as one texture each frame.
+    // renderJobs is started the first time the view is drawn, with the
+    // cores simJobs left over.
+    Raycaster raycaster;
+    std::unique_ptr<JobSystem> renderJobs;
+    sf::Texture viewTexture;
+    sf::Sprite viewSprite;
+    std::vector<Raycaster::Billboard> billboards; // Reused every frame
+    bool firstPerson;
     
     // Game state
-    int day;
-    float time;
-    bool gameOver;
-    bool gameWon;
     bool mapVisible;
     
     // UI
-    sf::Font font;
-    sf::Text dayText;
-    sf::RectangleShape healthBar;
-    sf::RectangleShape healthBarBackground;
-    sf::RectangleShape miniMap;
-    std::vector<sf::RectangleShape> inventorySlots;
+    ResourceHandle<sf::Font> font;
+    sf::Font placeholderFont; // Empty; text stays blank until the font loads
+    Hud hud;
+    MiniMap miniMap; // M; fog clears within fogRevealRadius of the player
+    
+    // Input: buttons held right now, plus a restart request for the next
+    // tick. Written by the event loop, read by whichever thread simulates.
+    std::atomic<uint8_t> heldButtons;
+    std::atomic<bool> restartRequested;
+    
+    // Every tick's input is recorded; a loaded replay feeds it back instead
+    Replay replay;
+    std::string recordFile;
+    bool replaying;
+    size_t replayTick;
+    
+    // F5 saves, F9 loads and holding Backspace rewinds a tick per tick
+    // through the last ten seconds; all three happen between ticks
+    SaveState quickSave;
+    SaveState rewindState;
+    RewindBuffer rewindBuffer;
+    bool rewindWarned; // Said once that a state was too big to keep
+    std::atomic<bool> quickSaveRequested;
+    std::atomic<bool> quickLoadRequested;
+    std::atomic<bool> rewindHeld;
+    
+    // Co-op (--host or --join): this game becomes a client, and sim only
+    // holds the map. A host also runs the server, on its own thread.
+    std::unique_ptr<CoopServer> server;
+    std::thread serverThread;
+    std::atomic<bool> serverRunning;
+    std::unique_ptr<CoopClient> client;
+    
+    // Frame profiler; F3 shows per-phase timings, dumped to files on exit
+    Profiler profiler;
+    bool profilerVisible;
+    sf::Clock profilerRefresh;
+    sf::RectangleShape profilerBackground;
+    sf::Text profilerText;
+    sf::String profilerString; // Always profilerLength characters, so updates do not allocate
     
-    // Input
-    std::map<sf::Keyboard::Key, bool> keys;
+    // Assets are decoded on loader threads and swapped in as they arrive
+    ResourceCache resources;
     
     // Sounds
-    sf::SoundBuffer jumpScareBuffer;
+    ResourceHandle<sf::SoundBuffer> jumpScareBuffer;
     sf::Sound jumpScareSound;
     
+    // Upper bound on the wall-clock time fed to the fixed-step loop per frame
+    static constexpr float maxFrameTime = 0.25f;
+    static constexpr size_t parallelGrannies = 1000; // Fewer update serially; too little work to split
+    static constexpr float fogRevealRadius = 300.0f;
+    static constexpr float cullMargin = 64.0f; // Beyond the view edges
+    // Snapshots further apart than this snap Grannies instead of blending,
+    // so a drawn Granny is never far from where current's grid puts it
+    static constexpr uint64_t grannyBlendTicks = 8;
+    static constexpr float lanternRadius = 120.0f;
+    static constexpr float flashlightRadius = 320.0f;
+    static constexpr float batteryFlashlightRadius = 560.0f; // Once the battery is picked up
+    static constexpr float flashlightHalfAngle = 0.55f;
+    static constexpr uint8_t darknessAlpha = 235;
+    static constexpr size_t profilerLength = 512;
+    
+#ifdef COUNT_ALLOCATIONS
+    // Allocation check build: once assets are in and the loop has warmed
+    // up, every frame that allocates (on any thread) is reported
+    static constexpr unsigned allocationWarmupFrames = 120;
+    unsigned warmFrames = 0;
+    uint64_t allocationsBefore = 0;
+    unsigned allocatingFrames = 0;
+    
+    void checkAllocations() {
+        uint64_t now = AllocCounter::count();
+        uint64_t made = now - allocationsBefore;
+        allocationsBefore = now;
+        if (!assetsReady || warmFrames < allocationWarmupFrames) {
+            warmFrames += assetsReady;
+            return;
+        }
+        if (made > 0) {
+            allocatingFrames++;
+            std::cerr << "Frame allocated " << made << " times (tick " << tickCount << ")\n";
+        }
+    }
+    
 public:
-    Game() : window(sf::VideoMode(1200, 800), "3D-Style Granny Horror Game", sf::Style::Close),
-             playerVelocity(0, 0), onGround(false), playerSpeed(300.0f),
-             grannyVelocity(0, 0), grannySpeed(150.0f), grannyState(GrannyState::PATROL),
-             awareness(0), searchTimer(0), day(1), time(7.0f), gameOver(false),
-             gameWon(false), mapVisible(false) {
+    bool allocationFree() const {
+        std::cout << allocatingFrames << " frames allocated after warm-up\n";
+        return allocatingFrames == 0;
+    }
+#endif
+    
+public:
+    Game() : firstFrameShown(false), assetsReady(false),
+             window(sf::VideoMode(1200, 800), "3D-Style Granny Horror Game", sf::Style::Close),
+             grannyBlend(1), catchesHeard(0), simulationRunning(false), tickCount(0), catches(0), teleports(0),
+             dynamicGeometry(sf::Triangles), lightGeometry(sf::Triangles), playerFacing(0), firstPerson(false),
+             mapVisible(false),
+             heldButtons(0), restartRequested(false), replaying(false), replayTick(0),
+             rewindBuffer(10 * 60), rewindWarned(false), quickSaveRequested(false), quickLoadRequested(false), rewindHeld(false),
+             serverRunning(false), profilerVisible(false), profilerString(std::string(profilerLength, ' ')) {
         
         window.setFramerateLimit(60);
         
@@ -83,210 +221,399 @@ public:
         uiView.setSize(1200, 800);
         uiView.setCenter(600, 400);
         
+        sim.profiler = &profiler;
+        captureSnapshot(current);
+        previous = current;
         initializeGame();
+        
+        // A fresh seed per game; recorded so the run can be replayed
+        sim.setSeed(std::random_device{}());
+        replay.start(sim.seed, Simulation::fixedDt);
+    }
+    
+    // Save this run's input trace to filename when the window closes
+    void recordTo(const std::string& filename) {
+        recordFile = filename;
+    }
+    
+    // Swap the built-in house for a compiled level
+    void loadLevel(const LevelFile& level) {
+        sim.loadLevel(level);
+        replay.levelHash = level.contentHash();
+        // Half the cores, so the first-person view has the rest
+        unsigned simThreads = std::thread::hardware_concurrency() / 2;
+        if (sim.grannies.size() >= parallelGrannies && simThreads > 1) {
+            if (!simJobs) simJobs.reset(new JobSystem(simThreads));
+            sim.jobs = simJobs.get();
+        } else {
+            sim.jobs = nullptr;
+        }
+        captureSnapshot(current);
+        previous = current;
+        createMapGeometry();
+        createMiniMap();
+        billboards.reserve(sim.grannies.size() + sim.items.size() + Simulation::maxPartners);
+    }
+    
+    // Run a co-op server for the loaded map on port, and join it
+    bool host(unsigned short port) {
+        server.reset(new CoopServer);
+        server->sim = sim;
+        server->sim.profiler = nullptr; // The profiler belongs to this thread
+        // sim.jobs carries over: this game's own sim no longer steps, so the
+        // server thread is the only one using it
+        if (!server->start(port)) return false;
+        std::cout << "Hosting co-op on port " << port << "\n";
+        serverRunning.store(true);
+        serverThread = std::thread(&Game::serverLoop, this);
+        return join(sf::IpAddress::LocalHost, port);
+    }
+    
+    // Play on a co-op server; it must run the same map
+    bool join(const sf::IpAddress& address, unsigned short port) {
+        if (replaying || !recordFile.empty()) {
+            std::cout << "Replays and recordings are for solo play; ignored in co-op\n";
+            replaying = false;
+            recordFile.clear();
+        }
+        client.reset(new CoopClient(sim));
+        if (!client->connect(address, port)) return false;
+        std::cout << "Joining " << address.toString() << ":" << port << "\n";
+        return true;
+    }
+    
+    // What a replay must have been recorded on to play back here
+    uint64_t levelHash() const { return replay.levelHash; }
+    
+    // Play back a recorded run instead of reading the keyboard
+    void playReplay(const Replay& recorded) {
+        replay = recorded;
+        replaying = !replay.inputs.empty();
+        replayTick = 0;
+        sim.setSeed(replay.seed);
     }
     
     void initializeGame() {
-        // Initialize player
-        player.setSize(sf::Vector2f(30, 50));
-        player.setFillColor(sf::Color::Green);
-        player.setPosition(100, 100);
-        health = 100;
-        
-        // Initialize Granny
-        granny.setSize(sf::Vector2f(40, 60));
-        granny.setFillColor(sf::Color::Magenta);
-        granny.setPosition(800, 500);
-        
-        // Load Granny texture (creepy face)
-        if (!grannyTexture.loadFromFile("granny_face.png")) {
-            // Create a simple creepy face pattern
-            sf::Image faceImage;
-            faceImage.create(40, 60, sf::Color::Magenta);
-            
-            // Draw creepy eyes
-            for (int i = 10; i < 15; i++) {
-                for (int j = 15; j < 20; j++) {
-                    faceImage.setPixel(i, j, sf::Color::Red);
-                    faceImage.setPixel(i + 15, j, sf::Color::Red);
-                }
+        // Placeholder sprites until the loaded ones arrive
+        createSprites();
+        
+        // Load Granny's face (creepy), generated if the file is missing
+        grannyFace = resources.load<sf::Image>("granny_face.png", makeGrannyFace);
+        
+        createMapGeometry();
+        createMiniMap();
+        setupUI();
+        loadSounds();
+    }
+    
+    // Runs on a loader thread
+    static bool makeGrannyFace(sf::Image& faceImage) {
+        // Create a simple creepy face pattern
+        faceImage.create(40, 60, sf::Color::Magenta);
+        
+        // Draw creepy eyes
+        for (int i = 10; i < 15; i++) {
+            for (int j = 15; j < 20; j++) {
+                faceImage.setPixel(i, j, sf::Color::Red);
+                faceImage.setPixel(i + 15, j, sf::Color::Red);
             }
-            
-            // Draw creepy mouth
-            for (int i = 12; i < 28; i++) {
-                for (int j = 35; j < 38; j++) {
-                    faceImage.setPixel(i, j, sf::Color::Black);
-                }
+        }
+        
+        // Draw creepy mouth
+        for (int i = 12; i < 28; i++) {
+            for (int j = 35; j < 38; j++) {
+                faceImage.setPixel(i, j, sf::Color::Black);
             }
-            
-            grannyTexture.loadFromImage(faceImage);
         }
-        granny.setTexture(&grannyTexture);
+        return true;
+    }
+    
+    // Finalizes loaded assets and swaps them in for the placeholders
+    void updateAssets() {
+        if (assetsReady) return;
+        resources.update();
+        
+        if (grannyFace.ready()) {
+            // Repacking moves regions, so the map is baked again too
+            atlas.setImage(SPRITE_GRANNY, grannyFace.get());
+            atlas.build();
+            createMapGeometry();
+            grannyFace = ResourceHandle<sf::Image>();
+        }
+        if (font.ready() && profilerText.getFont() != &font.get()) {
+            profilerText.setFont(font.get());
+        }
+        if (jumpScareBuffer.ready() && jumpScareSound.getBuffer() != &jumpScareBuffer.get()) {
+            jumpScareSound.setBuffer(jumpScareBuffer.get());
+        }
         
-        createMap();
-        createItems();
-        setupUI();
-        loadSounds();
+        if (resources.loading() == 0) {
+            assetsReady = true;
+            if (font.failed()) {
+                std::cerr << "Failed to load font, using default\n";
+            }
+            if (jumpScareBuffer.failed()) {
+                std::cerr << "Failed to load jump scare sound\n";
+            }
+            std::cout << "Assets ready after " << startupClock.getElapsedTime().asMilliseconds() << " ms\n";
+        }
     }
     
-    void createMap() {
-        // Create walls for rooms
-        // Bedroom
-        createRoom(50, 50, 300, 250);
-        // Hallway
-        createRoom(400, 50, 150, 500);
-        // Living Room
-        createRoom(600, 50, 350, 250);
-        // Kitchen
-        createRoom(600, 350, 350, 250);
-        // Bathroom
-        createRoom(50, 350, 300, 200);
-        // Storage
-        createRoom(50, 600, 300, 150);
-        
-        // Create doors (openings)
-        sf::RectangleShape door;
-        door.setSize(sf::Vector2f(20, 60));
-        door.setFillColor(sf::Color::Transparent);
-        
-        // Bedroom to Hallway
-        door.setPosition(350, 120);
-        doors.push_back(door);
-        
-        // Hallway to Living Room
-        door.setPosition(550, 120);
-        doors.push_back(door);
-        
-        // Hallway to Kitchen
-        door.setPosition(550, 320);
-        doors.push_back(door);
-        
-        // Hallway to Bathroom
-        door.setPosition(350, 320);
-        doors.push_back(door);
-        
-        // Create hiding spots (closets)
-        sf::RectangleShape closet;
-        closet.setSize(sf::Vector2f(80, 100));
-        closet.setFillColor(sf::Color(139, 69, 19)); // Brown
-        
-        closet.setPosition(80, 80);
-        hidingSpots.push_back(closet);
-        
-        closet.setPosition(650, 80);
-        hidingSpots.push_back(closet);
-        
-        closet.setPosition(80, 620);
-        hidingSpots.push_back(closet);
-    }
-    
-    void createRoom(float x, float y, float width, float height) {
-        // Top wall
-        walls.push_back(createWall(x, y, width, 20));
-        // Bottom wall
-        walls.push_back(createWall(x, y + height - 20, width, 20));
-        // Left wall
-        walls.push_back(createWall(x, y, 20, height));
-        // Right wall
-        walls.push_back(createWall(x + width - 20, y, 20, height));
-    }
-    
-    sf::RectangleShape createWall(float x, float y, float width, float height) {
-        sf::RectangleShape wall;
-        wall.setSize(sf::Vector2f(width, height));
-        wall.setPosition(x, y);
-        wall.setFillColor(sf::Color(100, 100, 100));
-        return wall;
-    }
-    
-    void createItems() {
-        std::vector<std::pair<std::string, sf::Vector2f>> itemData = {
-            {"key", sf::Vector2f(150, 150)},
-            {"hammer", sf::Vector2f(750, 150)},
-            {"screwdriver", sf::Vector2f(750, 450)},
-            {"battery", sf::Vector2f(150, 400)},
-            {"master_key", sf::Vector2f(150, 650)}
+    static sf::Image solidImage(unsigned width, unsigned height, sf::Color fill, sf::Color border) {
+        sf::Image image;
+        image.create(width, height, border);
+        for (unsigned x = 2; x + 2 < width; x++) {
+            for (unsigned y = 2; y + 2 < height; y++) {
+                image.setPixel(x, y, fill);
+            }
+        }
+        return image;
+    }
+    
+    void createSprites() {
+        // Color code items, indexed by ItemType
+        static const sf::Color itemColors[] = {
+            sf::Color::Yellow,       // KEY
+            sf::Color(165, 42, 42),  // HAMMER (brown)
+            sf::Color::Blue,         // SCREWDRIVER
+            sf::Color::Green,        // BATTERY
+            sf::Color::Cyan          // MASTER_KEY
         };
+        static_assert(sizeof(itemColors) / sizeof(itemColors[0]) == static_cast<size_t>(ItemType::COUNT),
+                      "one color per item type");
         
-        for (const auto& data : itemData) {
-            Item item;
-            item.shape.setSize(sf::Vector2f(20, 20));
-            item.shape.setPosition(data.second);
-            item.type = data.first;
-            item.collected = false;
-            
-            // Color code items
-            if (data.first == "key") item.shape.setFillColor(sf::Color::Yellow);
-            else if (data.first == "hammer") item.shape.setFillColor(sf::Color(165, 42, 42)); // Brown
-            else if (data.first == "screwdriver") item.shape.setFillColor(sf::Color::Blue);
-            else if (data.first == "battery") item.shape.setFillColor(sf::Color::Green);
-            else if (data.first == "master_key") item.shape.setFillColor(sf::Color::Cyan);
-            
-            items.push_back(item);
+        for (uint8_t type = 0; type < static_cast<uint8_t>(ItemType::COUNT); type++) {
+            sf::Color fill = itemColors[type];
+            sf::Color border(fill.r / 2, fill.g / 2, fill.b / 2);
+            atlas.setImage(itemSprite(static_cast<ItemType>(type)), solidImage(20, 20, fill, border));
         }
+        atlas.setImage(SPRITE_PLAYER, solidImage(30, 50, sf::Color::Green, sf::Color::Green));
+        atlas.setImage(SPRITE_GRANNY, solidImage(40, 60, sf::Color::Magenta, sf::Color::Magenta));
+        atlas.setImage(SPRITE_CLOSET, solidImage(80, 100, sf::Color(139, 69, 19), sf::Color(90, 45, 12)));
+        atlas.build();
+    }
+    
+    void createMapGeometry() {
+        // Walls and closets; doors are transparent openings and add nothing.
+        // The map never changes after load, so the stream reads it in place
+        // from its own thread, even while the simulation thread runs.
+        mapStream.build(sim.walls, sim.hidingSpots, sim.worldBounds, atlas, current.playerPosition);
+    }
+    
+    void createMiniMap() {
+        miniMap.build(sim.rooms, sim.walls, sim.hidingSpots, sim.worldBounds, sf::FloatRect(980, 20, 200, 200));
     }
     
     void setupUI() {
         // Load font
-        if (!font.loadFromFile("arial.ttf")) {
-            std::cerr << "Failed to load font, using default\n";
-        }
+        font = resources.load<sf::Font>("arial.ttf");
         
-        // Day text
-        dayText.setFont(font);
-        dayText.setCharacterSize(20);
-        dayText.setFillColor(sf::Color::White);
-        dayText.setPosition(20, 20);
+        // Clock, health bar, inventory and end screens
+        hud.create(1200, 800);
         
-        // Health bar
-        healthBarBackground.setSize(sf::Vector2f(200, 20));
-        healthBarBackground.setPosition(20, 50);
-        healthBarBackground.setFillColor(sf::Color(50, 50, 50));
+        // Darkness mask, drawn over the world in screen space
+        if (darkness.create(1200, 800)) {
+            darknessSprite.setTexture(darkness.getTexture(), true);
+        } else {
+            std::cerr << "Failed to create darkness mask\n";
+        }
         
-        healthBar.setSize(sf::Vector2f(200, 20));
-        healthBar.setPosition(20, 50);
-        healthBar.setFillColor(sf::Color::Red);
+        // First-person framebuffer, the size of the window
+        raycaster.resize(1200, 800);
+        billboards.reserve(sim.grannies.size() + sim.items.size() + Simulation::maxPartners);
+        partnerDrawPositions.reserve(Simulation::maxPartners);
+        if (viewTexture.create(1200, 800)) {
+            viewSprite.setTexture(viewTexture, true);
+        } else {
+            std::cerr << "Failed to create first-person view\n";
+        }
         
-        // Mini-map
-        miniMap.setSize(sf::Vector2f(200, 200));
-        miniMap.setPosition(980, 20);
-        miniMap.setFillColor(sf::Color(0, 0, 0, 150));
-        miniMap.setOutlineThickness(2);
-        miniMap.setOutlineColor(sf::Color::White);
+        // Profiler overlay (F3)
+        profilerBackground.setSize(sf::Vector2f(360, 190));
+        profilerBackground.setPosition(20, 590);
+        profilerBackground.setFillColor(sf::Color(0, 0, 0, 180));
         
-        // Inventory slots
-        for (int i = 0; i < 5; i++) {
-            sf::RectangleShape slot;
-            slot.setSize(sf::Vector2f(40, 40));
-            slot.setPosition(980 + i * 50, 750);
-            slot.setFillColor(sf::Color(50, 50, 50));
-            slot.setOutlineThickness(2);
-            slot.setOutlineColor(sf::Color::White);
-            inventorySlots.push_back(slot);
-        }
+        profilerText.setFont(placeholderFont);
+        profilerText.setCharacterSize(14);
+        profilerText.setFillColor(sf::Color::White);
+        profilerText.setPosition(30, 600);
     }
     
     void loadSounds() {
         // In a real implementation, you'd load actual sound files
         // For now, we'll create placeholder sounds
-        if (!jumpScareBuffer.loadFromFile("jumpscare.wav")) {
-            std::cerr << "Failed to load jump scare sound\n";
-        }
-        jumpScareSound.setBuffer(jumpScareBuffer);
+        jumpScareBuffer = resources.load<sf::SoundBuffer>("jumpscare.wav");
     }
     
     void run() {
         sf::Clock clock;
+        float accumulator = 0;
         
         while (window.isOpen()) {
-            sf::Time deltaTime = clock.restart();
-            float dt = deltaTime.asSeconds();
+            // Step the simulation at a fixed rate regardless of frame time
+            accumulator += std::min(clock.restart().asSeconds(), maxFrameTime);
             
-            processEvents();
-            if (!gameOver && !gameWon) {
-                update(dt);
+            {
+                ProfileScope scope(&profiler, ProfilePhase::PROCESS_EVENTS);
+                processEvents();
+            }
+            while (accumulator >= Simulation::fixedDt) {
+                std::swap(previous, current);
+                update(Simulation::fixedDt);
+                captureSnapshot(current);
+                accumulator -= Simulation::fixedDt;
+            }
+            
+            // Blend by how far the leftover time reaches into the next tick
+            {
+                ProfileScope scope(&profiler, ProfilePhase::UPDATE_UI);
+                updateUI(accumulator / Simulation::fixedDt);
             }
             render();
+#ifdef COUNT_ALLOCATIONS
+            checkAllocations();
+#endif
+        }
+        
+        leaveCoop();
+        saveRecording();
+        dumpProfile();
+    }
+    
+    // Simulation on its own thread at a fixed tick rate; this thread only
+    // handles events and draws, uncapped or vsynced, so a slow frame never
+    // holds up the game logic
+    void runPipelined(bool vsync) {
+        window.setFramerateLimit(0);
+        window.setVerticalSyncEnabled(vsync);
+        
+        simulationRunning.store(true);
+        std::thread simulationThread(&Game::simulationLoop, this);
+        while (window.isOpen()) {
+            {
+                ProfileScope scope(&profiler, ProfilePhase::PROCESS_EVENTS);
+                processEvents();
+            }
+            if (snapshots.update()) {
+                std::swap(previous, current);
+                current = snapshots.front();
+            }
+            
+            {
+                ProfileScope scope(&profiler, ProfilePhase::UPDATE_UI);
+                updateUI(pipelinedBlend());
+            }
+            render();
+#ifdef COUNT_ALLOCATIONS
+            checkAllocations();
+#endif
+        }
+        simulationRunning.store(false);
+        simulationThread.join();
+        
+        leaveCoop();
+        saveRecording();
+        dumpProfile();
+    }
+    
+    void simulationLoop() {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::duration tickLength =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(Simulation::fixedDt));
+        const Clock::duration maxLag =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(maxFrameTime));
+        
+        Clock::time_point nextTick = Clock::now();
+        while (simulationRunning.load()) {
+            // After a long stall, drop the backlog rather than spiral
+            Clock::time_point now = Clock::now();
+            if (now - nextTick > maxLag) {
+                nextTick = now - maxLag;
+            }
+            
+            bool ticked = false;
+            while (nextTick <= now) {
+                update(Simulation::fixedDt);
+                nextTick += tickLength;
+                ticked = true;
+            }
+            if (ticked) {
+                SimSnapshot& snapshot = snapshots.back();
+                captureSnapshot(snapshot);
+                snapshot.tickTime = nextTick - tickLength;
+                snapshots.publish();
+            }
+            std::this_thread::sleep_until(nextTick);
+        }
+    }
+    
+    // The co-op server ticks at the same fixed rate as the game
+    void serverLoop() {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::duration tickLength =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(Simulation::fixedDt));
+        
+        Clock::time_point nextTick = Clock::now();
+        while (serverRunning.load()) {
+            server->step();
+            nextTick += tickLength;
+            
+            // Behind by more than a tick: drop the backlog
+            Clock::time_point now = Clock::now();
+            if (now - nextTick > tickLength) {
+                nextTick = now;
+            }
+            std::this_thread::sleep_until(nextTick);
+        }
+    }
+    
+    // Says goodbye to the server, then stops it if this game hosted it
+    void leaveCoop() {
+        client.reset();
+        if (server) {
+            serverRunning.store(false);
+            serverThread.join();
+            server.reset();
+        }
+    }
+    
+    // The renderer trails the newest snapshot by one tick, so it is always
+    // blending between two ticks it already has
+    float pipelinedBlend() const {
+        typedef std::chrono::steady_clock Clock;
+        double span = std::chrono::duration<double>(current.tickTime - previous.tickTime).count();
+        if (span <= 0) return 1;
+        Clock::time_point renderTime = Clock::now() -
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(Simulation::fixedDt));
+        double blend = std::chrono::duration<double>(renderTime - previous.tickTime).count() / span;
+        return static_cast<float>(std::max(0.0, std::min(1.0, blend)));
+    }
+    
+    void captureSnapshot(SimSnapshot& snapshot) const {
+        if (client) {
+            client->capture(snapshot);
+            snapshot.binGrannies(sim.worldBounds);
+            snapshot.tick = tickCount;
+            return;
+        }
+        snapshot.capture(sim);
+        snapshot.binGrannies(sim.worldBounds);
+        snapshot.tick = tickCount;
+        snapshot.catches = catches;
+        snapshot.teleports = teleports;
+    }
+    
+    void dumpProfile() {
+        profiler.collect();
+        if (profiler.writeCsv("profile.csv") && profiler.writeChromeTrace("profile_trace.json")) {
+            std::cout << "Frame profile written to profile.csv and profile_trace.json\n";
+        }
+    }
+    
+    void saveRecording() {
+        if (!recordFile.empty()) {
+            replay.finalHash = sim.stateHash();
+            replay.saveToFile(recordFile);
         }
     }
     
@@ -298,411 +625,479 @@ public:
             }
             
             if (event.type == sf::Event::KeyPressed) {
-                keys[event.key.code] = true;
+                heldButtons.fetch_or(buttonFor(event.key.code));
                 
                 if (event.key.code == sf::Keyboard::M) {
                     mapVisible = !mapVisible;
                 }
-                if (event.key.code == sf::Keyboard::R && (gameOver || gameWon)) {
-                    resetGame();
+                if (event.key.code == sf::Keyboard::V) {
+                    firstPerson = !firstPerson;
+                }
+                if (event.key.code == sf::Keyboard::F3) {
+                    profilerVisible = !profilerVisible;
+                }
+                if (event.key.code == sf::Keyboard::R && (current.gameOver || current.gameWon)) {
+                    restartRequested.store(true);
+                }
+                if (event.key.code == sf::Keyboard::F5) {
+                    quickSaveRequested.store(true);
+                }
+                if (event.key.code == sf::Keyboard::F9) {
+                    quickLoadRequested.store(true);
+                }
+                if (event.key.code == sf::Keyboard::Backspace) {
+                    rewindHeld.store(true);
                 }
             }
             
             if (event.type == sf::Event::KeyReleased) {
-                keys[event.key.code] = false;
+                heldButtons.fetch_and(static_cast<uint8_t>(~buttonFor(event.key.code)));
+                if (event.key.code == sf::Keyboard::Backspace) {
+                    rewindHeld.store(false);
+                }
             }
         }
     }
     
-    void update(float dt) {
-        updatePlayer(dt);
-        updateGranny(dt);
-        updateItems();
-        updateTime(dt);
-        checkCollisions();
-        checkWinCondition();
-        updateUI();
+    static uint8_t buttonFor(sf::Keyboard::Key key) {
+        switch (key) {
+            case sf::Keyboard::W: return PlayerInput::UP;
+            case sf::Keyboard::S: return PlayerInput::DOWN;
+            case sf::Keyboard::A: return PlayerInput::LEFT;
+            case sf::Keyboard::D: return PlayerInput::RIGHT;
+            case sf::Keyboard::LShift: return PlayerInput::RUN;
+            default: return 0;
+        }
     }
     
-    void updatePlayer(float dt) {
-        // Handle input
-        playerVelocity.x = 0;
-        playerVelocity.y = 0;
-        
-        if (keys[sf::Keyboard::W]) playerVelocity.y = -playerSpeed;
-        if (keys[sf::Keyboard::S]) playerVelocity.y = playerSpeed;
-        if (keys[sf::Keyboard::A]) playerVelocity.x = -playerSpeed;
-        if (keys[sf::Keyboard::D]) playerVelocity.x = playerSpeed;
-        
-        // Normalize diagonal movement
-        if (playerVelocity.x != 0 && playerVelocity.y != 0) {
-            playerVelocity.x *= 0.707f;
-            playerVelocity.y *= 0.707f;
+    void update(float dt) {
+        // In co-op the server runs the game; saves, rewind and replays are
+        // for solo play only
+        if (client) {
+            PlayerInput input;
+            input.buttons = heldButtons.load();
+            if (restartRequested.exchange(false)) {
+                input.press(PlayerInput::RESTART);
+            }
+            client->tick(input);
+            tickCount++;
+            return;
         }
         
-        // Apply movement
-        sf::Vector2f newPosition = player.getPosition() + playerVelocity * dt;
-        
-        // Check wall collisions
-        if (!checkWallCollision(newPosition)) {
-            player.setPosition(newPosition);
+        if (quickSaveRequested.exchange(false)) {
+            quickSave.capture(sim);
+        }
+        if (quickLoadRequested.exchange(false) && !quickSave.empty() && quickSave.restore(sim)) {
+            rewindBuffer.clear();
+            teleports++;
+            leaveTrace();
         }
         
-        // Keep player in bounds
-        sf::Vector2f pos = player.getPosition();
-        pos.x = std::max(0.0f, std::min(1150.0f, pos.x));
-        pos.y = std::max(0.0f, std::min(750.0f, pos.y));
-        player.setPosition(pos);
+        // Rewinding replaces the tick: step back one recorded state
+        if (rewindHeld.load()) {
+            if (rewindBuffer.rewind(1, rewindState) && rewindState.restore(sim)) {
+                tickCount++;
+                leaveTrace();
+            }
+            return;
+        }
         
-        // Update camera to follow player
-        gameView.setCenter(player.getPosition());
-    }
-    
-    void updateGranny(float dt) {
-        sf::Vector2f playerPos = player.getPosition();
-        sf::Vector2f grannyPos = granny.getPosition();
-        
-        // Calculate distance to player
-        float dx = playerPos.x - grannyPos.x;
-        float dy = playerPos.y - grannyPos.y;
-        float distance = std::sqrt(dx * dx + dy * dy);
-        
-        // Update Granny's state
-        if (distance < 200 && hasLineOfSight()) {
-            grannyState = GrannyState::CHASE;
-            awareness = 100;
-            lastSeenPosition = playerPos;
-            searchTimer = 3.0f;
-        } else if (grannyState == GrannyState::CHASE) {
-            grannyState = GrannyState::SEARCH;
-            searchTimer = 3.0f;
-        } else if (grannyState == GrannyState::SEARCH && searchTimer > 0) {
-            searchTimer -= dt;
+        PlayerInput input;
+        if (replaying) {
+            input = replay.inputs[replayTick++];
         } else {
-            grannyState = GrannyState::PATROL;
-            awareness = std::max(0.0f, awareness - 50.0f * dt);
+            input.buttons = heldButtons.load();
+            if (restartRequested.exchange(false)) {
+                input.press(PlayerInput::RESTART);
+            }
+            replay.record(input);
         }
         
-        // Move Granny based on state
-        switch (grannyState) {
-            case GrannyState::PATROL:
-                patrolBehavior(dt);
-                break;
-            case GrannyState::CHASE:
-                chaseBehavior(dt);
-                break;
-            case GrannyState::SEARCH:
-                searchBehavior(dt);
-                break;
+        bool ended = sim.gameOver || sim.gameWon;
+        sim.step(dt, input);
+        tickCount++;
+        if (sim.playerWasCaught) {
+            catches++;
+            teleports++;
         }
-        
-        // Check if caught player
-        if (distance < 50) {
-            playerCaught();
+        if (ended && !sim.gameOver && !sim.gameWon) {
+            teleports++;
         }
-    }
-    
-    void patrolBehavior(float dt) {
-        static sf::Vector2f targetPosition = granny.getPosition();
-        static float changeTargetTimer = 0;
-        
-        changeTargetTimer -= dt;
-        if (changeTargetTimer <= 0 || 
-            std::abs(granny.getPosition().x - targetPosition.x) < 10 &&
-            std::abs(granny.getPosition().y - targetPosition.y) < 10) {
-            
-            // New random target
-            targetPosition.x = static_cast<float>(rand() % 1100 + 50);
-            targetPosition.y = static_cast<float>(rand() % 700 + 50);
-            changeTargetTimer = 5.0f;
+        rewindState.capture(sim);
+        if (!rewindBuffer.push(rewindState) && !rewindWarned) {
+            std::cerr << "Rewind is off: a " << rewindState.size() << "-byte state does not fit in the "
+                      << rewindBuffer.capacity() << "-byte rewind buffer\n";
+            rewindWarned = true;
         }
         
-        // Move towards target
-        sf::Vector2f direction = targetPosition - granny.getPosition();
-        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-        if (length > 0) {
-            direction /= length;
-            granny.move(direction * grannySpeed * dt);
+        // Once the trace runs out the keyboard takes over, and its input is
+        // appended so the trace still describes the whole run
+        if (replaying && replayTick == replay.inputs.size()) {
+            bool matches = replay.finalHash == 0 || sim.stateHash() == replay.finalHash;
+            std::cout << "Replay finished after " << replayTick << " ticks"
+                      << (matches ? "\n" : ", but the final state differs from the recording\n");
+            replaying = false;
         }
     }
     
-    void chaseBehavior(float dt) {
-        sf::Vector2f direction = player.getPosition() - granny.getPosition();
-        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-        if (length > 0) {
-            direction /= length;
-            granny.move(direction * grannySpeed * 1.5f * dt);
+    // After a load or rewind the input trace no longer leads to this state,
+    // so recording and playback stop
+    void leaveTrace() {
+        if (replaying) {
+            std::cout << "Replay stopped at tick " << replayTick << " by a load or rewind\n";
+            replaying = false;
+        }
+        if (!recordFile.empty()) {
+            std::cout << "Recording stopped by a load or rewind; " << recordFile << " will not be written\n";
+            recordFile.clear();
         }
     }
     
-    void searchBehavior(float dt) {
-        sf::Vector2f direction = lastSeenPosition - granny.getPosition();
-        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-        if (length > 0) {
-            direction /= length;
-            granny.move(direction * grannySpeed * dt);
-        }
-        
-        // Random wandering while searching
-        if (rand() % 100 < 5) {
-            lastSeenPosition.x += static_cast<float>(rand() % 100 - 50);
-            lastSeenPosition.y += static_cast<float>(rand() % 100 - 50);
-        }
+    sf::Vector2f grannyDrawPosition(size_t i) const {
+        return i < previous.grannyPositions.size()
+            ? lerp(previous.grannyPositions[i], current.grannyPositions[i], grannyBlend)
+            : current.grannyPositions[i];
     }
     
-    bool hasLineOfSight() {
-        // Simple line of sight check
-        // In a real implementation, you'd do proper raycasting
-        sf::Vector2f playerPos = player.getPosition();
-        sf::Vector2f grannyPos = granny.getPosition();
-        
-        // Check if there are walls between them
-        for (const auto& wall : walls) {
-            if (lineIntersectsRect(playerPos, grannyPos, wall.getGlobalBounds())) {
-                return false;
+    void updateUI(float blend) {
+        // A catch or restart moves everyone at once; snap instead of sliding
+        if (current.teleports != previous.teleports) blend = 1;
+        playerDrawPosition = lerp(previous.playerPosition, current.playerPosition, blend);
+        sf::Vector2f moved = current.playerPosition - previous.playerPosition;
+        if (moved.x != 0 || moved.y != 0) {
+            playerFacing = std::atan2(moved.y, moved.x);
+        }
+        // The top-down view blends only the Grannies near it; the minimap
+        // and first person need them all
+        grannyBlend = current.tick - previous.tick > grannyBlendTicks ? 1 : blend;
+        grannyDrawPositions.clear();
+        if (mapVisible || firstPerson) {
+            grannyDrawPositions.resize(current.grannyPositions.size());
+            for (size_t i = 0; i < current.grannyPositions.size(); i++) {
+                grannyDrawPositions[i] = grannyDrawPosition(i);
             }
         }
+        partnerDrawPositions.resize(current.partnerPositions.size());
+        for (size_t i = 0; i < current.partnerPositions.size(); i++) {
+            partnerDrawPositions[i] = previous.partnerPositions.size() == current.partnerPositions.size()
+                ? lerp(previous.partnerPositions[i], current.partnerPositions[i], blend)
+                : current.partnerPositions[i];
+        }
         
-        return true;
-    }
-    
-    bool lineIntersectsRect(sf::Vector2f p1, sf::Vector2f p2, sf::FloatRect rect) {
-        // Check if line intersects with rectangle
-        return lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top), sf::Vector2f(rect.left + rect.width, rect.top)) ||
-               lineIntersectsLine(p1, p2, sf::Vector2f(rect.left + rect.width, rect.top), sf::Vector2f(rect.left + rect.width, rect.top + rect.height)) ||
-               lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top + rect.height), sf::Vector2f(rect.left + rect.width, rect.top + rect.height)) ||
-               lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top), sf::Vector2f(rect.left, rect.top + rect.height));
-    }
-    
-    bool lineIntersectsLine(sf::Vector2f l1p1, sf::Vector2f l1p2, sf::Vector2f l2p1, sf::Vector2f l2p2) {
-        // Implementation of line-line intersection
-        float den = (l1p1.x - l1p2.x) * (l2p1.y - l2p2.y) - (l1p1.y - l1p2.y) * (l2p1.x - l2p2.x);
-        if (den == 0) return false;
+        // Update camera to follow player
+        gameView.setCenter(playerDrawPosition);
         
-        float t = ((l1p1.x - l2p1.x) * (l2p1.y - l2p2.y) - (l1p1.y - l2p1.y) * (l2p1.x - l2p2.x)) / den;
-        float u = -((l1p1.x - l1p2.x) * (l1p1.y - l2p1.y) - (l1p1.y - l1p2.y) * (l1p1.x - l2p1.x)) / den;
+        miniMap.reveal(playerDrawPosition + sim.playerSize / 2.0f, fogRevealRadius);
+        if (mapVisible) {
+            miniMap.setMarkers(playerDrawPosition, grannyDrawPositions);
+        }
         
-        return t >= 0 && t <= 1 && u >= 0 && u <= 1;
-    }
-    
-    void updateItems() {
-        for (auto& item : items) {
-            if (!item.collected) {
-                sf::FloatRect itemBounds = item.shape.getGlobalBounds();
-                sf::FloatRect playerBounds = player.getGlobalBounds();
-                
-                if (itemBounds.intersects(playerBounds)) {
-                    item.collected = true;
-                    // In a full implementation, add to inventory
-                }
-            }
+        if (current.catches != catchesHeard) {
+            catchesHeard = current.catches;
+            jumpScareSound.play();
         }
-    }
-    
-    void updateTime(float dt) {
-        time += dt * 0.1f;
-        if (time >= 24.0f) {
-            time = 7.0f;
-            day++;
-            
-            if (day > 5) {
-                gameOver = true;
-            }
+        
+        // The HUD redraws only when the shown minute, health or screen changes
+        HudState state;
+        int hours = static_cast<int>(current.time);
+        state.day = current.day;
+        state.minuteOfDay = hours * 60 + static_cast<int>((current.time - hours) * 60);
+        state.healthWidth = static_cast<int>(current.health * 2);
+        state.gameOver = current.gameOver;
+        state.gameWon = current.gameWon;
+        state.font = font.ready() ? &font.get() : nullptr;
+        hud.update(state);
+        
+        // Rolling timings; text is rebuilt twice a second to stay readable
+        profiler.collect();
+        if (profilerVisible && profilerRefresh.getElapsedTime().asSeconds() >= 0.5f) {
+            profilerRefresh.restart();
+            updateProfilerText();
         }
     }
     
-    void checkCollisions() {
-        // Check wall collisions (already handled in updatePlayer)
-    }
-    
-    void checkWinCondition() {
-        // Check if player has all items and reached exit
-        bool hasAllItems = true;
-        for (const auto& item : items) {
-            if (!item.collected) {
-                hasAllItems = false;
-                break;
-            }
+    // Formatted into a stack buffer and copied into the fixed-length
+    // string, padded with spaces, so refreshing it does not allocate
+    void updateProfilerText() {
+        char text[profilerLength];
+        char line[96];
+        size_t used = 0;
+        auto append = [&](const char* part) {
+            for (; *part && used < profilerLength; part++) text[used++] = *part;
+        };
+        append("phase            min us   avg us   p99 us\n");
+        for (size_t i = 0; i < static_cast<size_t>(ProfilePhase::COUNT); i++) {
+            ProfilePhase phase = static_cast<ProfilePhase>(i);
+            Profiler::PhaseStats stats = profiler.stats(phase);
+            std::snprintf(line, sizeof(line), "%-15s %8.1f %8.1f %8.1f\n",
+                          profilePhaseName(phase), stats.minUs, stats.avgUs, stats.p99Us);
+            append(line);
         }
-        
-        sf::Vector2f playerPos = player.getPosition();
-        if (hasAllItems && playerPos.x > 1000 && playerPos.y < 100) {
-            gameWon = true;
+        std::snprintf(line, sizeof(line), "map drawn %u culled %u, sprites drawn %u culled %u\n",
+                      mapCulling.drawn, mapCulling.culled, spriteCulling.drawn, spriteCulling.culled);
+        append(line);
+        WorldStream::Stats chunks = mapStream.stats();
+        std::snprintf(line, sizeof(line), "chunks resident %u/%u, loads %llu\n", chunks.resident, chunks.slots,
+                      static_cast<unsigned long long>(chunks.loads));
+        append(line);
+        std::snprintf(line, sizeof(line), "hud redraws: %u\n", hud.redrawCount());
+        append(line);
+        if (profiler.droppedSamples() > 0) {
+            std::snprintf(line, sizeof(line), "dropped samples: %llu\n",
+                          static_cast<unsigned long long>(profiler.droppedSamples()));
+            append(line);
         }
-    }
-    
-    void playerCaught() {
-        health -= 25;
-        jumpScareSound.play();
-        
-        // Reset positions
-        player.setPosition(100, 100);
-        granny.setPosition(800, 500);
         
-        if (health <= 0) {
-            gameOver = true;
+        // Padded to the fixed length, so the copy into the text reuses its storage
+        for (size_t i = 0; i < profilerLength; i++) {
+            profilerString[i] = i < used ? static_cast<sf::Uint32>(text[i]) : ' ';
         }
+        profilerText.setString(profilerString);
     }
     
-    bool checkWallCollision(sf::Vector2f newPosition) {
-        sf::FloatRect newBounds(newPosition.x, newPosition.y, player.getSize().x, player.getSize().y);
+    void render() {
+        updateAssets();
+        window.clear(sf::Color(20, 20, 40)); // Dark blue background
         
-        for (const auto& wall : walls) {
-            if (newBounds.intersects(wall.getGlobalBounds())) {
-                return true;
+        // Draw game world
+        {
+            ProfileScope scope(&profiler, ProfilePhase::RENDER_WORLD);
+            if (firstPerson) {
+                renderFirstPerson();
+            } else {
+                renderWorld();
             }
         }
         
-        return false;
-    }
-    
-    void updateUI() {
-        // Update day text
-        int hours = static_cast<int>(time);
-        int minutes = static_cast<int>((time - hours) * 60);
-        std::string ampm = hours >= 12 ? "PM" : "AM";
-        int displayHours = hours % 12;
-        if (displayHours == 0) displayHours = 12;
+        // Draw UI
+        window.setView(uiView);
         
-        dayText.setString("Day " + std::to_string(day) + " - " + 
-                         std::to_string(displayHours) + ":" + 
-                         (minutes < 10 ? "0" : "") + std::to_string(minutes) + " " + ampm);
+        if (mapVisible) {
+            window.draw(miniMap);
+        }
+        
+        // Clock, health, inventory and any end screen, cached as one layer
+        window.draw(hud);
         
-        // Update health bar
-        healthBar.setSize(sf::Vector2f(health * 2, 20));
+        if (profilerVisible) {
+            window.draw(profilerBackground);
+            window.draw(profilerText);
+        }
+        
+        {
+            ProfileScope scope(&profiler, ProfilePhase::DISPLAY);
+            window.display();
+        }
+        if (!firstFrameShown) {
+            firstFrameShown = true;
+            std::cout << "First frame after " << startupClock.getElapsedTime().asMilliseconds() << " ms\n";
+        }
     }
     
-    void render() {
-        window.clear(sf::Color(20, 20, 40)); // Dark blue background
-        
-        // Draw game world
+    void renderWorld() {
         window.setView(gameView);
         
-        // Draw rooms and walls
-        for (const auto& wall : walls) {
-            window.draw(wall);
-        }
+        // Only what overlaps the view, plus a margin, is drawn
+        sf::Vector2f viewSize = gameView.getSize();
+        sf::FloatRect visible(gameView.getCenter() - viewSize / 2.0f - sf::Vector2f(cullMargin, cullMargin),
+                              viewSize + sf::Vector2f(2 * cullMargin, 2 * cullMargin));
         
-        // Draw doors
-        for (const auto& door : doors) {
-            window.draw(door);
+        // Draw rooms, walls and hiding spots, prefetching the way the player
+        // is going; a catch or restart jumps, so nothing is prefetched then
+        sf::Vector2f velocity;
+        if (current.teleports == previous.teleports) {
+            velocity = (current.playerPosition - previous.playerPosition) / Simulation::fixedDt;
         }
-        
-        // Draw hiding spots
-        for (const auto& closet : hidingSpots) {
-            window.draw(closet);
+        mapStream.update(gameView.getCenter(), velocity);
+        mapCulling = mapStream.draw(window, visible, &atlas.texture());
+        
+        // Items, Grannies and the player in one batch, back to front. Item
+        // bounds never change after load; only the collected flags come
+        // from the snapshot.
+        spriteCulling = CullCounts();
+        dynamicGeometry.clear();
+        auto appendVisible = [&](const sf::FloatRect& bounds, SpriteId sprite, sf::Color tint = sf::Color::White) {
+            if (bounds.intersects(visible)) {
+                atlas.appendSprite(dynamicGeometry, bounds, sprite, tint);
+                spriteCulling.drawn++;
+            } else {
+                spriteCulling.culled++;
+            }
+        };
+        for (size_t i = 0; i < current.itemsCollected.size(); i++) {
+            if (!current.itemsCollected[i]) {
+                appendVisible(sim.items[i].bounds, itemSprite(sim.items[i].type));
+            }
+        }
+        // Grannies come from the cells of current's grid that the view
+        // overlaps, so a horde off screen costs nothing here. The grid holds
+        // top-left corners where current has them; the query reaches back
+        // by one sprite, and by as far as a chasing Granny (at most twice
+        // grannySpeed) moves in grannyBlendTicks.
+        float reach = 2 * sim.grannySpeed * Simulation::fixedDt * grannyBlendTicks;
+        sf::FloatRect nearby(visible.left - sim.grannySize.x - reach, visible.top - sim.grannySize.y - reach,
+                             visible.width + sim.grannySize.x + 2 * reach, visible.height + sim.grannySize.y + 2 * reach);
+        unsigned grannyCandidates = 0;
+        current.grannyGrid.forEachIn(nearby, [&](uint32_t i) {
+            appendVisible(sf::FloatRect(grannyDrawPosition(i), sim.grannySize), SPRITE_GRANNY);
+            grannyCandidates++;
+        });
+        spriteCulling.culled += static_cast<unsigned>(current.grannyPositions.size() - grannyCandidates);
+        for (const auto& position : partnerDrawPositions) {
+            appendVisible(sf::FloatRect(position, sim.playerSize), SPRITE_PLAYER, sf::Color(120, 170, 255));
         }
+        atlas.appendSprite(dynamicGeometry, sf::FloatRect(playerDrawPosition, sim.playerSize), SPRITE_PLAYER);
+        window.draw(dynamicGeometry, &atlas.texture());
         
-        // Draw items
-        for (const auto& item : items) {
-            if (!item.collected) {
-                window.draw(item.shape);
+        drawDarkness();
+    }
+    
+    void renderFirstPerson() {
+        // Walls are immutable after load, so casting against them here is
+        // safe while the simulation thread runs
+        Raycaster::Camera camera;
+        camera.position = playerDrawPosition + sim.playerSize / 2.0f;
+        camera.angle = playerFacing;
+        camera.fov = 1.2f;
+        camera.viewDistance = hasBattery() ? batteryFlashlightRadius : flashlightRadius;
+        
+        billboards.clear();
+        for (size_t i = 0; i < current.itemsCollected.size(); i++) {
+            if (!current.itemsCollected[i]) {
+                const sf::FloatRect& bounds = sim.items[i].bounds;
+                billboards.push_back({sf::Vector2f(bounds.left + bounds.width / 2, bounds.top + bounds.height / 2),
+                                      bounds.width, 20.0f, Raycaster::rgba(230, 200, 60)});
             }
         }
+        for (const auto& position : grannyDrawPositions) {
+            billboards.push_back({position + sim.grannySize / 2.0f, sim.grannySize.x, 90.0f,
+                                  Raycaster::rgba(200, 40, 160)});
+        }
+        for (const auto& position : partnerDrawPositions) {
+            billboards.push_back({position + sim.playerSize / 2.0f, sim.playerSize.x, 50.0f,
+                                  Raycaster::rgba(60, 120, 230)});
+        }
         
-        // Draw Granny
-        window.draw(granny);
-        
-        // Draw player
-        window.draw(player);
-        
-        // Draw UI
+        if (!renderJobs) {
+            unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            renderJobs.reset(new JobSystem(simJobs ? cores - simJobs->threadCount() : cores));
+        }
+        raycaster.render(sim.wallGrid, camera, billboards, renderJobs.get());
+        viewTexture.update(raycaster.pixels());
         window.setView(uiView);
-        
-        window.draw(healthBarBackground);
-        window.draw(healthBar);
-        window.draw(dayText);
-        
-        if (mapVisible) {
-            window.draw(miniMap);
-            drawMiniMap();
-        }
-        
-        // Draw inventory
-        for (const auto& slot : inventorySlots) {
-            window.draw(slot);
-        }
-        
-        // Draw game over or win screen
-        if (gameOver) {
-            drawGameOverScreen();
-        } else if (gameWon) {
-            drawWinScreen();
-        }
-        
-        window.display();
-    }
-    
-    void drawMiniMap() {
-        // In a full implementation, draw mini-map representation
-        sf::RectangleShape playerMini(sf::Vector2f(6, 6));
-        playerMini.setFillColor(sf::Color::Green);
-        playerMini.setPosition(miniMap.getPosition() + sf::Vector2f(
-            (player.getPosition().x / 1200.0f) * 180 + 10,
-            (player.getPosition().y / 800.0f) * 180 + 10
-        ));
-        window.draw(playerMini);
-        
-        sf::RectangleShape grannyMini(sf::Vector2f(6, 6));
-        grannyMini.setFillColor(sf::Color::Magenta);
-        grannyMini.setPosition(miniMap.getPosition() + sf::Vector2f(
-            (granny.getPosition().x / 1200.0f) * 180 + 10,
-            (granny.getPosition().y / 800.0f) * 180 + 10
-        ));
-        window.draw(grannyMini);
-    }
-    
-    void drawGameOverScreen() {
-        sf::RectangleShape overlay(sf::Vector2f(1200, 800));
-        overlay.setFillColor(sf::Color(0, 0, 0, 200));
-        window.draw(overlay);
-        
-        sf::Text gameOverText;
-        gameOverText.setFont(font);
-        gameOverText.setString("GAME OVER\nGranny caught you!\nPress R to restart");
-        gameOverText.setCharacterSize(48);
-        gameOverText.setFillColor(sf::Color::Red);
-        gameOverText.setPosition(400, 300);
-        gameOverText.setStyle(sf::Text::Bold);
-        window.draw(gameOverText);
-    }
-    
-    void drawWinScreen() {
-        sf::RectangleShape overlay(sf::Vector2f(1200, 800));
-        overlay.setFillColor(sf::Color(0, 0, 0, 200));
-        window.draw(overlay);
-        
-        sf::Text winText;
-        winText.setFont(font);
-        winText.setString("YOU ESCAPED!\nYou survived Granny's house!\nPress R to play again");
-        winText.setCharacterSize(48);
-        winText.setFillColor(sf::Color::Green);
-        winText.setPosition(350, 300);
-        winText.setStyle(sf::Text::Bold);
-        window.draw(winText);
-    }
-    
-    void resetGame() {
-        // Reset game state
-        player.setPosition(100, 100);
-        granny.setPosition(800, 500);
-        health = 100;
-        day = 1;
-        time = 7.0f;
-        gameOver = false;
-        gameWon = false;
-        awareness = 0;
-        grannyState = GrannyState::PATROL;
-        
-        // Reset items
-        for (auto& item : items) {
-            item.collected = false;
+        window.draw(viewSprite);
+    }
+    
+    bool hasBattery() const {
+        for (size_t i = 0; i < current.itemsCollected.size(); i++) {
+            if (current.itemsCollected[i] && sim.items[i].type == ItemType::BATTERY) return true;
         }
+        return false;
+    }
+    
+    // Fan of triangles from the polygon's origin, transparent at the centre
+    // and fading to full darkness at radius
+    void appendLight(const VisibilityPolygon& light, float radius) {
+        sf::Vector2f origin = light.origin();
+        auto shade = [&](sf::Vector2f point) {
+            sf::Vector2f d = point - origin;
+            float fraction = std::min(1.0f, std::sqrt(d.x * d.x + d.y * d.y) / radius);
+            return sf::Color(255, 255, 255, static_cast<sf::Uint8>(255 * fraction));
+        };
+        const std::vector<sf::Vector2f>& points = light.points();
+        for (size_t i = 0; i + 1 < points.size(); i++) {
+            lightGeometry.append(sf::Vertex(origin, sf::Color(255, 255, 255, 0)));
+            lightGeometry.append(sf::Vertex(points[i], shade(points[i])));
+            lightGeometry.append(sf::Vertex(points[i + 1], shade(points[i + 1])));
+        }
+    }
+    
+    void drawDarkness() {
+        // Walls are immutable after load, so reading them here is safe
+        // while the simulation thread runs
+        sf::Vector2f center = playerDrawPosition + sim.playerSize / 2.0f;
+        float reach = hasBattery() ? batteryFlashlightRadius : flashlightRadius;
+        lantern.compute(center, lanternRadius, sim.walls, &sim.wallGrid);
+        flashlight.compute(center, reach, sim.walls, &sim.wallGrid, playerFacing, flashlightHalfAngle);
+        
+        lightGeometry.clear();
+        appendLight(lantern, lanternRadius);
+        appendLight(flashlight, reach);
+        
+        // Lights multiply the darkness's alpha down where they overlap
+        darkness.setView(gameView);
+        darkness.clear(sf::Color(0, 0, 0, darknessAlpha));
+        darkness.draw(lightGeometry, sf::BlendMultiply);
+        darkness.display();
+        
+        window.setView(uiView);
+        window.draw(darknessSprite);
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
+    // --level file.lvl loads a compiled level (see level_compiler.c).
+    // --record file saves this run's input; --replay file plays one back.
+    // --pipelined simulates on a separate thread and draws vsynced, or as
+    // fast as possible with --uncapped.
+    // --host [port] runs a co-op server and plays on it; --join
+    // address[:port] plays on someone else's, with the same --level.
     Game game;
-    game.run();
+    bool pipelined = false;
+    bool vsync = true;
+    bool hosting = false;
+    std::string joinAddress;
+    const char* replayFile = nullptr;
+    unsigned short port = CoopServer::defaultPort;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--level") == 0 && hasValue) {
+            LevelFile level;
+            if (!level.loadFromFile(argv[++i])) return 1;
+            game.loadLevel(level);
+        } else if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+            game.recordTo(argv[++i]);
+        } else if (std::strcmp(argv[i], "--replay") == 0 && hasValue) {
+            replayFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = true;
+        } else if (std::strcmp(argv[i], "--uncapped") == 0) {
+            vsync = false;
+        } else if (std::strcmp(argv[i], "--host") == 0) {
+            hosting = true;
+            if (hasValue && argv[i + 1][0] != '-') {
+                port = static_cast<unsigned short>(std::atoi(argv[++i]));
+            }
+        } else if (std::strcmp(argv[i], "--join") == 0 && hasValue) {
+            joinAddress = argv[++i];
+            size_t colon = joinAddress.find(':');
+            if (colon != std::string::npos) {
+                port = static_cast<unsigned short>(std::atoi(joinAddress.c_str() + colon + 1));
+                joinAddress.resize(colon);
+            }
+        } else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    
+    // After every option, so the level is loaded first
+    if (replayFile) {
+        Replay recorded;
+        if (!recorded.loadFromFile(replayFile, game.levelHash())) return 1;
+        game.playReplay(recorded);
+    }
+    if (hosting && !game.host(port)) return 1;
+    if (!joinAddress.empty() && !game.join(sf::IpAddress(joinAddress), port)) return 1;
+    
+    if (pipelined) {
+        game.runPipelined(vsync);
+    } else {
+        game.run();
+    }
+#ifdef COUNT_ALLOCATIONS
+    return game.allocationFree() ? 0 : 1;
+#else
     return 0;
+#endif
 }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include "render_batch.h"
+
+// Minimap: the map geometry is rendered once into a small texture scaled
+// to fit the frame, and a fog-of-war texture of the same resolution hides
+// what the player has not been near yet. Revealing touches only the texels
+// around the player and uploads only the ones that changed, so a frame
+// costs the same on a huge level as on the house.
+class MiniMap : public sf::Drawable {
+public:
+    MiniMap() : markers(sf::Triangles), scale(1), width(0), height(0) {}
+
+    // frame is the minimap's box in UI coordinates
+    bool build(const std::vector<sf::FloatRect>& rooms, const std::vector<sf::FloatRect>& walls,
+               const std::vector<sf::FloatRect>& hidingSpots, const sf::FloatRect& worldBounds,
+               const sf::FloatRect& frame) {
+        world = worldBounds;
+        background.setSize(sf::Vector2f(frame.width, frame.height));
+        background.setPosition(frame.left, frame.top);
+        background.setFillColor(sf::Color(0, 0, 0, 150));
+        background.setOutlineThickness(2);
+        background.setOutlineColor(sf::Color::White);
+
+        // Uniform scale, centred in the frame with a 10 px margin
+        float inner = std::min(frame.width, frame.height) - 20;
+        scale = inner / std::max(world.width, world.height);
+        width = std::max(1u, static_cast<unsigned>(world.width * scale));
+        height = std::max(1u, static_cast<unsigned>(world.height * scale));
+        origin = sf::Vector2f(std::floor(frame.left + (frame.width - width) / 2),
+                              std::floor(frame.top + (frame.height - height) / 2));
+
+        if (!base.create(width, height) || !fog.create(width, height)) {
+            std::cerr << "Failed to create minimap textures\n";
+            return false;
+        }
+
+        // Rooms, then closets, then walls on top; one draw for the lot
+        sf::VertexArray vertices(sf::Triangles);
+        for (const auto& room : rooms) {
+            appendQuad(vertices, toMap(room), sf::Color(45, 45, 60));
+        }
+        for (const auto& spot : hidingSpots) {
+            appendQuad(vertices, toMap(spot), sf::Color(139, 69, 19));
+        }
+        for (const auto& wall : walls) {
+            appendQuad(vertices, toMap(wall), sf::Color(160, 160, 160));
+        }
+        base.clear(sf::Color::Transparent);
+        base.draw(vertices);
+        base.display();
+        baseSprite.setTexture(base.getTexture(), true);
+        baseSprite.setPosition(origin);
+
+        // Everything starts hidden
+        fogPixels.assign(static_cast<size_t>(width) * height * 4, 0);
+        for (size_t i = 3; i < fogPixels.size(); i += 4) {
+            fogPixels[i] = 255;
+        }
+        fog.update(fogPixels.data());
+        fogSprite.setTexture(fog, true);
+        fogSprite.setPosition(origin);
+        lastReveal = sf::Vector2i(-1, -1);
+        return true;
+    }
+
+    // Clears the fog within radius of center (world units). Cheap when the
+    // area is already revealed: nothing is uploaded. The radius is assumed
+    // constant between calls.
+    void reveal(sf::Vector2f center, float radius) {
+        if (fogPixels.empty()) return;
+        float cx = (center.x - world.left) * scale;
+        float cy = (center.y - world.top) * scale;
+        float r = radius * scale;
+        sf::Vector2i pixel(static_cast<int>(cx), static_cast<int>(cy));
+        if (pixel == lastReveal) return; // Same texel, nothing new to clear
+        lastReveal = pixel;
+        int x0 = std::max(0, static_cast<int>(cx - r));
+        int y0 = std::max(0, static_cast<int>(cy - r));
+        int x1 = std::min(static_cast<int>(width) - 1, static_cast<int>(cx + r));
+        int y1 = std::min(static_cast<int>(height) - 1, static_cast<int>(cy + r));
+
+        int dirtyX0 = x1 + 1, dirtyY0 = y1 + 1, dirtyX1 = -1, dirtyY1 = -1;
+        for (int y = y0; y <= y1; y++) {
+            float dy = y + 0.5f - cy;
+            for (int x = x0; x <= x1; x++) {
+                float dx = x + 0.5f - cx;
+                uint8_t& alpha = fogPixels[(static_cast<size_t>(y) * width + x) * 4 + 3];
+                if (alpha == 0 || dx * dx + dy * dy > r * r) continue;
+                alpha = 0;
+                dirtyX0 = std::min(dirtyX0, x);
+                dirtyY0 = std::min(dirtyY0, y);
+                dirtyX1 = std::max(dirtyX1, x);
+                dirtyY1 = std::max(dirtyY1, y);
+            }
+        }
+        if (dirtyX1 < 0) return;
+
+        // Upload just the changed rectangle
+        unsigned w = dirtyX1 - dirtyX0 + 1, h = dirtyY1 - dirtyY0 + 1;
+        upload.resize(static_cast<size_t>(w) * h * 4);
+        for (unsigned row = 0; row < h; row++) {
+            const uint8_t* source = &fogPixels[(static_cast<size_t>(dirtyY0 + row) * width + dirtyX0) * 4];
+            std::copy(source, source + w * 4, &upload[static_cast<size_t>(row) * w * 4]);
+        }
+        fog.update(upload.data(), w, h, dirtyX0, dirtyY0);
+    }
+
+    // Rebuilds the player and Granny dots; positions are top-left corners
+    void setMarkers(sf::Vector2f player, const std::vector<sf::Vector2f>& grannies) {
+        markers.clear();
+        for (const auto& position : grannies) {
+            appendQuad(markers, marker(position), sf::Color::Magenta);
+        }
+        appendQuad(markers, marker(player), sf::Color::Green);
+    }
+
+private:
+    sf::RectangleShape background;
+    sf::RenderTexture base;
+    sf::Sprite baseSprite;
+    sf::Texture fog;
+    sf::Sprite fogSprite;
+    sf::VertexArray markers;
+    std::vector<uint8_t> fogPixels;  // RGBA, black; alpha 0 once revealed
+    std::vector<uint8_t> upload;     // Scratch for the changed rectangle
+
+    sf::FloatRect world;
+    sf::Vector2f origin; // Top-left of the map image in UI coordinates
+    sf::Vector2i lastReveal;
+    float scale;         // Minimap pixels per world unit
+    unsigned width, height;
+
+    sf::FloatRect toMap(const sf::FloatRect& rect) const {
+        // At least one pixel, so thin walls survive the downscale
+        return sf::FloatRect((rect.left - world.left) * scale, (rect.top - world.top) * scale,
+                             std::max(1.0f, rect.width * scale), std::max(1.0f, rect.height * scale));
+    }
+
+    sf::FloatRect marker(sf::Vector2f position) const {
+        sf::Vector2f p = origin + sf::Vector2f((position.x - world.left) * scale, (position.y - world.top) * scale);
+        return sf::FloatRect(p.x - 1, p.y - 1, 5, 5);
+    }
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override {
+        target.draw(background, states);
+        target.draw(baseSprite, states);
+        target.draw(fogSprite, states);
+        target.draw(markers, states);
+    }
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <shared_mutex>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include "wall_grid.h"
+
+// Navigation graph with one node per room and one edge per door, built
+// from the rooms made by createRoom() and the openings in doors. A* runs on
+// the room graph; results are cached per (source room, target room) as the
+// first door to walk through, so steady-state queries are a hash lookup.
+// The cache is one flat open-addressed table and A* reuses per-thread
+// scratch, so once the routes in use are cached, queries never allocate.
+// A cached answer is always the one A* gives for that pair, so routing is
+// deterministic however agents are scheduled.
+class NavGraph {
+public:
+    struct Door {
+        sf::Vector2f center;
+        int roomA;
+        int roomB;
+    };
+
+    // How far a door may sit from the rooms it connects
+    static constexpr float doorReach = 40.0f;
+
+    NavGraph() : cache(64, CacheSlot{emptyKey, -1}), cacheCount(0) {}
+
+    NavGraph(const NavGraph& other) {
+        *this = other;
+    }
+
+    NavGraph& operator=(const NavGraph& other) {
+        if (this == &other) return *this;
+        rooms = other.rooms;
+        roomCenters = other.roomCenters;
+        doors = other.doors;
+        linkStart = other.linkStart;
+        links = other.links;
+        roomGrid = other.roomGrid;
+        std::shared_lock<std::shared_mutex> lock(other.cacheMutex);
+        cache = other.cache;
+        cacheCount = other.cacheCount;
+        return *this;
+    }
+
+    void build(const std::vector<sf::FloatRect>& roomRects, const std::vector<sf::FloatRect>& doorRects) {
+        rooms = roomRects;
+        roomCenters.clear();
+        for (const auto& room : rooms) {
+            roomCenters.push_back(sf::Vector2f(room.left + room.width / 2, room.top + room.height / 2));
+        }
+        roomGrid.build(rooms, 256.0f);
+
+        // A door is an opening across its thin axis: it joins the nearest
+        // room on each side that lines up with it, within doorReach
+        doors.clear();
+        for (const auto& rect : doorRects) {
+            Door door;
+            door.center = sf::Vector2f(rect.left + rect.width / 2, rect.top + rect.height / 2);
+            door.roomA = door.roomB = -1;
+            bool acrossX = rect.height >= rect.width;
+            float distanceA = doorReach, distanceB = doorReach;
+            sf::FloatRect reach(rect.left - doorReach, rect.top - doorReach,
+                                rect.width + 2 * doorReach, rect.height + 2 * doorReach);
+            roomGrid.anyInRect(reach, [&](uint32_t room) {
+                const sf::FloatRect& r = rooms[room];
+                bool aligned = acrossX ? (r.top < rect.top + rect.height && rect.top < r.top + r.height)
+                                       : (r.left < rect.left + rect.width && rect.left < r.left + r.width);
+                float distance = distanceToRect(rect, r);
+                if (!aligned || distance > doorReach) return false;
+
+                bool before = acrossX ? roomCenters[room].x < door.center.x : roomCenters[room].y < door.center.y;
+                if (before && distance < distanceA) {
+                    door.roomA = static_cast<int>(room);
+                    distanceA = distance;
+                } else if (!before && distance < distanceB) {
+                    door.roomB = static_cast<int>(room);
+                    distanceB = distance;
+                }
+                return false;
+            });
+            if (door.roomA >= 0 && door.roomB >= 0) {
+                doors.push_back(door);
+            }
+        }
+
+        // Per-room adjacency, packed like WallGrid's cells
+        linkStart.assign(rooms.size() + 1, 0);
+        for (const auto& door : doors) {
+            linkStart[door.roomA + 1]++;
+            linkStart[door.roomB + 1]++;
+        }
+        for (size_t i = 1; i < linkStart.size(); i++) {
+            linkStart[i] += linkStart[i - 1];
+        }
+        links.resize(linkStart.back());
+        std::vector<uint32_t> fill(linkStart.begin(), linkStart.end() - 1);
+        for (uint32_t d = 0; d < doors.size(); d++) {
+            links[fill[doors[d].roomA]++] = d;
+            links[fill[doors[d].roomB]++] = d;
+        }
+
+        // Room for a few routes out of every room before the table grows;
+        // the size stays a power of two for the probe mask
+        size_t slots = 64;
+        while (slots < rooms.size() * 8) slots *= 2;
+        std::unique_lock<std::shared_mutex> lock(cacheMutex);
+        cache.assign(slots, CacheSlot{emptyKey, -1});
+        cacheCount = 0;
+
+        // Size the building thread's A* scratch now rather than on its
+        // first miss; worker threads size theirs on first use
+        Scratch& search = scratch();
+        search.cost.reserve(rooms.size());
+        search.viaDoor.reserve(rooms.size());
+        search.open.reserve(links.size() + 1);
+        search.path.reserve(rooms.size());
+    }
+
+    size_t roomCount() const { return rooms.size(); }
+    const Door& door(int index) const { return doors[index]; }
+    size_t doorCount() const { return doors.size(); }
+
+    // Room containing point, or -1 when it is outside every room
+    int roomAt(sf::Vector2f point) const {
+        int found = -1;
+        roomGrid.anyInRect(sf::FloatRect(point.x, point.y, 0, 0), [&](uint32_t room) {
+            if (!rooms[room].contains(point)) return false;
+            found = static_cast<int>(room);
+            return true;
+        });
+        return found;
+    }
+
+    // Calls visit(doorIndex) for each door out of room
+    template <typename Visit>
+    void forEachDoor(int room, Visit&& visit) const {
+        for (uint32_t i = linkStart[room]; i < linkStart[room + 1]; i++) {
+            visit(static_cast<int>(links[i]));
+        }
+    }
+
+    int otherSide(int doorIndex, int room) const {
+        const Door& d = doors[doorIndex];
+        return d.roomA == room ? d.roomB : d.roomA;
+    }
+
+    // First door on the shortest route from one room to another, or -1 when
+    // the rooms are the same or not connected. Safe to call from several
+    // threads; only cache misses take the exclusive lock.
+    int nextDoor(int fromRoom, int toRoom) const {
+        if (fromRoom < 0 || toRoom < 0 || fromRoom == toRoom) return -1;
+        uint64_t key = cacheKey(fromRoom, toRoom);
+        {
+            std::shared_lock<std::shared_mutex> lock(cacheMutex);
+            const CacheSlot& slot = cache[findSlot(key)];
+            if (slot.key == key) return slot.door;
+        }
+
+        // Only the queried pair is cached: with equal-cost alternatives a
+        // stored suffix could differ from A* run from that room, which would
+        // make results depend on query order (and thread timing)
+        std::vector<int>& path = scratch().path;
+        int doorIndex = findPath(fromRoom, toRoom, path) ? path.front() : -1;
+
+        std::unique_lock<std::shared_mutex> lock(cacheMutex);
+        if ((cacheCount + 1) * 2 > cache.size()) growCache();
+        CacheSlot& slot = cache[findSlot(key)];
+        if (slot.key != key) {
+            slot.key = key;
+            slot.door = doorIndex;
+            cacheCount++;
+        }
+        return doorIndex;
+    }
+
+    // Uncached A* over the room graph; fills the doors to walk through
+    bool findPath(int fromRoom, int toRoom, std::vector<int>& path) const {
+        path.clear();
+        if (fromRoom == toRoom) return true;
+
+        const float infinity = std::numeric_limits<float>::infinity();
+        Scratch& search = scratch();
+        std::vector<float>& cost = search.cost;
+        std::vector<int>& viaDoor = search.viaDoor;
+        std::vector<Entry>& open = search.open; // Min-heap
+        cost.assign(rooms.size(), infinity);
+        viaDoor.assign(rooms.size(), -1);
+        open.clear();
+        open.reserve(links.size() + 1); // A room is only pushed when a door improves it
+        path.reserve(rooms.size());
+
+        cost[fromRoom] = 0;
+        pushOpen(open, Entry(distance(roomCenters[fromRoom], roomCenters[toRoom]), fromRoom));
+        while (!open.empty()) {
+            std::pop_heap(open.begin(), open.end(), std::greater<Entry>());
+            Entry entry = open.back();
+            open.pop_back();
+            int room = entry.second;
+            if (room == toRoom) break;
+            if (entry.first > cost[room] + distance(roomCenters[room], roomCenters[toRoom])) continue;
+
+            for (uint32_t l = linkStart[room]; l < linkStart[room + 1]; l++) {
+                int doorIndex = static_cast<int>(links[l]);
+                int next = otherSide(doorIndex, room);
+                float step = distance(roomCenters[room], doors[doorIndex].center) +
+                             distance(doors[doorIndex].center, roomCenters[next]);
+                if (cost[room] + step < cost[next]) {
+                    cost[next] = cost[room] + step;
+                    viaDoor[next] = doorIndex;
+                    pushOpen(open, Entry(cost[next] + distance(roomCenters[next], roomCenters[toRoom]), next));
+                }
+            }
+        }
+        if (viaDoor[toRoom] < 0) return false;
+
+        for (int room = toRoom; room != fromRoom; room = otherSide(viaDoor[room], room)) {
+            path.push_back(viaDoor[room]);
+        }
+        std::reverse(path.begin(), path.end());
+        return true;
+    }
+
+    size_t cachedRoutes() const {
+        std::shared_lock<std::shared_mutex> lock(cacheMutex);
+        return cacheCount;
+    }
+
+private:
+    typedef std::pair<float, int> Entry; // (cost + heuristic, room)
+
+    // A* working storage, kept per thread so misses on worker threads
+    // neither allocate once warm nor share buffers
+    struct Scratch {
+        std::vector<float> cost;
+        std::vector<int> viaDoor;
+        std::vector<Entry> open;
+        std::vector<int> path;
+    };
+
+    struct CacheSlot {
+        uint64_t key;
+        int door;
+    };
+
+    static constexpr uint64_t emptyKey = ~0ull;
+
+    std::vector<sf::FloatRect> rooms;
+    std::vector<sf::Vector2f> roomCenters;
+    std::vector<Door> doors;
+    std::vector<uint32_t> linkStart; // Doors of room r: links[linkStart[r]..linkStart[r + 1]]
+    std::vector<uint32_t> links;
+    WallGrid roomGrid;
+
+    mutable std::shared_mutex cacheMutex;
+    mutable std::vector<CacheSlot> cache; // Linear probing, at most half full
+    mutable size_t cacheCount;
+
+    static Scratch& scratch() {
+        static thread_local Scratch buffers;
+        return buffers;
+    }
+
+    static void pushOpen(std::vector<Entry>& open, Entry entry) {
+        open.push_back(entry);
+        std::push_heap(open.begin(), open.end(), std::greater<Entry>());
+    }
+
+    // Slot holding key, or the empty slot where it would go
+    size_t findSlot(uint64_t key) const {
+        size_t mask = cache.size() - 1;
+        size_t i = static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+        while (cache[i].key != key && cache[i].key != emptyKey) i = (i + 1) & mask;
+        return i;
+    }
+
+    void growCache() const {
+        std::vector<CacheSlot> old(cache.size() * 2, CacheSlot{emptyKey, -1});
+        old.swap(cache);
+        for (const CacheSlot& slot : old) {
+            if (slot.key != emptyKey) cache[findSlot(slot.key)] = slot;
+        }
+    }
+
+    static uint64_t cacheKey(int fromRoom, int toRoom) {
+        return (static_cast<uint64_t>(fromRoom) << 32) | static_cast<uint32_t>(toRoom);
+    }
+
+    static float distance(sf::Vector2f a, sf::Vector2f b) {
+        return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+    }
+
+    // Gap between two rectangles, 0 when they touch or overlap
+    static float distanceToRect(const sf::FloatRect& a, const sf::FloatRect& b) {
+        float dx = std::max(0.0f, std::max(b.left - (a.left + a.width), a.left - (b.left + b.width)));
+        float dy = std::max(0.0f, std::max(b.top - (a.top + a.height), a.top - (b.top + b.height)));
+        return std::sqrt(dx * dx + dy * dy);
+    }
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include "net_protocol.h"
+#include "rng.h"
+
+// Non-blocking UDP socket with a simulated network in front of it, so
+// co-op can be tested offline over loopback. Outgoing datagrams are
+// dropped with probability loss, or held for latency plus up to jitter
+// seconds before they go out; with jitter they can arrive out of order,
+// as on a real link. Held datagrams sit in a fixed ring, so sending never
+// allocates. Counts every datagram and byte in each direction.
+class NetLink {
+public:
+    struct Conditions {
+        float loss = 0;    // 0..1
+        float latency = 0; // Seconds added to every datagram, one way
+        float jitter = 0;  // Up to this much more, at random
+    };
+
+    struct Stats {
+        uint64_t packetsSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t packetsReceived = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t dropped = 0; // By the simulated loss, or a full ring
+    };
+
+    // Bytes of IPv4 and UDP header on every datagram, for bandwidth figures
+    static constexpr size_t headerBytes = 28;
+
+    // Datagrams the simulator can hold at once
+    static constexpr size_t maxHeld = 256;
+
+    NetLink() : held(maxHeld), rng(1) {
+        socket.setBlocking(false);
+    }
+
+    // Any free port when port is 0
+    bool bind(unsigned short port = 0) {
+        if (socket.bind(port) != sf::Socket::Done) {
+            std::cerr << "Failed to bind UDP port " << port << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    unsigned short localPort() const { return socket.getLocalPort(); }
+
+    void simulate(const Conditions& newConditions, uint32_t seed) {
+        conditions = newConditions;
+        rng = Rng(seed);
+    }
+
+    void send(const uint8_t* data, size_t size, const sf::IpAddress& address, unsigned short port) {
+        if (conditions.loss > 0 && rng.nextInt(10000) < static_cast<int>(conditions.loss * 10000)) {
+            stats.dropped++;
+            return;
+        }
+        if (conditions.latency <= 0 && conditions.jitter <= 0) {
+            transmit(data, size, address, port);
+            return;
+        }
+        float delay = conditions.latency;
+        if (conditions.jitter > 0) delay += conditions.jitter * (rng.nextInt(1001) / 1000.0f);
+        for (Held& slot : held) {
+            if (slot.size > 0) continue;
+            slot.due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(delay));
+            slot.size = size;
+            slot.address = address;
+            slot.port = port;
+            std::memcpy(slot.data, data, size);
+            return;
+        }
+        stats.dropped++;
+    }
+
+    // Sends held datagrams whose time has come, then returns the next one
+    // that arrived; false when there is none
+    bool receive(uint8_t* data, size_t& size, sf::IpAddress& address, unsigned short& port) {
+        flush();
+        size_t received = 0;
+        if (socket.receive(data, maxPacketSize, received, address, port) != sf::Socket::Done) return false;
+        size = received;
+        stats.packetsReceived++;
+        stats.bytesReceived += received;
+        return true;
+    }
+
+    void flush() {
+        Clock::time_point now = Clock::now();
+        for (Held& slot : held) {
+            if (slot.size > 0 && slot.due <= now) {
+                transmit(slot.data, slot.size, slot.address, slot.port);
+                slot.size = 0;
+            }
+        }
+    }
+
+    const Stats& getStats() const { return stats; }
+
+    // Milliseconds on a steady clock, for timestamps that round-trip
+    static uint32_t nowMs() {
+        return static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count());
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Held {
+        Clock::time_point due;
+        size_t size = 0; // 0 for a free slot
+        sf::IpAddress address;
+        unsigned short port = 0;
+        uint8_t data[maxPacketSize];
+    };
+
+    sf::UdpSocket socket;
+    Conditions conditions;
+    std::vector<Held> held;
+    Rng rng;
+    Stats stats;
+
+    void transmit(const uint8_t* data, size_t size, const sf::IpAddress& address, unsigned short port) {
+        if (socket.send(data, size, address, port) != sf::Socket::Done) return;
+        stats.packetsSent++;
+        stats.bytesSent += size;
+    }
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include "simulation.h"
+
+// Co-op wire format. Every datagram starts with the protocol id, version
+// and a packet type; integers are little-endian, and the snapshot body is
+// varints. Clients send:
+//
+//   HELLO     uint32 mapHash
+//   INPUT     uint32 ackTick  uint32 sendTime  uint32 newestSeq
+//             uint8 count  uint8 buttons[count], newest first
+//   BYE
+//
+// and the server answers:
+//
+//   WELCOME   uint8 slot
+//   REJECT    uint8 reason
+//   SNAPSHOT  uint32 tick  uint32 baseTick  uint32 inputSeq
+//             uint32 echoTime  uint16 holdTime  uint16 grannies
+//             uint16 items  delta from the base state (see writeDelta)
+//
+// Inputs are resent (the last few in every packet) instead of
+// acknowledged. Snapshots are deltas against the newest state the client
+// acknowledged, or against the map's start state (see startState) when
+// there is none.
+constexpr uint16_t netProtocolId = 0x334c; // "L3"
+constexpr uint8_t netProtocolVersion = 1;
+constexpr size_t maxPacketSize = 1200; // Under any common MTU
+constexpr uint32_t snapshotInterval = 3; // Ticks between snapshots, so 20 a second
+
+// Longest round trip co-op is built for. The server keeps each client's
+// sent states, and the client its received ones, for this long plus two
+// snapshots (the one in flight and one for jitter); past it every
+// snapshot is sent whole. Clients keep their inputs for replay as long.
+constexpr uint32_t maxRoundTripMs = 2000;
+constexpr size_t maxRoundTripTicks = static_cast<size_t>(maxRoundTripMs / 1000.0f / Simulation::fixedDt + 0.5f);
+constexpr size_t snapshotHistory = maxRoundTripTicks / snapshotInterval + 2;
+
+enum class NetPacket : uint8_t { HELLO, WELCOME, REJECT, INPUT, SNAPSHOT, BYE };
+enum class NetReject : uint8_t { SERVER_FULL, WRONG_MAP };
+
+// Fills a fixed buffer; stops writing (and reports !ok) rather than overflow
+class PacketWriter {
+public:
+    PacketWriter() : used(0), overflow(false) {}
+
+    void begin(NetPacket type) {
+        used = 0;
+        overflow = false;
+        putU16(netProtocolId);
+        putU8(netProtocolVersion);
+        putU8(static_cast<uint8_t>(type));
+    }
+
+    void putU8(uint8_t v) {
+        if (used + 1 > maxPacketSize) {
+            overflow = true;
+            return;
+        }
+        bytes[used++] = v;
+    }
+    void putU16(uint16_t v) {
+        putU8(static_cast<uint8_t>(v));
+        putU8(static_cast<uint8_t>(v >> 8));
+    }
+    void putU32(uint32_t v) {
+        putU16(static_cast<uint16_t>(v));
+        putU16(static_cast<uint16_t>(v >> 16));
+    }
+    void putVarint(uint32_t v) {
+        while (v >= 0x80) {
+            putU8(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        putU8(static_cast<uint8_t>(v));
+    }
+
+    bool ok() const { return !overflow; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return used; }
+
+private:
+    uint8_t bytes[maxPacketSize];
+    size_t used;
+    bool overflow;
+};
+
+// Reads a received datagram; any read past the end leaves ok() false
+class PacketReader {
+public:
+    PacketReader(const uint8_t* data, size_t size) : bytes(data), size(size), used(0), failed(false) {}
+
+    // Checks the id and version and returns the packet type
+    bool begin(NetPacket& type) {
+        uint16_t id = getU16();
+        uint8_t version = getU8();
+        type = static_cast<NetPacket>(getU8());
+        return ok() && id == netProtocolId && version == netProtocolVersion;
+    }
+
+    uint8_t getU8() {
+        if (used + 1 > size) {
+            failed = true;
+            return 0;
+        }
+        return bytes[used++];
+    }
+    uint16_t getU16() {
+        uint16_t low = getU8();
+        return static_cast<uint16_t>(low | getU8() << 8);
+    }
+    uint32_t getU32() {
+        uint32_t low = getU16();
+        return low | static_cast<uint32_t>(getU16()) << 16;
+    }
+    uint32_t getVarint() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = getU8();
+            v |= static_cast<uint32_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        failed = true;
+        return 0;
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    const uint8_t* bytes;
+    size_t size;
+    size_t used;
+    bool failed;
+};
+
+inline uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v) {
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+inline size_t varintSize(uint32_t v) {
+    size_t bytes = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+// What clients are told about the game, quantized into a flat list of
+// integer fields so that a delta is just the fields that changed.
+// Positions are in eighths of a unit, the time in 1/256 hours.
+//
+//   health day time flags catches teleports
+//   per player slot: x y present
+//   per Granny: x y
+//   per item: collected
+struct NetState {
+    static constexpr size_t maxPlayers = 1 + Simulation::maxPartners;
+    static constexpr float positionScale = 8.0f;
+    static constexpr float timeScale = 256.0f;
+    enum Field : size_t { HEALTH, DAY, TIME, FLAGS, CATCHES, TELEPORTS, HEADER_FIELDS };
+    enum Flag : int32_t { GAME_OVER = 1, GAME_WON = 2 };
+
+    uint32_t tick = 0; // 0 for none
+    uint16_t grannyCount = 0;
+    uint16_t itemCount = 0;
+    std::vector<int32_t> values;
+
+    // All zeros, keeping the storage
+    void reset(uint16_t grannies, uint16_t items) {
+        tick = 0;
+        grannyCount = grannies;
+        itemCount = items;
+        values.assign(itemField(items), 0);
+    }
+
+    bool sameShape(const NetState& other) const {
+        return grannyCount == other.grannyCount && itemCount == other.itemCount;
+    }
+
+    static size_t playerField(size_t slot) { return HEADER_FIELDS + 3 * slot; }
+    static size_t grannyField(size_t i) { return playerField(maxPlayers) + 2 * i; }
+    size_t itemField(size_t i) const { return grannyField(grannyCount) + i; }
+
+    static int32_t quantize(float v) { return static_cast<int32_t>(std::lround(v * positionScale)); }
+    static float position(int32_t v) { return v / positionScale; }
+
+    void setPlayer(size_t slot, sf::Vector2f p, bool present) {
+        values[playerField(slot)] = quantize(p.x);
+        values[playerField(slot) + 1] = quantize(p.y);
+        values[playerField(slot) + 2] = present;
+    }
+    void setGranny(size_t i, sf::Vector2f p) {
+        values[grannyField(i)] = quantize(p.x);
+        values[grannyField(i) + 1] = quantize(p.y);
+    }
+
+    sf::Vector2f player(size_t slot) const {
+        return sf::Vector2f(position(values[playerField(slot)]), position(values[playerField(slot) + 1]));
+    }
+    bool playerPresent(size_t slot) const { return values[playerField(slot) + 2] != 0; }
+    sf::Vector2f granny(size_t i) const {
+        return sf::Vector2f(position(values[grannyField(i)]), position(values[grannyField(i) + 1]));
+    }
+    bool itemCollected(size_t i) const { return values[itemField(i)] != 0; }
+    float time() const { return values[TIME] / timeScale; }
+    bool flag(Flag f) const { return (values[FLAGS] & f) != 0; }
+};
+
+// Fields of next that differ from base: the count, then for each one the
+// gap from the previous changed field and the zigzag difference, both as
+// varints. Unchanged fields cost nothing, so a quiet game sends a few bytes.
+inline void writeDelta(PacketWriter& out, const NetState& base, const NetState& next) {
+    uint32_t changed = 0;
+    for (size_t f = 0; f < next.values.size(); f++) {
+        changed += next.values[f] != base.values[f];
+    }
+    out.putVarint(changed);
+    size_t last = 0;
+    for (size_t f = 0; f < next.values.size(); f++) {
+        if (next.values[f] == base.values[f]) continue;
+        out.putVarint(static_cast<uint32_t>(f - last));
+        out.putVarint(zigzag(next.values[f] - base.values[f]));
+        last = f;
+    }
+}
+
+// next must already have base's values and its own shape
+inline bool readDelta(PacketReader& in, NetState& next) {
+    uint32_t changed = in.getVarint();
+    size_t f = 0;
+    for (uint32_t k = 0; k < changed && in.ok(); k++) {
+        f += in.getVarint();
+        if (f >= next.values.size()) return false;
+        next.values[f] += unzigzag(in.getVarint());
+    }
+    return in.ok();
+}
+
+// Bytes writeDelta would spend on one changed field, ignoring its gap
+inline size_t fieldCost(int32_t from, int32_t to) {
+    return from == to ? 0 : 1 + varintSize(zigzag(to - from));
+}
+
+// Server and client must run the same map; FNV-1a over its geometry
+inline uint32_t mapHash(const Simulation& sim) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    for (const auto& wall : sim.walls) mix(&wall, sizeof(wall));
+    for (const auto& door : sim.doors) mix(&door, sizeof(door));
+    for (const auto& item : sim.items) mix(&item.bounds, sizeof(item.bounds));
+    uint32_t grannies = static_cast<uint32_t>(sim.grannies.size());
+    mix(&grannies, sizeof(grannies));
+    return hash;
+}
+
+// What both ends assume before any snapshot: Grannies at their spawns, no
+// players, nothing collected. A snapshot with no acknowledged base is a
+// delta from this, so the Grannies that do not fit in it are still drawn
+// somewhere sensible.
+inline void startState(NetState& state, const Simulation& sim) {
+    state.reset(static_cast<uint16_t>(sim.grannies.size()), static_cast<uint16_t>(sim.items.size()));
+    for (size_t i = 0; i < sim.grannies.size(); i++) {
+        state.setGranny(i, sim.grannies.spawn[i]);
+    }
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "agent_pool.h"
+#include "wall_grid.h"
+#include "nav_graph.h"
+
+// What Granny can see: a cone in front of her and a small circle all
+// around, both cut off by walls
+struct VisionCone {
+    float range = 350.0f;
+    float cosHalfAngle = 0.5f;  // cos(60 degrees)
+    float nearRange = 80.0f;    // Sensed in any direction this close
+};
+
+// Noise events spread through the room/door graph. Each room reached keeps
+// the loudness left when the sound arrived and the point it came in by
+// (the source in its own room, otherwise the door), so an agent can hear
+// it and head for where it came from.
+class NoiseMap {
+public:
+    // Loudness lost per door passed, on top of the distance travelled
+    static constexpr float doorPenalty = 150.0f;
+
+    NoiseMap() : tick(1), lastEmit(0) {}
+
+    void build(const NavGraph& graph) {
+        level.assign(graph.roomCount(), 0);
+        entry.assign(graph.roomCount(), sf::Vector2f(0, 0));
+        stamp.assign(graph.roomCount(), 0);
+        frontier.clear();
+        frontier.reserve(2 * graph.doorCount() + 1); // Each room spreads once
+        tick = 1; // Stamps of 0 are never current
+        lastEmit = 0;
+    }
+
+    // Forgets the previous tick's noises
+    void beginTick() { tick++; }
+
+    // True when nothing was heard anywhere this tick
+    bool silent() const { return lastEmit != tick; }
+
+    // A sound of loudness (in world units of travel) made at position.
+    // Dijkstra from the source room; stops where nothing would be left.
+    void emit(const NavGraph& graph, sf::Vector2f position, float loudness) {
+        int source = graph.roomAt(position);
+        if (source < 0 || loudness <= 0) return;
+        lastEmit = tick;
+        reach(source, position, loudness);
+        pushFront({loudness, source});
+        while (!frontier.empty()) {
+            std::pop_heap(frontier.begin(), frontier.end());
+            Front front = frontier.back();
+            frontier.pop_back();
+            if (front.level < level[front.room]) continue; // Stale entry
+            sf::Vector2f from = entry[front.room];
+            graph.forEachDoor(front.room, [&](int door) {
+                const NavGraph::Door& d = graph.door(door);
+                sf::Vector2f toDoor = d.center - from;
+                float left = front.level - std::sqrt(toDoor.x * toDoor.x + toDoor.y * toDoor.y) - doorPenalty;
+                int next = graph.otherSide(door, front.room);
+                if (left > 0 && reach(next, d.center, left)) pushFront({left, next});
+            });
+        }
+    }
+
+    // Loudness reaching position in room this tick (0 when silent), and
+    // where it came from
+    float heard(int room, sf::Vector2f position, sf::Vector2f& from) const {
+        if (room < 0 || room >= static_cast<int>(stamp.size()) || stamp[room] != tick) return 0;
+        sf::Vector2f d = position - entry[room];
+        from = entry[room];
+        return std::max(0.0f, level[room] - std::sqrt(d.x * d.x + d.y * d.y));
+    }
+
+private:
+    struct Front {
+        float level;
+        int room;
+        bool operator<(const Front& other) const { return level < other.level; }
+    };
+
+    std::vector<float> level;
+    std::vector<sf::Vector2f> entry;
+    std::vector<uint32_t> stamp; // Tick a room's level belongs to
+    uint32_t tick;
+    uint32_t lastEmit;
+    std::vector<Front> frontier; // Max-heap, reserved at build
+
+    void pushFront(Front front) {
+        frontier.push_back(front);
+        std::push_heap(frontier.begin(), frontier.end());
+    }
+
+    // Records a louder arrival at room; false if it is no louder
+    bool reach(int room, sf::Vector2f at, float loudness) {
+        if (stamp[room] == tick && level[room] >= loudness) return false;
+        stamp[room] = tick;
+        level[room] = loudness;
+        entry[room] = at;
+        return true;
+    }
+};
+
+// Sight for every Granny, within a fixed number of queries per tick. Agents
+// are visited round-robin from where the last tick stopped; an agent too
+// far from the player to see it is answered without rays and costs
+// nothing. Agents not reached keep their previous answer, so with many
+// agents each one looks a few times a second instead of every tick.
+class Perception {
+public:
+    // Sight queries per tick, each up to sightRays wall tests
+    static constexpr size_t defaultBudget = 256;
+    static constexpr int sightRays = 5;
+
+    // Players one agent can look at in a tick
+    static constexpr size_t maxPlayers = 4;
+
+    VisionCone vision;
+    NoiseMap noise;
+    size_t budget;
+
+    Perception() : budget(defaultBudget), cursor(0), queries(0) {}
+
+    void build(const NavGraph& graph) {
+        noise.build(graph);
+        cursor = 0;
+    }
+
+    void reset() { cursor = 0; }
+
+    // Next agent the sight round-robin will test, for save states
+    size_t cursorIndex() const { return cursor; }
+    void setCursor(size_t agent) { cursor = agent; }
+
+    // Refreshes seesPlayer for agents until the budget is spent
+    void updateSight(GrannyPool& agents, sf::Vector2f agentSize, const sf::FloatRect& player, const WallGrid& walls) {
+        updateSight(agents, agentSize, &player, 1, walls);
+    }
+
+    // Same with several players (co-op). An agent looks at the players in
+    // range, nearest first, and seesPlayer becomes the index + 1 of the
+    // first it can see. Each player looked at is one query.
+    void updateSight(GrannyPool& agents, sf::Vector2f agentSize, const sf::FloatRect* players, size_t playerCount,
+                     const WallGrid& walls) {
+        queries = 0;
+        size_t count = agents.size();
+        if (count == 0) return;
+        cursor %= count;
+        for (size_t visited = 0; visited < count; visited++) {
+            size_t i = cursor;
+            cursor = (cursor + 1) % count;
+            sf::Vector2f eye = agents.position[i] + agentSize / 2.0f;
+
+            // Players in range, by distance; at most a handful
+            uint8_t order[maxPlayers];
+            float distance[maxPlayers];
+            size_t inSight = 0;
+            for (size_t p = 0; p < playerCount && p < maxPlayers; p++) {
+                float d = rangeSquared(eye, players[p]);
+                if (d > vision.range * vision.range) continue;
+                size_t k = inSight++;
+                for (; k > 0 && distance[k - 1] > d; k--) {
+                    order[k] = order[k - 1];
+                    distance[k] = distance[k - 1];
+                }
+                order[k] = static_cast<uint8_t>(p);
+                distance[k] = d;
+            }
+            if (inSight == 0) {
+                agents.seesPlayer[i] = 0;
+                continue;
+            }
+            if (queries >= budget) {
+                cursor = i; // Resume here next tick
+                break;
+            }
+            agents.seesPlayer[i] = 0;
+            for (size_t k = 0; k < inSight; k++) {
+                queries++;
+                if (canSee(eye, agents.facing[i], players[order[k]], walls)) {
+                    agents.seesPlayer[i] = static_cast<uint8_t>(order[k] + 1);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Sight queries spent in the last updateSight()
+    size_t lastQueries() const { return queries; }
+
+    // True when any of several points on target (centre and inset corners)
+    // is in the cone, or close, and has a clear line to the eye. Several
+    // rays let a partly hidden player be seen.
+    bool canSee(sf::Vector2f eye, sf::Vector2f facing, const sf::FloatRect& target, const WallGrid& walls) const {
+        float insetX = target.width * 0.2f, insetY = target.height * 0.2f;
+        sf::Vector2f points[sightRays] = {
+            {target.left + target.width / 2, target.top + target.height / 2},
+            {target.left + insetX, target.top + insetY},
+            {target.left + target.width - insetX, target.top + insetY},
+            {target.left + insetX, target.top + target.height - insetY},
+            {target.left + target.width - insetX, target.top + target.height - insetY}};
+        for (const auto& point : points) {
+            sf::Vector2f d = point - eye;
+            float distanceSquared = d.x * d.x + d.y * d.y;
+            if (distanceSquared > vision.range * vision.range) continue;
+            if (distanceSquared > vision.nearRange * vision.nearRange) {
+                // In the cone: cos(angle to facing) above the limit
+                float along = d.x * facing.x + d.y * facing.y;
+                if (along <= 0 || along * along < vision.cosHalfAngle * vision.cosHalfAngle * distanceSquared) continue;
+            }
+            if (!walls.segmentBlocked(eye, point)) return true;
+        }
+        return false;
+    }
+
+private:
+    size_t cursor;
+    size_t queries;
+
+    // Squared distance from the eye to the player's box
+    static float rangeSquared(sf::Vector2f eye, const sf::FloatRect& player) {
+        float dx = std::max({player.left - eye.x, 0.0f, eye.x - player.left - player.width});
+        float dy = std::max({player.top - eye.y, 0.0f, eye.y - player.top - player.height});
+        return dx * dx + dy * dy;
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Uniform grid over points that move every tick, such as Granny positions.
+// build() bins them with a counting sort into flat arrays it reuses
+// (cellStart[c]..cellStart[c + 1] in cellPoints), so rebuilding each tick
+// does not allocate once the arrays have grown. forEachIn() visits only the
+// points in cells overlapping an area. Points outside the bounds go in the
+// edge cells.
+class PointGrid {
+public:
+    PointGrid() : cellSize(512.0f), inverseCell(1 / 512.0f), columns(0), rows(0) {}
+
+    void reset(const sf::FloatRect& bounds, float size = 512.0f) {
+        cellSize = size;
+        inverseCell = 1 / size;
+        origin = sf::Vector2f(bounds.left, bounds.top);
+        columns = std::max(1, static_cast<int>(bounds.width * inverseCell) + 1);
+        rows = std::max(1, static_cast<int>(bounds.height * inverseCell) + 1);
+        cellStart.assign(columns * rows + 1, 0);
+        cellPoints.clear();
+    }
+
+    bool ready() const { return columns > 0; }
+
+    void build(const std::vector<sf::Vector2f>& points) {
+        if (columns == 0) return;
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        pointCell.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            pointCell[i] = static_cast<uint32_t>(row(points[i].y) * columns + column(points[i].x));
+            cellStart[pointCell[i] + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); c++) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        fill.assign(cellStart.begin(), cellStart.end() - 1);
+        cellPoints.resize(points.size());
+        for (uint32_t i = 0; i < points.size(); i++) {
+            cellPoints[fill[pointCell[i]]++] = i;
+        }
+    }
+
+    // Calls f(index) for every point in a cell that overlaps area; the
+    // caller still tests each one exactly
+    template <typename F>
+    void forEachIn(const sf::FloatRect& area, F&& f) const {
+        if (columns == 0) return;
+        int x0 = column(area.left), x1 = column(area.left + area.width);
+        int y0 = row(area.top), y1 = row(area.top + area.height);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                int cell = y * columns + x;
+                for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    f(cellPoints[k]);
+                }
+            }
+        }
+    }
+
+    size_t size() const { return cellPoints.size(); }
+
+private:
+    float cellSize;
+    float inverseCell;
+    sf::Vector2f origin;
+    int columns;
+    int rows;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellPoints; // Point indices, grouped by cell
+    std::vector<uint32_t> pointCell;
+    std::vector<uint32_t> fill;
+
+    // Truncation rounds towards zero, so anything left of or above the
+    // origin clamps into the first column or row
+    int column(float x) const {
+        return std::max(0, std::min(columns - 1, static_cast<int>((x - origin.x) * inverseCell)));
+    }
+    int row(float y) const {
+        return std::max(0, std::min(rows - 1, static_cast<int>((y - origin.y) * inverseCell)));
+    }
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+// Phases of a frame that get their own timer
+enum class ProfilePhase : uint8_t {
+    PROCESS_EVENTS,
+    UPDATE_PLAYER,
+    UPDATE_GRANNIES,
+    UPDATE_ITEMS,
+    UPDATE_UI,
+    RENDER_WORLD,
+    DISPLAY,
+    COUNT
+};
+
+inline const char* profilePhaseName(ProfilePhase phase) {
+    static const char* const names[] = {
+        "processEvents", "updatePlayer", "updateGrannies", "updateItems", "updateUI", "renderWorld", "display"
+    };
+    return names[static_cast<size_t>(phase)];
+}
+
+struct ProfileSample {
+    uint64_t start;    // ns since the profiler was created
+    uint32_t duration; // ns
+    ProfilePhase phase;
+    uint8_t thread;    // Small per-thread index, for the trace view
+};
+
+// Always-on frame profiler. Timers on any thread write into a fixed
+// lock-free ring (a slot is claimed with one fetch_add; no locks, no
+// allocation). Once per frame, one thread calls collect() to move new
+// samples into per-phase rolling windows and an export history that keeps
+// the most recent samples for the CSV and Chrome trace dumps.
+class Profiler {
+public:
+    static constexpr size_t ringCapacity = 1 << 14;      // Samples between two collect() calls
+    static constexpr size_t windowSize = 240;            // Samples per phase in the rolling stats
+    static constexpr size_t historyCapacity = 1 << 18;   // Samples kept for export (minutes of play)
+
+    struct PhaseStats {
+        double minUs;
+        double avgUs;
+        double p99Us;
+        size_t samples;
+    };
+
+    Profiler() : epoch(Clock::now()), slots(ringCapacity), head(0), readCursor(0), historyCursor(0), historyCount(0),
+                 dropped(0) {
+        for (Slot& slot : slots) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+        }
+        for (Window& window : windows) {
+            window.cursor = window.count = 0;
+        }
+        history.resize(historyCapacity);
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    uint64_t now() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count());
+    }
+
+    // Safe from any thread
+    void record(ProfilePhase phase, uint64_t start, uint64_t end) {
+        uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[index & (ringCapacity - 1)];
+        uint64_t packed = std::min<uint64_t>(end - start, 0xffffffffu) |
+                          (static_cast<uint64_t>(phase) << 32) | (static_cast<uint64_t>(threadIndex()) << 40);
+
+        // Odd sequence while writing, so collect() skips a torn slot
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.packed.store(packed, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    // Single consumer; call once per frame
+    void collect() {
+        uint64_t end = head.load(std::memory_order_acquire);
+        if (end - readCursor > ringCapacity) {
+            dropped += end - readCursor - ringCapacity;
+            readCursor = end - ringCapacity;
+        }
+        for (; readCursor < end; readCursor++) {
+            Slot& slot = slots[readCursor & (ringCapacity - 1)];
+            uint64_t expected = 2 * readCursor + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                // Still being written: stop and pick it up next frame
+                if (slot.sequence.load(std::memory_order_relaxed) < expected) break;
+                dropped++;
+                continue;
+            }
+            ProfileSample sample;
+            sample.start = slot.start.load(std::memory_order_relaxed);
+            uint64_t packed = slot.packed.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+                dropped++;
+                continue;
+            }
+            sample.duration = static_cast<uint32_t>(packed);
+            sample.phase = static_cast<ProfilePhase>((packed >> 32) & 0xff);
+            sample.thread = static_cast<uint8_t>(packed >> 40);
+            add(sample);
+        }
+    }
+
+    PhaseStats stats(ProfilePhase phase) const {
+        const Window& window = windows[static_cast<size_t>(phase)];
+        PhaseStats result = {0, 0, 0, window.count};
+        if (window.count == 0) return result;
+
+        std::array<uint32_t, windowSize> sorted;
+        std::copy(window.durations.begin(), window.durations.begin() + window.count, sorted.begin());
+        std::sort(sorted.begin(), sorted.begin() + window.count);
+        uint64_t total = 0;
+        for (size_t i = 0; i < window.count; i++) {
+            total += sorted[i];
+        }
+        result.minUs = sorted[0] / 1000.0;
+        result.avgUs = static_cast<double>(total) / window.count / 1000.0;
+        result.p99Us = sorted[static_cast<size_t>(0.99 * (window.count - 1))] / 1000.0;
+        return result;
+    }
+
+    uint64_t droppedSamples() const { return dropped; }
+
+    // One row per sample, oldest first
+    bool writeCsv(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            std::cerr << "Failed to write profile " << filename << "\n";
+            return false;
+        }
+        file << "phase,thread,start_ns,duration_ns\n";
+        forEachSample([&](const ProfileSample& sample) {
+            file << profilePhaseName(sample.phase) << "," << static_cast<int>(sample.thread) << ","
+                 << sample.start << "," << sample.duration << "\n";
+        });
+        return static_cast<bool>(file);
+    }
+
+    // Chrome trace event format; open in chrome://tracing or Perfetto
+    bool writeChromeTrace(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            std::cerr << "Failed to write profile " << filename << "\n";
+            return false;
+        }
+        file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+        bool first = true;
+        forEachSample([&](const ProfileSample& sample) {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << profilePhaseName(sample.phase)
+                 << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << static_cast<int>(sample.thread)
+                 << ",\"ts\":" << sample.start / 1000.0 << ",\"dur\":" << sample.duration / 1000.0 << "}";
+            first = false;
+        });
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> packed; // duration | phase << 32 | thread << 40
+    };
+
+    struct Window {
+        std::array<uint32_t, windowSize> durations;
+        size_t cursor;
+        size_t count;
+    };
+
+    Clock::time_point epoch;
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> head;
+
+    // Consumer side
+    uint64_t readCursor;
+    std::array<Window, static_cast<size_t>(ProfilePhase::COUNT)> windows;
+    std::vector<ProfileSample> history;
+    size_t historyCursor;
+    size_t historyCount;
+    uint64_t dropped;
+
+    void add(const ProfileSample& sample) {
+        if (sample.phase >= ProfilePhase::COUNT) return;
+        Window& window = windows[static_cast<size_t>(sample.phase)];
+        window.durations[window.cursor] = sample.duration;
+        window.cursor = (window.cursor + 1) % windowSize;
+        window.count = std::min(window.count + 1, windowSize);
+
+        history[historyCursor] = sample;
+        historyCursor = (historyCursor + 1) % historyCapacity;
+        historyCount = std::min(historyCount + 1, historyCapacity);
+    }
+
+    template <typename Fn>
+    void forEachSample(Fn&& fn) const {
+        size_t first = (historyCursor + historyCapacity - historyCount) % historyCapacity;
+        for (size_t i = 0; i < historyCount; i++) {
+            fn(history[(first + i) % historyCapacity]);
+        }
+    }
+
+    static uint8_t threadIndex() {
+        static std::atomic<uint8_t> nextThread(0);
+        thread_local uint8_t index = nextThread.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+};
+
+// Times the enclosing scope into profiler; does nothing when it is null
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, ProfilePhase phase)
+        : profiler(profiler), phase(phase), start(profiler ? profiler->now() : 0) {}
+
+    ~ProfileScope() {
+        if (profiler) profiler->record(phase, start, profiler->now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* profiler;
+    ProfilePhase phase;
+    uint64_t start;
+};
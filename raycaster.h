@@ -0,0 +1,227 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "wall_grid.h"
+#include "job_system.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// First-person view of the map, drawn on the CPU into an RGBA framebuffer
+// laid out for sf::Texture::update(). It works in two passes. The column
+// pass casts one ray per screen column through the WallGrid and records
+// the wall span and its colour, shaded by distance. The row pass fills
+// each row from those spans and the floor or ceiling colour, 8 (AVX2) or
+// 4 (SSE2) pixels per instruction. Billboards (Granny, items) are then
+// drawn back to front wherever they are nearer than the wall. Both passes
+// split across a JobSystem when one is given; neither allocates once the
+// buffers are sized.
+class Raycaster {
+public:
+    struct Camera {
+        sf::Vector2f position; // Eye, in world units
+        float angle;           // Radians; 0 looks along +x
+        float fov;             // Horizontal field of view, radians
+        float viewDistance;    // Walls fade to black at this distance
+    };
+
+    // Upright rectangle standing on the floor
+    struct Billboard {
+        sf::Vector2f position; // Centre of its footprint
+        float width;
+        float height;
+        uint32_t color; // From rgba()
+    };
+
+    static constexpr float wallHeight = 100.0f;
+    static constexpr float eyeHeight = 50.0f;
+
+    // Columns and rows per job
+    static constexpr size_t columnGrain = 64;
+    static constexpr size_t rowGrain = 16;
+
+    // Packs a pixel in the byte order sf::Texture expects (R, G, B, A)
+    static uint32_t rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+        return static_cast<uint32_t>(r) | static_cast<uint32_t>(g) << 8 | static_cast<uint32_t>(b) << 16 |
+               static_cast<uint32_t>(a) << 24;
+    }
+
+    Raycaster() : width(0), height(0) {}
+
+    void resize(unsigned newWidth, unsigned newHeight) {
+        width = newWidth;
+        height = newHeight;
+        frame.assign(static_cast<size_t>(width) * height, rgba(0, 0, 0));
+        spanTop.assign(width, 0);
+        spanBottom.assign(width, 0);
+        spanColor.assign(width, 0);
+        depth.assign(width, 0);
+        rowColor.assign(height, 0);
+    }
+
+    unsigned getWidth() const { return width; }
+    unsigned getHeight() const { return height; }
+
+    // RGBA bytes, width * height * 4
+    const uint8_t* pixels() const { return reinterpret_cast<const uint8_t*>(frame.data()); }
+
+    // Distance to the wall seen in each column, along the view direction
+    const std::vector<float>& depths() const { return depth; }
+
+    void render(const WallGrid& walls, const Camera& camera, const std::vector<Billboard>& billboards,
+                JobSystem* jobs = nullptr) {
+        if (width == 0 || height == 0) return;
+        view = camera;
+        forward = sf::Vector2f(std::cos(camera.angle), std::sin(camera.angle));
+        tanHalfFov = std::tan(camera.fov / 2);
+        plane = sf::Vector2f(-forward.y, forward.x) * tanHalfFov;
+        projection = width / 2.0f / tanHalfFov;
+
+        auto castRange = [&](size_t begin, size_t end) { castColumns(walls, begin, end); };
+        auto fillRange = [&](size_t begin, size_t end) { fillRows(begin, end); };
+        if (jobs) {
+            jobs->parallelFor(width, columnGrain, castRange);
+            jobs->parallelFor(height, rowGrain, fillRange);
+        } else {
+            castRange(0, width);
+            fillRange(0, height);
+        }
+        drawBillboards(billboards);
+    }
+
+private:
+    unsigned width;
+    unsigned height;
+    std::vector<uint32_t> frame;
+    std::vector<int32_t> spanTop;    // First wall row of each column
+    std::vector<int32_t> spanBottom; // One past the last
+    std::vector<uint32_t> spanColor;
+    std::vector<float> depth;
+    std::vector<uint32_t> rowColor;  // Floor or ceiling colour of each row
+    std::vector<uint32_t> order;     // Billboards, far to near
+
+    Camera view;
+    sf::Vector2f forward;
+    sf::Vector2f plane; // Right of forward, scaled to the screen edge
+    float tanHalfFov;
+    float projection;   // Pixels per world unit at distance 1
+
+    // 1 at the eye, falling to 0 at the view distance
+    float brightness(float distance) const {
+        float light = std::max(0.0f, 1.0f - distance / view.viewDistance);
+        return light * light;
+    }
+
+    static uint32_t shade(uint8_t r, uint8_t g, uint8_t b, float light) {
+        return rgba(static_cast<uint8_t>(r * light), static_cast<uint8_t>(g * light), static_cast<uint8_t>(b * light));
+    }
+
+    void castColumns(const WallGrid& walls, size_t begin, size_t end) {
+        float horizon = height / 2.0f;
+        for (size_t x = begin; x < end; x++) {
+            // Ray through the pixel centre; its length along forward is 1,
+            // so t is the perpendicular distance and walls do not bow
+            float cameraX = 2.0f * (x + 0.5f) / width - 1.0f;
+            sf::Vector2f ray = forward + plane * cameraX;
+            int side;
+            float t = walls.castRay(view.position, ray, view.viewDistance, side);
+            depth[x] = t;
+            if (t >= view.viewDistance) {
+                spanTop[x] = spanBottom[x] = 0;
+                continue;
+            }
+            float scale = projection / std::max(t, 1.0f);
+            spanTop[x] = static_cast<int32_t>(std::max(0.0f, horizon - scale * (wallHeight - eyeHeight)));
+            spanBottom[x] = static_cast<int32_t>(std::min(static_cast<float>(height), horizon + scale * eyeHeight));
+            // Faces across y are a little darker, so corners read
+            spanColor[x] = shade(150, 140, 125, brightness(t) * (side == 0 ? 1.0f : 0.7f));
+        }
+    }
+
+    void fillRows(size_t begin, size_t end) {
+        float horizon = height / 2.0f;
+        for (size_t y = begin; y < end; y++) {
+            // Floor and ceiling: the distance a row sees depends only on y
+            float below = y + 0.5f - horizon;
+            if (below > 0) {
+                rowColor[y] = shade(90, 65, 45, brightness(projection * eyeHeight / below));
+            } else {
+                rowColor[y] = shade(55, 50, 50, brightness(projection * (wallHeight - eyeHeight) / -below));
+            }
+            fillRow(static_cast<int32_t>(y), rowColor[y], &frame[y * width]);
+        }
+    }
+
+    // Wall colour where the column's span covers row y, else background
+    void fillRow(int32_t y, uint32_t background, uint32_t* out) const {
+        size_t x = 0;
+#if defined(__AVX2__)
+        const __m256i row = _mm256_set1_epi32(y);
+        const __m256i fill = _mm256_set1_epi32(static_cast<int>(background));
+        for (; x + 8 <= width; x += 8) {
+            __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&spanTop[x]));
+            __m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&spanBottom[x]));
+            __m256i color = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&spanColor[x]));
+            __m256i inside = _mm256_andnot_si256(_mm256_cmpgt_epi32(top, row), _mm256_cmpgt_epi32(bottom, row));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_blendv_epi8(fill, color, inside));
+        }
+#elif defined(__SSE2__)
+        const __m128i row = _mm_set1_epi32(y);
+        const __m128i fill = _mm_set1_epi32(static_cast<int>(background));
+        for (; x + 4 <= width; x += 4) {
+            __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&spanTop[x]));
+            __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&spanBottom[x]));
+            __m128i color = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&spanColor[x]));
+            __m128i inside = _mm_andnot_si128(_mm_cmpgt_epi32(top, row), _mm_cmpgt_epi32(bottom, row));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                             _mm_or_si128(_mm_and_si128(inside, color), _mm_andnot_si128(inside, fill)));
+        }
+#endif
+        for (; x < width; x++) {
+            out[x] = spanTop[x] <= y && y < spanBottom[x] ? spanColor[x] : background;
+        }
+    }
+
+    void drawBillboards(const std::vector<Billboard>& billboards) {
+        // Distance along the view direction; nearer ones draw last
+        order.clear();
+        for (uint32_t i = 0; i < billboards.size(); i++) {
+            order.push_back(i);
+        }
+        auto along = [&](uint32_t i) {
+            sf::Vector2f d = billboards[i].position - view.position;
+            return d.x * forward.x + d.y * forward.y;
+        };
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return along(a) > along(b); });
+
+        float horizon = height / 2.0f;
+        for (uint32_t i : order) {
+            const Billboard& board = billboards[i];
+            float distance = along(i);
+            if (distance < 1.0f || distance >= view.viewDistance) continue;
+            sf::Vector2f d = board.position - view.position;
+            float across = (d.x * -forward.y + d.y * forward.x) / (distance * tanHalfFov); // -1..1 on screen
+            float scale = projection / distance;
+            float centerX = width / 2.0f * (1 + across);
+            int x0 = std::max(0, static_cast<int>(centerX - scale * board.width / 2));
+            int x1 = std::min(static_cast<int>(width), static_cast<int>(centerX + scale * board.width / 2));
+            int y1 = std::min(static_cast<int>(height), static_cast<int>(horizon + scale * eyeHeight));
+            int y0 = std::max(0, static_cast<int>(horizon + scale * (eyeHeight - board.height)));
+            uint32_t c = board.color;
+            uint32_t color = shade(c & 0xff, c >> 8 & 0xff, c >> 16 & 0xff, brightness(distance));
+            for (int x = x0; x < x1; x++) {
+                if (depth[x] <= distance) continue; // Behind the wall in this column
+                for (int y = y0; y < y1; y++) {
+                    frame[static_cast<size_t>(y) * width + x] = color;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Appends rect as two triangles, so any number of rectangles can be drawn
+// with a single draw call
+inline void appendQuad(sf::VertexArray& vertices, const sf::FloatRect& rect, sf::Color color) {
+    sf::Vector2f topLeft(rect.left, rect.top);
+    sf::Vector2f topRight(rect.left + rect.width, rect.top);
+    sf::Vector2f bottomRight(rect.left + rect.width, rect.top + rect.height);
+    sf::Vector2f bottomLeft(rect.left, rect.top + rect.height);
+
+    vertices.append(sf::Vertex(topLeft, color));
+    vertices.append(sf::Vertex(topRight, color));
+    vertices.append(sf::Vertex(bottomRight, color));
+    vertices.append(sf::Vertex(topLeft, color));
+    vertices.append(sf::Vertex(bottomRight, color));
+    vertices.append(sf::Vertex(bottomLeft, color));
+}
+
+// Same, with texture coordinates covering texRect (in texels)
+inline void appendQuad(sf::VertexArray& vertices, const sf::FloatRect& rect, sf::Color color,
+                       const sf::FloatRect& texRect) {
+    sf::Vector2f topLeft(rect.left, rect.top);
+    sf::Vector2f topRight(rect.left + rect.width, rect.top);
+    sf::Vector2f bottomRight(rect.left + rect.width, rect.top + rect.height);
+    sf::Vector2f bottomLeft(rect.left, rect.top + rect.height);
+    sf::Vector2f texTopLeft(texRect.left, texRect.top);
+    sf::Vector2f texTopRight(texRect.left + texRect.width, texRect.top);
+    sf::Vector2f texBottomRight(texRect.left + texRect.width, texRect.top + texRect.height);
+    sf::Vector2f texBottomLeft(texRect.left, texRect.top + texRect.height);
+
+    vertices.append(sf::Vertex(topLeft, color, texTopLeft));
+    vertices.append(sf::Vertex(topRight, color, texTopRight));
+    vertices.append(sf::Vertex(bottomRight, color, texBottomRight));
+    vertices.append(sf::Vertex(topLeft, color, texTopLeft));
+    vertices.append(sf::Vertex(bottomRight, color, texBottomRight));
+    vertices.append(sf::Vertex(bottomLeft, color, texBottomLeft));
+}
+
+// Geometry that never changes after load. It is uploaded once into a GPU
+// vertex buffer when the driver supports it, otherwise it stays a
+// client-side vertex array. Either way it is a single draw call.
+class StaticBatch : public sf::Drawable {
+public:
+    StaticBatch() : vertices(sf::Triangles), buffer(sf::Triangles, sf::VertexBuffer::Static), useBuffer(false) {}
+
+    void upload(const sf::VertexArray& source) {
+        vertices = source;
+        useBuffer = sf::VertexBuffer::isAvailable() && vertices.getVertexCount() > 0 &&
+                    buffer.create(vertices.getVertexCount()) && buffer.update(&vertices[0]);
+    }
+
+    size_t getVertexCount() const {
+        return vertices.getVertexCount();
+    }
+
+private:
+    sf::VertexArray vertices;
+    sf::VertexBuffer buffer;
+    bool useBuffer;
+
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override {
+        if (useBuffer) {
+            target.draw(buffer, states);
+        } else {
+            target.draw(vertices, states);
+        }
+    }
+};
+
+// Objects drawn and skipped by view culling in one frame
+struct CullCounts {
+    unsigned drawn = 0;
+    unsigned culled = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include "simulation.h"
+
+// Per-tick input trace of one run. The seed and fixed dt are stored with
+// the inputs, so feeding the trace back through Simulation::step()
+// reproduces the run exactly; finalHash lets a replay check that it did.
+// The version is the Simulation's, since a trace only reproduces its run
+// on the game logic that recorded it, and levelHash is the level's
+// (LevelFile::contentHash(), or 0 for the built-in house) for the same
+// reason.
+//
+// File layout (little-endian):
+//   "L3R2"  uint32 version  uint64 levelHash  uint32 seed  float dt  uint64 ticks  uint64 finalHash
+//   ticks x uint8 PlayerInput::buttons
+// Traces from before the level hash start with "L3RP" and are refused.
+class Replay {
+public:
+    static constexpr uint32_t version = Simulation::version;
+
+    // Inputs reserved up front, an hour at 60 Hz, so recording a session
+    // does not reallocate every few minutes
+    static constexpr size_t reservedTicks = 60 * 60 * 60;
+
+    uint64_t levelHash;
+    uint32_t seed;
+    float dt;
+    std::vector<PlayerInput> inputs;
+    uint64_t finalHash;
+
+    Replay() : levelHash(0), seed(0), dt(Simulation::fixedDt), finalHash(0) {}
+
+    void start(uint32_t runSeed, float tickDt) {
+        seed = runSeed;
+        dt = tickDt;
+        inputs.clear();
+        inputs.reserve(reservedTicks);
+        finalHash = 0;
+    }
+
+    void record(const PlayerInput& input) {
+        inputs.push_back(input);
+    }
+
+    size_t tickCount() const { return inputs.size(); }
+
+    bool saveToFile(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open replay file " << filename << " for writing\n";
+            return false;
+        }
+
+        uint64_t ticks = inputs.size();
+        file.write(magic, 4);
+        writeValue(file, version);
+        writeValue(file, levelHash);
+        writeValue(file, seed);
+        writeValue(file, dt);
+        writeValue(file, ticks);
+        writeValue(file, finalHash);
+
+        std::vector<uint8_t> buttons(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            buttons[i] = inputs[i].buttons;
+        }
+        file.write(reinterpret_cast<const char*>(buttons.data()), static_cast<std::streamsize>(buttons.size()));
+        if (!file) {
+            std::cerr << "Failed to write replay file " << filename << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Refuses a trace recorded on another level than the one with
+    // currentLevelHash
+    bool loadFromFile(const std::string& filename, uint64_t currentLevelHash) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open replay file " << filename << "\n";
+            return false;
+        }
+
+        char header[4];
+        uint32_t fileVersion = 0;
+        uint64_t ticks = 0;
+        file.read(header, 4);
+        if (file && std::memcmp(header, "L3RP", 4) == 0) {
+            std::cerr << "Replay file " << filename << " was recorded before replays stored their level; "
+                      << "record it again\n";
+            return false;
+        }
+        if (!file || std::memcmp(header, magic, 4) != 0 || !readValue(file, fileVersion)) {
+            std::cerr << "Replay file " << filename << " has an unknown format\n";
+            return false;
+        }
+        if (fileVersion != version) {
+            std::cerr << "Replay file " << filename << " was recorded with game logic version " << fileVersion
+                      << ", but this build is version " << version << "; it would not play back the same run\n";
+            return false;
+        }
+        if (!readValue(file, levelHash)) {
+            std::cerr << "Replay file " << filename << " is truncated\n";
+            return false;
+        }
+        if (levelHash != currentLevelHash) {
+            std::cerr << "Replay file " << filename << " was recorded on "
+                      << (levelHash == 0 ? std::string("the built-in house") : "level " + hex(levelHash))
+                      << ", but this game has "
+                      << (currentLevelHash == 0 ? std::string("the built-in house") : "level " + hex(currentLevelHash))
+                      << " loaded; it would not play back the same run\n";
+            return false;
+        }
+        if (!readValue(file, seed) || !readValue(file, dt) || !readValue(file, ticks) || !readValue(file, finalHash)) {
+            std::cerr << "Replay file " << filename << " is truncated\n";
+            return false;
+        }
+
+        // One byte per tick follows; check before allocating for them
+        std::streamoff start = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - start;
+        file.seekg(start);
+        if (!file || ticks > static_cast<uint64_t>(remaining)) {
+            std::cerr << "Replay file " << filename << " is truncated\n";
+            return false;
+        }
+
+        std::vector<uint8_t> buttons(static_cast<size_t>(ticks));
+        file.read(reinterpret_cast<char*>(buttons.data()), static_cast<std::streamsize>(buttons.size()));
+        if (!file) {
+            std::cerr << "Replay file " << filename << " is truncated\n";
+            return false;
+        }
+        inputs.resize(buttons.size());
+        for (size_t i = 0; i < buttons.size(); i++) {
+            inputs[i].buttons = buttons[i];
+        }
+        return true;
+    }
+
+private:
+    static constexpr const char* magic = "L3R2";
+
+    static std::string hex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    template <typename T>
+    static void writeValue(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static bool readValue(std::ifstream& file, T& value) {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return static_cast<bool>(file);
+    }
+};
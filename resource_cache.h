@@ -0,0 +1,235 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+enum class ResourceState : uint8_t { LOADING, READY, FAILED };
+
+// How each asset type is read off disk (decode, on a loader thread) and
+// turned into the usable object (finalize, on the main thread, where
+// textures can be uploaded to the GPU)
+template <typename T>
+struct ResourceLoader;
+
+template <>
+struct ResourceLoader<sf::Texture> {
+    typedef sf::Image Decoded;
+    static const char* tag() { return "texture"; }
+    static bool decode(const std::string& path, Decoded& image) { return image.loadFromFile(path); }
+    static bool finalize(sf::Texture& texture, Decoded& image) {
+        bool ok = texture.loadFromImage(image);
+        image = sf::Image(); // Pixels live on the GPU now
+        return ok;
+    }
+};
+
+// For pixels that are packed into an atlas rather than uploaded on their own
+template <>
+struct ResourceLoader<sf::Image> {
+    typedef sf::Image Decoded;
+    static const char* tag() { return "image"; }
+    static bool decode(const std::string& path, Decoded& image) { return image.loadFromFile(path); }
+    static bool finalize(sf::Image& value, Decoded& image) {
+        std::swap(value, image);
+        return true;
+    }
+};
+
+template <>
+struct ResourceLoader<sf::Font> {
+    // sf::Font reads glyphs from this buffer lazily, so it is kept
+    typedef std::vector<char> Decoded;
+    static const char* tag() { return "font"; }
+    static bool decode(const std::string& path, Decoded& bytes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        bytes.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file) && !bytes.empty();
+    }
+    static bool finalize(sf::Font& font, Decoded& bytes) { return font.loadFromMemory(bytes.data(), bytes.size()); }
+};
+
+template <>
+struct ResourceLoader<sf::SoundBuffer> {
+    struct Decoded {
+        std::vector<sf::Int16> samples;
+        unsigned int channelCount = 1;
+        unsigned int sampleRate = 44100;
+    };
+    static const char* tag() { return "sound"; }
+    static bool decode(const std::string& path, Decoded& sound) {
+        sf::InputSoundFile file;
+        if (!file.openFromFile(path)) return false;
+        sound.samples.resize(static_cast<size_t>(file.getSampleCount()));
+        sound.samples.resize(static_cast<size_t>(file.read(sound.samples.data(), sound.samples.size())));
+        sound.channelCount = file.getChannelCount();
+        sound.sampleRate = file.getSampleRate();
+        return !sound.samples.empty();
+    }
+    static bool finalize(sf::SoundBuffer& buffer, Decoded& sound) {
+        bool ok = buffer.loadFromSamples(sound.samples.data(), sound.samples.size(), sound.channelCount, sound.sampleRate);
+        sound = Decoded();
+        return ok;
+    }
+};
+
+template <typename T>
+struct Resource {
+    std::string path;
+    std::atomic<ResourceState> state;
+    typename ResourceLoader<T>::Decoded decoded;
+    std::function<bool(typename ResourceLoader<T>::Decoded&)> fallback;
+    T value; // Usable once state is READY
+
+    Resource() : state(ResourceState::LOADING) {}
+};
+
+// Shared, reference-counted handle. Resources stay cached while any handle
+// to them is alive. Check ready() before using get(); until then draw a
+// placeholder.
+template <typename T>
+class ResourceHandle {
+public:
+    ResourceHandle() {}
+
+    bool ready() const { return resource && resource->state.load(std::memory_order_acquire) == ResourceState::READY; }
+    bool failed() const { return resource && resource->state.load(std::memory_order_acquire) == ResourceState::FAILED; }
+    const T& get() const { return resource->value; }
+    const std::string& path() const { return resource->path; }
+
+private:
+    friend class ResourceCache;
+    std::shared_ptr<Resource<T>> resource;
+};
+
+// Loads assets on background threads, deduplicated by type and path.
+// Decoding (file I/O, image and audio decompression) runs on the loader
+// threads; update() finalizes finished assets on the calling thread, which
+// must be the one that owns the window's GL context.
+class ResourceCache {
+public:
+    explicit ResourceCache(unsigned threadCount = 2) : stopping(false), pending(0) {
+        for (unsigned i = 0; i < std::max(1u, threadCount); i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ResourceCache() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ResourceCache(const ResourceCache&) = delete;
+    ResourceCache& operator=(const ResourceCache&) = delete;
+
+    // Starts loading path, or returns the existing handle for it. fallback,
+    // if given, builds the data on the loader thread when the file is
+    // missing or unreadable.
+    template <typename T>
+    ResourceHandle<T> load(const std::string& path,
+                           std::function<bool(typename ResourceLoader<T>::Decoded&)> fallback = nullptr) {
+        std::string key = std::string(ResourceLoader<T>::tag()) + ":" + path;
+        ResourceHandle<T> handle;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::weak_ptr<void>& cached = entries[key];
+        handle.resource = std::static_pointer_cast<Resource<T>>(cached.lock());
+        if (handle.resource) return handle;
+
+        handle.resource = std::make_shared<Resource<T>>();
+        handle.resource->path = path;
+        handle.resource->fallback = std::move(fallback);
+        cached = handle.resource;
+
+        std::shared_ptr<Resource<T>> resource = handle.resource;
+        pending++;
+        jobs.push_back([this, resource] { decode(resource); });
+        wake.notify_one();
+        return handle;
+    }
+
+    // Finalizes decoded assets; call once per frame on the main thread
+    void update() {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(finalizers);
+        }
+        for (auto& finalize : ready) {
+            finalize();
+        }
+    }
+
+    // Assets requested but not yet ready or failed
+    size_t loading() const { return pending.load(std::memory_order_acquire); }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::function<void()>> finalizers;
+    std::unordered_map<std::string, std::weak_ptr<void>> entries;
+    std::atomic<size_t> pending;
+
+    template <typename T>
+    void decode(const std::shared_ptr<Resource<T>>& resource) {
+        bool ok = ResourceLoader<T>::decode(resource->path, resource->decoded);
+        if (!ok && resource->fallback) {
+            resource->decoded = typename ResourceLoader<T>::Decoded();
+            ok = resource->fallback(resource->decoded);
+        }
+        if (!ok) {
+            finish(*resource, false);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finalizers.push_back([this, resource] {
+            finish(*resource, ResourceLoader<T>::finalize(resource->value, resource->decoded));
+        });
+    }
+
+    template <typename T>
+    void finish(Resource<T>& resource, bool ok) {
+        resource.fallback = nullptr;
+        resource.state.store(ok ? ResourceState::READY : ResourceState::FAILED, std::memory_order_release);
+        pending--;
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Small seedable PRNG (xorshift32). Each agent owns one, so AI updates do
+// not share hidden global state and can run in parallel.
+struct Rng {
+    uint32_t state;
+
+    explicit Rng(uint32_t seed = 1) : state(seed ? seed : 0x9e3779b9u) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform integer in [0, n)
+    int nextInt(int n) {
+        return static_cast<int>(next() % static_cast<uint32_t>(n));
+    }
+};
+
+// Spreads consecutive seeds apart so agent streams are uncorrelated
+inline uint32_t mixSeed(uint32_t seed, uint32_t index) {
+    uint32_t h = seed ^ (index * 0x9e3779b9u);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "simulation.h"
+
+// Everything that changes while a Simulation runs, packed into a few dozen
+// bytes: the player, clock, items and each Granny's AI state, but not the
+// map, which a level load rebuilds. Values are stored exactly (no
+// quantisation), so a restored simulation continues with the same
+// stateHash() and, from there, the same ticks.
+//
+// Left out: velocities and the player's tick start point (recomputed
+// before use every tick), noise (it lasts one tick) and the flow field,
+// a cache towards the player that restore() clears. Any two restores of
+// the same state therefore run identically, but a restore may differ for a
+// few ticks from the run it was taken from while the field is rebuilt.
+//
+// Layout (native byte order, no padding):
+//   uint32 grannies  uint32 items  uint32 seed
+//   float2 player  int16 health  int32 playerRoom  float noiseTimer
+//   int16 day  float time  uint8 flags  uint32 sightCursor  item bits
+//   per Granny: float2 position  uint8 state  uint8 seesPlayer
+//     float awareness  float2 lastSeen  float searchTimer
+//     float2 patrolTarget  float patrolTimer  uint32 rng  int32 room
+//     float2 facing
+class SaveState {
+public:
+    // Bytes per Granny, the bulk of a snapshot on horde levels
+    static constexpr size_t grannyBytes = 54;
+
+    // Reuses the buffer, so capturing every tick does not allocate
+    void capture(const Simulation& sim) {
+        const GrannyPool& g = sim.grannies;
+        bytes.resize(headerBytes + (sim.items.size() + 7) / 8 + g.size() * grannyBytes);
+        uint8_t* out = bytes.data();
+
+        put(out, static_cast<uint32_t>(g.size()));
+        put(out, static_cast<uint32_t>(sim.items.size()));
+        put(out, sim.seed);
+        put(out, sim.playerPosition);
+        put(out, static_cast<int16_t>(sim.health));
+        put(out, static_cast<int32_t>(sim.playerRoom));
+        put(out, sim.noiseTimer);
+        put(out, static_cast<int16_t>(sim.day));
+        put(out, sim.time);
+        put(out, static_cast<uint8_t>((sim.gameOver ? 1 : 0) | (sim.gameWon ? 2 : 0)));
+        put(out, static_cast<uint32_t>(sim.perception.cursorIndex()));
+        for (size_t i = 0; i < sim.items.size(); i += 8) {
+            uint8_t bits = 0;
+            for (size_t b = 0; b < 8 && i + b < sim.items.size(); b++) {
+                bits |= static_cast<uint8_t>(sim.items[i + b].collected ? 1u << b : 0);
+            }
+            put(out, bits);
+        }
+        for (size_t i = 0; i < g.size(); i++) {
+            put(out, g.position[i]);
+            put(out, static_cast<uint8_t>(g.state[i]));
+            put(out, g.seesPlayer[i]);
+            put(out, g.awareness[i]);
+            put(out, g.lastSeenPosition[i]);
+            put(out, g.searchTimer[i]);
+            put(out, g.patrolTarget[i]);
+            put(out, g.patrolTimer[i]);
+            put(out, g.rng[i].state);
+            put(out, static_cast<int32_t>(g.room[i]));
+            put(out, g.facing[i]);
+        }
+    }
+
+    // Puts sim back into the captured state. Fails, leaving sim untouched,
+    // when the state is for a different Granny or item count.
+    bool restore(Simulation& sim) const {
+        if (bytes.size() < headerBytes) return false;
+        const uint8_t* in = bytes.data();
+        uint32_t grannyCount = get<uint32_t>(in);
+        uint32_t itemCount = get<uint32_t>(in);
+        if (grannyCount != sim.grannies.size() || itemCount != sim.items.size() ||
+            bytes.size() != headerBytes + (itemCount + 7) / 8 + static_cast<size_t>(grannyCount) * grannyBytes) {
+            return false;
+        }
+
+        sim.seed = get<uint32_t>(in);
+        sim.playerPosition = sim.playerStart = get<sf::Vector2f>(in);
+        sim.playerVelocity = sf::Vector2f(0, 0);
+        sim.health = get<int16_t>(in);
+        sim.playerRoom = get<int32_t>(in);
+        sim.noiseTimer = get<float>(in);
+        sim.day = get<int16_t>(in);
+        sim.time = get<float>(in);
+        uint8_t flags = get<uint8_t>(in);
+        sim.gameOver = (flags & 1) != 0;
+        sim.gameWon = (flags & 2) != 0;
+        sim.playerWasCaught = false;
+        sim.perception.setCursor(get<uint32_t>(in));
+        for (size_t i = 0; i < itemCount; i += 8) {
+            uint8_t bits = get<uint8_t>(in);
+            for (size_t b = 0; b < 8 && i + b < itemCount; b++) {
+                sim.items[i + b].collected = (bits >> b & 1) != 0;
+            }
+        }
+        sim.itemsVersion++;
+
+        GrannyPool& g = sim.grannies;
+        sim.pursuers = 0;
+        for (size_t i = 0; i < grannyCount; i++) {
+            g.position[i] = get<sf::Vector2f>(in);
+            g.velocity[i] = sf::Vector2f(0, 0);
+            g.state[i] = static_cast<GrannyState>(get<uint8_t>(in));
+            g.seesPlayer[i] = get<uint8_t>(in);
+            g.awareness[i] = get<float>(in);
+            g.lastSeenPosition[i] = get<sf::Vector2f>(in);
+            g.searchTimer[i] = get<float>(in);
+            g.patrolTarget[i] = get<sf::Vector2f>(in);
+            g.patrolTimer[i] = get<float>(in);
+            g.rng[i].state = get<uint32_t>(in);
+            g.room[i] = get<int32_t>(in);
+            g.facing[i] = get<sf::Vector2f>(in);
+            g.caughtPlayer[i] = 0;
+            sim.pursuers += g.state[i] != GrannyState::PATROL;
+        }
+        sim.flowField.clear();
+        return true;
+    }
+
+    bool empty() const { return bytes.empty(); }
+    size_t size() const { return bytes.size(); }
+    const uint8_t* data() const { return bytes.data(); }
+
+    // Takes a snapshot's bytes, e.g. from a file or a RewindBuffer
+    void assign(const uint8_t* data, size_t size) { bytes.assign(data, data + size); }
+    std::vector<uint8_t>& buffer() { return bytes; }
+    const std::vector<uint8_t>& buffer() const { return bytes; }
+
+private:
+    static constexpr size_t headerBytes = 4 + 4 + 4 + 8 + 2 + 4 + 4 + 2 + 4 + 1 + 4;
+
+    std::vector<uint8_t> bytes;
+
+    template <typename T>
+    static void put(uint8_t*& out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        out += sizeof(T);
+    }
+
+    template <typename T>
+    static T get(const uint8_t*& in) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+// The last few seconds of save states, for rewinding. Every keyInterval-th
+// state is stored whole; the ones in between are XORed with the state
+// before them and only the non-zero runs are kept, which from one tick to
+// the next is a handful of changed floats. States live in one byte ring
+// and a frame ring. The byte ring is sized by bytesFor() from the first
+// state pushed, up to maxBytes, and only grows again if states get
+// bigger, so steady recording does not allocate.
+//
+// Delta format: repeated [zero run][literal count][literal bytes], counts
+// as LEB128 varints; trailing zeros are implied.
+class RewindBuffer {
+public:
+    RewindBuffer(size_t maxFrames = 600, size_t maxBytes = 64 << 20, uint32_t keyInterval = 60)
+        : keyInterval(std::max<uint32_t>(1, keyInterval)), maxBytes(maxBytes), frames(std::max<size_t>(1, maxFrames)),
+          first(0), count(0), head(0), sinceKey(0) {}
+
+    // Ring bytes for frames states of stateBytes each: the key frames, and
+    // deltas of up to half a state. A horde where most Grannies move every
+    // tick changes about a third of the bytes.
+    static size_t bytesFor(size_t frames, size_t stateBytes, uint32_t keyInterval = 60) {
+        return (frames / std::max<uint32_t>(1, keyInterval) + 2) * stateBytes + frames * (stateBytes / 2);
+    }
+
+    void clear() {
+        first = count = head = 0;
+        sinceKey = 0;
+        previous.clear();
+    }
+
+    size_t frameCount() const { return count; }
+    size_t capacity() const { return bytes.size(); }
+
+    // Bytes taken by the stored frames
+    size_t byteCount() const {
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) total += frame(i).size;
+        return total;
+    }
+
+    // Appends a state, dropping the oldest ones (back to a key frame) when
+    // either ring is full. False when the state is bigger than maxBytes;
+    // the buffer is then left empty.
+    bool push(const SaveState& state) {
+        const std::vector<uint8_t>& raw = state.buffer();
+        size_t wanted = std::min(maxBytes, bytesFor(frames.size(), raw.size(), keyInterval));
+        if (bytes.size() < wanted) {
+            clear();
+            bytes.assign(wanted, 0);
+        }
+        bool key = sinceKey == 0 || previous.size() != raw.size();
+        scratch.clear();
+        if (key) {
+            scratch.assign(raw.begin(), raw.end());
+        } else {
+            encodeDelta(previous, raw, scratch);
+        }
+        if (raw.size() > bytes.size() || scratch.size() > bytes.size()) {
+            clear(); // Bigger than the whole ring; nothing can be kept
+            return false;
+        }
+
+        // Room in both rings: wrap to the start when the tail is too short
+        if (count == frames.size()) dropOldest();
+        if (head + scratch.size() > bytes.size()) {
+            while (count > 0 && frame(0).offset >= head) dropOldest();
+            head = 0;
+        }
+        while (count > 0 && frame(0).offset >= head && frame(0).offset < head + scratch.size()) dropOldest();
+        if (count == 0 && !key) {
+            // Everything before it had to go, so it has to stand alone
+            key = true;
+            scratch.assign(raw.begin(), raw.end());
+            head = 0;
+        }
+        previous.assign(raw.begin(), raw.end());
+        sinceKey = ((key ? 0 : sinceKey) + 1) % keyInterval;
+
+        Frame& added = frames[(first + count) % frames.size()];
+        added.offset = static_cast<uint32_t>(head);
+        added.size = static_cast<uint32_t>(scratch.size());
+        added.key = key;
+        std::copy(scratch.begin(), scratch.end(), bytes.begin() + head);
+        head += scratch.size();
+        count++;
+        return true;
+    }
+
+    // Decodes the state `back` frames before the newest (0 = newest) into
+    // state and forgets the frames after it, so recording carries on from
+    // there. False when the buffer holds no more than back frames.
+    bool rewind(size_t back, SaveState& state) {
+        if (back >= count) return false;
+        size_t target = count - 1 - back;
+        size_t key = target;
+        while (!frame(key).key) key--; // The oldest frame is always a key
+
+        std::vector<uint8_t>& out = state.buffer();
+        const Frame& keyFrame = frame(key);
+        out.assign(bytes.begin() + keyFrame.offset, bytes.begin() + keyFrame.offset + keyFrame.size);
+        for (size_t i = key + 1; i <= target; i++) {
+            applyDelta(&bytes[frame(i).offset], frame(i).size, out);
+        }
+
+        count = target + 1;
+        head = frame(target).offset + frame(target).size;
+        previous.assign(out.begin(), out.end());
+        sinceKey = static_cast<uint32_t>((target - key + 1) % keyInterval);
+        return true;
+    }
+
+private:
+    struct Frame {
+        uint32_t offset;
+        uint32_t size;
+        bool key;
+    };
+
+    uint32_t keyInterval;
+    size_t maxBytes;
+    std::vector<uint8_t> bytes;
+    std::vector<Frame> frames;
+    size_t first;  // Oldest frame's slot
+    size_t count;
+    size_t head;   // Where the next frame's bytes go
+    uint32_t sinceKey; // Frames since the last key frame, 0 = next is a key
+    std::vector<uint8_t> previous; // Last state pushed, for the next delta
+    std::vector<uint8_t> scratch;
+
+    const Frame& frame(size_t i) const { return frames[(first + i) % frames.size()]; }
+
+    // Drops the oldest frame and any deltas that depended on it
+    void dropOldest() {
+        do {
+            first = (first + 1) % frames.size();
+            count--;
+        } while (count > 0 && !frame(0).key);
+        if (count == 0) head = 0;
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static size_t getVarint(const uint8_t*& in) {
+        size_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = *in++;
+            value |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    static void encodeDelta(const std::vector<uint8_t>& before, const std::vector<uint8_t>& after,
+                            std::vector<uint8_t>& out) {
+        size_t i = 0, n = after.size();
+        while (i < n) {
+            size_t zeros = i;
+            while (zeros < n && before[zeros] == after[zeros]) zeros++;
+            if (zeros == n) break;
+            size_t literals = zeros;
+            // A literal run ends at two equal bytes in a row, where a
+            // zero run costs less than carrying on
+            while (literals < n && (before[literals] != after[literals] ||
+                                    (literals + 1 < n && before[literals + 1] != after[literals + 1]))) {
+                literals++;
+            }
+            putVarint(out, zeros - i);
+            putVarint(out, literals - zeros);
+            for (size_t k = zeros; k < literals; k++) {
+                out.push_back(before[k] ^ after[k]);
+            }
+            i = literals;
+        }
+    }
+
+    static void applyDelta(const uint8_t* in, size_t size, std::vector<uint8_t>& state) {
+        const uint8_t* end = in + size;
+        size_t i = 0;
+        while (in < end) {
+            i += getVarint(in);
+            size_t literals = getVarint(in);
+            for (size_t k = 0; k < literals; k++) {
+                state[i++] ^= *in++;
+            }
+        }
+    }
+};
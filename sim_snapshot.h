@@ -0,0 +1,64 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "simulation.h"
+#include "point_grid.h"
+
+// What the renderer needs from one simulation tick, copied out so drawing
+// never reads state the simulation is changing. Static data (map, item
+// bounds) is read from the Simulation once at load instead.
+struct SimSnapshot {
+    uint64_t tick = 0;
+    std::chrono::steady_clock::time_point tickTime; // When the tick was due
+
+    sf::Vector2f playerPosition;
+    std::vector<sf::Vector2f> partnerPositions; // Co-op players other than this one
+    std::vector<sf::Vector2f> grannyPositions;
+    PointGrid grannyGrid; // grannyPositions by cell, filled by binGrannies()
+    std::vector<uint8_t> itemsCollected;
+    unsigned itemsVersion = 0;
+    float health = 0;
+    int day = 0;
+    float time = 0;
+    bool gameOver = false;
+    bool gameWon = false;
+
+    // Running counts, so a reader that skips snapshots still notices them
+    unsigned catches = 0;  // Times the player was caught (jump scare)
+    unsigned teleports = 0; // Catches and restarts: positions jump, don't interpolate
+
+    // Reuses the vectors' storage, so steady-state captures do not allocate
+    void capture(const Simulation& sim) {
+        playerPosition = sim.playerPosition;
+        partnerPositions.resize(sim.partners.size());
+        for (size_t i = 0; i < sim.partners.size(); i++) {
+            partnerPositions[i] = sim.partners[i].position;
+        }
+        grannyPositions.assign(sim.grannies.position.begin(), sim.grannies.position.end());
+        itemsCollected.resize(sim.items.size());
+        for (size_t i = 0; i < sim.items.size(); i++) {
+            itemsCollected[i] = sim.items[i].collected;
+        }
+        itemsVersion = sim.itemsVersion;
+        health = sim.health;
+        day = sim.day;
+        time = sim.time;
+        gameOver = sim.gameOver;
+        gameWon = sim.gameWon;
+    }
+
+    // Bins grannyPositions over the world, so the renderer can draw the
+    // Grannies near the view without testing every one. Done where the
+    // snapshot is captured, off the render thread.
+    void binGrannies(const sf::FloatRect& worldBounds) {
+        if (!grannyGrid.ready()) grannyGrid.reset(worldBounds);
+        grannyGrid.build(grannyPositions);
+    }
+};
+
+inline sf::Vector2f lerp(sf::Vector2f a, sf::Vector2f b, float t) {
+    return a + (b - a) * t;
+}
@@ -0,0 +1,818 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cmath>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include "wall_grid.h"
+#include "agent_pool.h"
+#include "job_system.h"
+#include "nav_graph.h"
+#include "perception.h"
+#include "flow_field.h"
+#include "profiler.h"
+#include "level_file.h"
+#include "item_types.h"
+
+// Buttons held during one simulation tick, packed into one byte so input
+// can be recorded and replayed tick by tick
+struct PlayerInput {
+    enum Button : uint8_t {
+        UP = 1 << 0,
+        DOWN = 1 << 1,
+        LEFT = 1 << 2,
+        RIGHT = 1 << 3,
+        RESTART = 1 << 4, // Start a new game once this one is over
+        RUN = 1 << 5 // Faster, but loud enough for Granny to hear
+    };
+
+    uint8_t buttons = 0;
+
+    bool held(Button button) const { return (buttons & button) != 0; }
+    void press(Button button) { buttons |= button; }
+    void release(Button button) { buttons &= static_cast<uint8_t>(~button); }
+};
+
+// Window-free game logic: player, Granny AI, items, time and win check.
+// Only uses the header-only SFML vector/rect types, so it can be stepped
+// headless (benchmarks, CI) with a fixed dt and scripted input.
+class Simulation {
+public:
+    static constexpr float fixedDt = 1.0f / 60.0f;
+
+    // Bump whenever the same seed and input stop producing the same game:
+    // the built-in map, the AI, perception, collision or the rules. Replays
+    // record it and refuse to play on a different one.
+    // 2: doors moved, partners, multi-player sight, edge-grazing rays
+    static constexpr uint32_t version = 2;
+
+    // Agents per job when the Granny update is split across threads
+    static constexpr size_t grannyGrain = 256;
+
+    // Distance at which Granny counts as having walked through a door
+    static constexpr float doorArriveRadius = 10.0f;
+
+    // Flow field cells integrated per tick while the player's cell changes
+    static constexpr size_t flowFieldBudget = 4096;
+
+    // How many cells the flow field's target may lag behind a Granny's
+    // target before she stops following it
+    static constexpr uint32_t flowFieldSlack = 2;
+
+    // Running: speed multiplier, and how loud and how often its footsteps are
+    static constexpr float runSpeedFactor = 1.6f;
+    static constexpr float runNoise = 600.0f;
+    static constexpr float runNoiseInterval = 0.3f;
+
+    // Loudness of the player going through a door into another room
+    static constexpr float doorNoise = 350.0f;
+
+    // Room left on each side of the largest agent in a doorway
+    static constexpr float doorClearance = 10.0f;
+
+    // Co-op: players beyond the first, up to four in all
+    static constexpr size_t maxPartners = 3;
+    static_assert(1 + maxPartners <= Perception::maxPlayers, "every player can be seen");
+
+    // Plain data, so the item list copies and snapshots cheaply
+    struct Item {
+        sf::FloatRect bounds;
+        ItemType type;
+        bool collected;
+    };
+
+    // Player
+    sf::Vector2f playerSpawn;
+    sf::Vector2f playerPosition;
+    sf::Vector2f playerSize;
+    sf::Vector2f playerVelocity;
+    sf::Vector2f playerStart; // Where the player was at the start of the tick
+    float playerSpeed;
+    int health;
+    int playerRoom; // Last room the player was inside, -1 if none yet
+    float noiseTimer; // Until the next running footstep is heard
+
+    // Co-op partners, moved by their own input. Everyone shares health,
+    // items and the win; Granny chases whichever player she sees nearest,
+    // and a catch sends everyone back to the start. Empty when playing alone.
+    struct Partner {
+        sf::Vector2f position;
+        sf::Vector2f start;
+        sf::Vector2f velocity;
+        int room;
+        float noiseTimer;
+    };
+    std::vector<Partner> partners;
+
+    // Grannies (one by default, any number for horde modes)
+    GrannyPool grannies;
+    sf::Vector2f grannySize;
+    float grannySpeed;
+    float catchRadius; // Distance between centres at which Granny catches the player
+    float searchTime; // Seconds Granny searches after losing sight of the player
+    float noiseSearchTime; // Seconds Granny searches around a noise she heard
+    uint32_t seed;
+    JobSystem* jobs; // Optional; the Granny update runs serially without it
+    Profiler* profiler; // Optional; times the update phases when set
+
+    // Map
+    sf::FloatRect worldBounds;
+    sf::FloatRect exitArea; // Reaching it with every item wins
+    std::vector<sf::FloatRect> rooms;
+    std::vector<sf::FloatRect> walls;
+    std::vector<sf::FloatRect> doors;
+    std::vector<sf::FloatRect> hidingSpots;
+    WallGrid wallGrid; // Built once from walls after map creation
+    NavGraph navGraph; // Rooms linked by doors, for Granny's routing
+    FlowField flowField; // Towards the player, shared by every chasing Granny
+    Perception perception; // Granny's sight and hearing, refreshed every tick
+    size_t pursuers; // Grannies chasing or searching after the last tick
+
+    // Items
+    std::vector<Item> items;
+    unsigned itemsVersion; // Bumped whenever an item's collected flag changes
+
+    // Game state
+    int day;
+    float time;
+    bool gameOver;
+    bool gameWon;
+    bool playerWasCaught; // Set by step() when Granny caught the player that tick
+
+    Simulation() : playerSpawn(100, 100), playerPosition(100, 100), playerSize(30, 50), playerVelocity(0, 0), playerStart(100, 100),
+                   playerSpeed(300.0f), health(100), playerRoom(-1), noiseTimer(0), grannySize(40, 60), grannySpeed(150.0f),
+                   catchRadius(50.0f), searchTime(3.0f), noiseSearchTime(4.0f),
+                   seed(1), jobs(nullptr), profiler(nullptr), pursuers(0), itemsVersion(0), day(1), time(7.0f), gameOver(false),
+                   gameWon(false), playerWasCaught(false) {
+        createMap();
+        createItems();
+        cutDoorways();
+        buildMapIndexes();
+        addGranny(sf::Vector2f(800, 500));
+    }
+
+    // Replaces the built-in house with a compiled level. Geometry is copied
+    // as whole arrays; only the few items are converted one by one.
+    void loadLevel(const LevelFile& level) {
+        const LevelHeader& header = level.header();
+        worldBounds = level.worldBounds();
+        exitArea = sf::FloatRect(header.exitX, header.exitY, header.exitWidth, header.exitHeight);
+        playerSpawn = level.playerSpawn();
+        rooms.assign(level.rooms(), level.rooms() + header.roomCount);
+        walls.assign(level.walls(), level.walls() + header.wallCount);
+        doors.assign(level.doors(), level.doors() + header.doorCount);
+        hidingSpots.assign(level.hidingSpots(), level.hidingSpots() + header.hidingSpotCount);
+
+        items.clear();
+        for (uint32_t i = 0; i < header.itemCount; i++) {
+            const LevelItem& spawn = level.items()[i];
+            if (spawn.type >= static_cast<uint32_t>(ItemType::COUNT)) continue;
+            Item item;
+            item.type = static_cast<ItemType>(spawn.type);
+            item.bounds = sf::FloatRect(spawn.x, spawn.y, 20, 20);
+            item.collected = false;
+            items.push_back(item);
+        }
+
+        grannies.clear();
+        for (uint32_t i = 0; i < header.grannySpawnCount; i++) {
+            addGranny(level.grannySpawns()[i]);
+        }
+
+        cutDoorways();
+        buildMapIndexes();
+        reset();
+    }
+
+    void addGranny(sf::Vector2f spawn) {
+        grannies.add(spawn, seed);
+    }
+
+    // Reseeds every Granny's RNG. Together with the per-tick input this is
+    // all a replay needs to reproduce a run exactly.
+    void setSeed(uint32_t newSeed) {
+        seed = newSeed;
+        for (size_t i = 0; i < grannies.size(); i++) {
+            grannies.rng[i] = Rng(mixSeed(seed, static_cast<uint32_t>(i)));
+        }
+    }
+
+    // Joins a co-op partner at the player's spawn; false once full
+    bool addPartner() {
+        if (partners.size() == maxPartners) return false;
+        partners.push_back({playerSpawn, playerSpawn, sf::Vector2f(0, 0), -1, 0});
+        return true;
+    }
+
+    // Advance the game by one tick of dt seconds. partnerInputs holds one
+    // input per partner, or is null when there are none.
+    void step(float dt, const PlayerInput& input, const PlayerInput* partnerInputs = nullptr) {
+        playerWasCaught = false;
+        if (gameOver || gameWon) {
+            bool restart = input.held(PlayerInput::RESTART);
+            for (size_t p = 0; partnerInputs && p < partners.size(); p++) {
+                restart |= partnerInputs[p].held(PlayerInput::RESTART);
+            }
+            if (restart) reset();
+            return;
+        }
+
+        {
+            ProfileScope scope(profiler, ProfilePhase::UPDATE_PLAYER);
+            updatePlayer(dt, input);
+            for (size_t p = 0; partnerInputs && p < partners.size(); p++) {
+                Partner& partner = partners[p];
+                partner.velocity = velocityFor(partnerInputs[p]);
+                partner.start = partner.position;
+                partner.position = movePlayer(partner.position, partner.velocity, dt);
+            }
+        }
+        {
+            ProfileScope scope(profiler, ProfilePhase::UPDATE_GRANNIES);
+            updatePerception(dt, input, partnerInputs);
+            updateFlowField();
+            updateGrannies(dt);
+        }
+        {
+            ProfileScope scope(profiler, ProfilePhase::UPDATE_ITEMS);
+            updateItems();
+        }
+        updateTime(dt);
+        checkWinCondition();
+    }
+
+    void reset() {
+        playerPosition = playerStart = playerSpawn;
+        health = 100;
+        day = 1;
+        time = 7.0f;
+        gameOver = false;
+        gameWon = false;
+        playerWasCaught = false;
+        playerRoom = -1;
+        noiseTimer = 0;
+        for (auto& partner : partners) {
+            partner = {playerSpawn, playerSpawn, sf::Vector2f(0, 0), -1, 0};
+        }
+        pursuers = 0;
+        perception.reset();
+        flowField.clear();
+        for (size_t i = 0; i < grannies.size(); i++) {
+            grannies.resetAgent(i);
+        }
+
+        // Reset items
+        for (auto& item : items) {
+            item.collected = false;
+        }
+        itemsVersion++;
+    }
+
+    // FNV-1a over the simulation state, for checking that two runs match
+    uint64_t stateHash() const {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        mix(&playerPosition, sizeof(playerPosition));
+        for (const auto& partner : partners) {
+            mix(&partner.position, sizeof(partner.position));
+        }
+        mix(&health, sizeof(health));
+        mix(&day, sizeof(day));
+        mix(&time, sizeof(time));
+        mix(&gameOver, sizeof(gameOver));
+        mix(&gameWon, sizeof(gameWon));
+        for (const auto& item : items) {
+            mix(&item.collected, sizeof(item.collected));
+        }
+        for (size_t i = 0; i < grannies.size(); i++) {
+            mix(&grannies.position[i], sizeof(sf::Vector2f));
+            mix(&grannies.state[i], sizeof(GrannyState));
+            mix(&grannies.awareness[i], sizeof(float));
+            mix(&grannies.searchTimer[i], sizeof(float));
+            mix(&grannies.patrolTimer[i], sizeof(float));
+            mix(&grannies.rng[i].state, sizeof(uint32_t));
+            mix(&grannies.facing[i], sizeof(sf::Vector2f));
+            mix(&grannies.seesPlayer[i], sizeof(uint8_t));
+        }
+        return hash;
+    }
+
+    sf::FloatRect playerBounds() const {
+        return sf::FloatRect(playerPosition, playerSize);
+    }
+
+    sf::FloatRect grannyBounds(size_t i) const {
+        return sf::FloatRect(grannies.position[i], grannySize);
+    }
+
+    sf::Vector2f playerCenter() const {
+        return playerPosition + playerSize / 2.0f;
+    }
+
+    sf::Vector2f grannyCenter(size_t i) const {
+        return grannies.position[i] + grannySize / 2.0f;
+    }
+
+    // Players numbered from 0, the player, then the partners
+    size_t playerCount() const { return 1 + partners.size(); }
+
+    sf::Vector2f playerPositionAt(size_t p) const {
+        return p == 0 ? playerPosition : partners[p - 1].position;
+    }
+
+    // Velocity the buttons in input ask for
+    sf::Vector2f velocityFor(const PlayerInput& input) const {
+        sf::Vector2f velocity(0, 0);
+        float speed = input.held(PlayerInput::RUN) ? playerSpeed * runSpeedFactor : playerSpeed;
+
+        if (input.held(PlayerInput::UP)) velocity.y = -speed;
+        if (input.held(PlayerInput::DOWN)) velocity.y = speed;
+        if (input.held(PlayerInput::LEFT)) velocity.x = -speed;
+        if (input.held(PlayerInput::RIGHT)) velocity.x = speed;
+
+        // Normalize diagonal movement
+        if (velocity.x != 0 && velocity.y != 0) {
+            velocity.x *= 0.707f;
+            velocity.y *= 0.707f;
+        }
+        return velocity;
+    }
+
+    // Where a player at position ends up after moving at velocity for dt,
+    // sliding along any wall in the way and kept in the world. Only reads
+    // the map, so co-op clients predict their own movement with it.
+    sf::Vector2f movePlayer(sf::Vector2f position, sf::Vector2f velocity, float dt) const {
+        position += wallGrid.moveBox(sf::FloatRect(position, playerSize), velocity * dt);
+        position.x = std::max(worldBounds.left, std::min(worldBounds.left + worldBounds.width - 50, position.x));
+        position.y = std::max(worldBounds.top, std::min(worldBounds.top + worldBounds.height - 50, position.y));
+        return position;
+    }
+
+private:
+    // The house used when no level file is loaded
+    void createMap() {
+        worldBounds = sf::FloatRect(0, 0, 1200, 800);
+        exitArea = sf::FloatRect(1000, 0, 200, 100);
+
+        // Create walls for rooms
+        // Bedroom
+        createRoom(50, 50, 300, 250);
+        // Hallway
+        createRoom(400, 50, 150, 500);
+        // Living Room
+        createRoom(600, 50, 350, 250);
+        // Kitchen
+        createRoom(600, 350, 350, 250);
+        // Bathroom
+        createRoom(50, 350, 300, 200);
+        // Storage
+        createRoom(50, 600, 300, 150);
+
+        // Create doors (openings)
+        // Bedroom to Hallway
+        doors.push_back(sf::FloatRect(350, 120, 20, 60));
+        // Hallway to Living Room
+        doors.push_back(sf::FloatRect(550, 120, 20, 60));
+        // Hallway to Kitchen
+        doors.push_back(sf::FloatRect(550, 420, 20, 60));
+        // Hallway to Bathroom
+        doors.push_back(sf::FloatRect(350, 420, 20, 60));
+        // Bathroom to Storage
+        doors.push_back(sf::FloatRect(170, 565, 60, 20));
+
+        // Create hiding spots (closets)
+        hidingSpots.push_back(sf::FloatRect(80, 80, 80, 100));
+        hidingSpots.push_back(sf::FloatRect(650, 80, 80, 100));
+        hidingSpots.push_back(sf::FloatRect(80, 620, 80, 100));
+    }
+
+    void createRoom(float x, float y, float width, float height) {
+        rooms.push_back(sf::FloatRect(x, y, width, height));
+
+        // Top wall
+        walls.push_back(sf::FloatRect(x, y, width, 20));
+        // Bottom wall
+        walls.push_back(sf::FloatRect(x, y + height - 20, width, 20));
+        // Left wall
+        walls.push_back(sf::FloatRect(x, y, 20, height));
+        // Right wall
+        walls.push_back(sf::FloatRect(x + width - 20, y, 20, height));
+    }
+
+    // Doors are openings: cuts a gap through the walls on either side of
+    // each door, wide enough for the largest agent with doorClearance to
+    // spare. Walls beside a door are found through the wall grid, so this
+    // stays cheap on large levels.
+    void cutDoorways() {
+        wallGrid.build(walls);
+        float agent = std::max({playerSize.x, playerSize.y, grannySize.x, grannySize.y});
+        float reach = NavGraph::doorReach;
+
+        struct Cut {
+            uint32_t wall;
+            float low, high; // Along the wall's long axis
+            bool operator<(const Cut& other) const {
+                return wall != other.wall ? wall < other.wall : low < other.low;
+            }
+        };
+        std::vector<Cut> cuts;
+        for (const auto& door : doors) {
+            // Crossed along x when the door is tall and thin, as in createMap()
+            bool acrossX = door.height >= door.width;
+            float center = acrossX ? door.top + door.height / 2 : door.left + door.width / 2;
+            float half = std::max(acrossX ? door.height : door.width, agent) / 2 + doorClearance;
+            sf::FloatRect opening = acrossX
+                ? sf::FloatRect(door.left - reach, center - half, door.width + 2 * reach, 2 * half)
+                : sf::FloatRect(center - half, door.top - reach, 2 * half, door.height + 2 * reach);
+            wallGrid.anyInRect(opening, [&](uint32_t wall) {
+                const sf::FloatRect& w = walls[wall];
+                bool across = acrossX ? w.height > w.width : w.width > w.height;
+                if (across && w.intersects(opening)) cuts.push_back({wall, center - half, center + half});
+                return false;
+            });
+        }
+        if (cuts.empty()) return;
+        std::sort(cuts.begin(), cuts.end());
+
+        // Keep what is left of each cut wall; the grid may report a wall
+        // more than once, which only repeats a cut
+        std::vector<sf::FloatRect> kept;
+        kept.reserve(walls.size() + cuts.size());
+        size_t next = 0;
+        for (uint32_t i = 0; i < walls.size(); i++) {
+            const sf::FloatRect& w = walls[i];
+            if (next == cuts.size() || cuts[next].wall != i) {
+                kept.push_back(w);
+                continue;
+            }
+            bool vertical = w.height > w.width;
+            float start = vertical ? w.top : w.left;
+            float end = start + (vertical ? w.height : w.width);
+            for (; next < cuts.size() && cuts[next].wall == i; next++) {
+                if (cuts[next].low > start) {
+                    float length = std::min(cuts[next].low, end) - start;
+                    kept.push_back(vertical ? sf::FloatRect(w.left, start, w.width, length)
+                                            : sf::FloatRect(start, w.top, length, w.height));
+                }
+                start = std::max(start, cuts[next].high);
+            }
+            if (end > start) {
+                kept.push_back(vertical ? sf::FloatRect(w.left, start, w.width, end - start)
+                                        : sf::FloatRect(start, w.top, end - start, w.height));
+            }
+        }
+        walls.swap(kept);
+    }
+
+    // Search structures over the static map
+    void buildMapIndexes() {
+        wallGrid.build(walls);
+        navGraph.build(rooms, doors);
+        flowField.build(walls, worldBounds);
+        perception.build(navGraph);
+    }
+
+    void createItems() {
+        std::vector<std::pair<ItemType, sf::Vector2f>> itemData = {
+            {ItemType::KEY, sf::Vector2f(150, 150)},
+            {ItemType::HAMMER, sf::Vector2f(750, 150)},
+            {ItemType::SCREWDRIVER, sf::Vector2f(750, 450)},
+            {ItemType::BATTERY, sf::Vector2f(150, 400)},
+            {ItemType::MASTER_KEY, sf::Vector2f(150, 650)}
+        };
+
+        for (const auto& data : itemData) {
+            Item item;
+            item.type = data.first;
+            item.bounds = sf::FloatRect(data.second, sf::Vector2f(20, 20));
+            item.collected = false;
+            items.push_back(item);
+        }
+    }
+
+    void updatePlayer(float dt, const PlayerInput& input) {
+        playerVelocity = velocityFor(input);
+        playerStart = playerPosition;
+        playerPosition = movePlayer(playerPosition, playerVelocity, dt);
+    }
+
+    // Noises the players made this tick, then sight for as many Grannies as
+    // the query budget allows. Runs before the (possibly threaded) Granny
+    // update, which only reads the results.
+    void updatePerception(float dt, const PlayerInput& input, const PlayerInput* partnerInputs) {
+        perception.noise.beginTick();
+        emitNoise(dt, playerPosition, playerVelocity, input, playerRoom, noiseTimer);
+        for (size_t p = 0; partnerInputs && p < partners.size(); p++) {
+            Partner& partner = partners[p];
+            emitNoise(dt, partner.position, partner.velocity, partnerInputs[p], partner.room, partner.noiseTimer);
+        }
+
+        if (partners.empty()) {
+            perception.updateSight(grannies, grannySize, playerBounds(), wallGrid);
+        } else {
+            sf::FloatRect targets[1 + maxPartners];
+            for (size_t p = 0; p < playerCount(); p++) {
+                targets[p] = sf::FloatRect(playerPositionAt(p), playerSize);
+            }
+            perception.updateSight(grannies, grannySize, targets, playerCount(), wallGrid);
+        }
+    }
+
+    // Running footsteps and doors used by one player
+    void emitNoise(float dt, sf::Vector2f position, sf::Vector2f velocity, const PlayerInput& input, int& lastRoom,
+                   float& timer) {
+        sf::Vector2f center = position + playerSize / 2.0f;
+        timer -= dt;
+        bool moving = velocity.x != 0 || velocity.y != 0;
+        if (moving && input.held(PlayerInput::RUN) && timer <= 0) {
+            perception.noise.emit(navGraph, center, runNoise);
+            timer = runNoiseInterval;
+        }
+
+        // Doorways lie between rooms, so a change of room is a door used
+        int room = navGraph.roomAt(center);
+        if (room >= 0) {
+            if (lastRoom >= 0 && room != lastRoom) {
+                perception.noise.emit(navGraph, center, doorNoise);
+            }
+            lastRoom = room;
+        }
+    }
+
+    // Centre of the player Granny i saw last; seesPlayer holds its number + 1
+    sf::Vector2f seenPlayerCenter(size_t i) const {
+        size_t p = grannies.seesPlayer[i] - 1u;
+        return playerPositionAt(p < playerCount() ? p : 0) + playerSize / 2.0f;
+    }
+
+    // Only maintained while someone is pursuing the player. Restarts when the
+    // player enters a new cell, and spreads the work over several ticks on
+    // large maps.
+    void updateFlowField() {
+        if (pursuers == 0) return;
+        flowField.setTarget(playerCenter());
+        flowField.update(flowFieldBudget);
+    }
+
+    // Every agent only reads shared state (player, walls) and writes its own
+    // slots, so ranges of agents can update on different threads. Catching
+    // the player touches shared state and is applied afterwards.
+    void updateGrannies(float dt) {
+        auto updateRange = [this, dt](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                updateGranny(i, dt);
+            }
+        };
+        if (jobs) {
+            jobs->parallelFor(grannies.size(), grannyGrain, updateRange);
+        } else {
+            updateRange(0, grannies.size());
+        }
+
+        bool caught = false;
+        pursuers = 0;
+        for (size_t i = 0; i < grannies.size(); i++) {
+            caught |= grannies.caughtPlayer[i] != 0;
+            grannies.caughtPlayer[i] = 0;
+            pursuers += grannies.state[i] != GrannyState::PATROL;
+        }
+        if (caught) {
+            playerCaught();
+        }
+    }
+
+    void updateGranny(size_t i, float dt) {
+        sf::Vector2f startOffset = playerStart + playerSize / 2.0f - grannyCenter(i);
+        sf::Vector2f startCenter = grannyCenter(i);
+
+        // Update Granny's state
+        GrannyState& state = grannies.state[i];
+        sf::Vector2f noiseFrom;
+        if (grannies.seesPlayer[i]) {
+            state = GrannyState::CHASE;
+            grannies.awareness[i] = 100;
+            grannies.lastSeenPosition[i] = seenPlayerCenter(i);
+            grannies.searchTimer[i] = searchTime;
+        } else if (hearsNoise(i, noiseFrom)) {
+            // Go and look where the sound came from
+            state = GrannyState::SEARCH;
+            grannies.awareness[i] = std::max(grannies.awareness[i], 50.0f);
+            grannies.lastSeenPosition[i] = noiseFrom;
+            grannies.searchTimer[i] = noiseSearchTime;
+        } else if (state == GrannyState::CHASE) {
+            state = GrannyState::SEARCH;
+            grannies.searchTimer[i] = searchTime;
+        } else if (state == GrannyState::SEARCH && grannies.searchTimer[i] > 0) {
+            grannies.searchTimer[i] -= dt;
+        } else {
+            state = GrannyState::PATROL;
+            grannies.awareness[i] = std::max(0.0f, grannies.awareness[i] - 50.0f * dt);
+        }
+
+        // Move Granny based on state
+        switch (state) {
+            case GrannyState::PATROL:
+                patrolBehavior(i, dt);
+                break;
+            case GrannyState::CHASE:
+                chaseBehavior(i, dt);
+                break;
+            case GrannyState::SEARCH:
+                searchBehavior(i, dt);
+                break;
+        }
+        grannies.position[i] += wallGrid.moveBox(grannyBounds(i), grannies.velocity[i] * dt);
+
+        // She looks the way she walks
+        sf::Vector2f velocity = grannies.velocity[i];
+        float speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+        if (speed > 0) {
+            grannies.facing[i] = velocity / speed;
+        }
+
+        // Caught if the two came within catchRadius at any point of the
+        // tick, so fast movers cannot pass through each other on long ticks
+        sf::Vector2f endOffset = playerCenter() - grannyCenter(i);
+        if (closestApproach(startOffset, endOffset) < catchRadius) {
+            grannies.caughtPlayer[i] = 1;
+        }
+        for (const auto& partner : partners) {
+            sf::Vector2f partnerStart = partner.start + playerSize / 2.0f - startCenter;
+            sf::Vector2f partnerEnd = partner.position + playerSize / 2.0f - grannyCenter(i);
+            if (closestApproach(partnerStart, partnerEnd) < catchRadius) {
+                grannies.caughtPlayer[i] = 1;
+            }
+        }
+    }
+
+    // Smallest length along the straight line from offset a to offset b
+    static float closestApproach(sf::Vector2f a, sf::Vector2f b) {
+        sf::Vector2f d = b - a;
+        float lengthSquared = d.x * d.x + d.y * d.y;
+        float t = lengthSquared > 0 ? std::max(0.0f, std::min(1.0f, -(a.x * d.x + a.y * d.y) / lengthSquared)) : 0;
+        sf::Vector2f closest = a + d * t;
+        return std::sqrt(closest.x * closest.x + closest.y * closest.y);
+    }
+
+    // Next point for Granny i to head for on the way to target: the next
+    // door on the cached room route, or target itself once in its room (or
+    // when either end is outside the room graph)
+    sf::Vector2f routeTowards(size_t i, sf::Vector2f target) {
+        sf::Vector2f grannyPos = grannyCenter(i);
+        int& room = grannies.room[i];
+        int here = navGraph.roomAt(grannyPos);
+        if (here >= 0) room = here;
+
+        int targetRoom = navGraph.roomAt(target);
+        int door = navGraph.nextDoor(room, targetRoom);
+        if (door < 0) return target;
+
+        // Through the door: continue from the room on the other side
+        sf::Vector2f toDoor = navGraph.door(door).center - grannyPos;
+        if (toDoor.x * toDoor.x + toDoor.y * toDoor.y < doorArriveRadius * doorArriveRadius) {
+            room = navGraph.otherSide(door, room);
+            door = navGraph.nextDoor(room, targetRoom);
+            if (door < 0) return target;
+        }
+        return navGraph.door(door).center;
+    }
+
+    // Velocity of magnitude speed taking Granny i's centre towards target,
+    // slower on the last tick so she stops on a waypoint instead of
+    // stepping past it when ticks are long
+    sf::Vector2f steerTowards(size_t i, sf::Vector2f target, float speed, float dt) {
+        target = routeTowards(i, target);
+        sf::Vector2f direction = target - grannyCenter(i);
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        if (length > 0) {
+            return direction / length * std::min(speed, length / dt);
+        }
+        return sf::Vector2f(0, 0);
+    }
+
+    void patrolBehavior(size_t i, float dt) {
+        sf::Vector2f& targetPosition = grannies.patrolTarget[i];
+        float& changeTargetTimer = grannies.patrolTimer[i];
+        sf::Vector2f grannyPos = grannyCenter(i);
+
+        changeTargetTimer -= dt;
+        if (changeTargetTimer <= 0 ||
+            (std::abs(grannyPos.x - targetPosition.x) < 10 &&
+             std::abs(grannyPos.y - targetPosition.y) < 10)) {
+
+            // New random target
+            int rangeX = std::max(1, static_cast<int>(worldBounds.width) - 100);
+            int rangeY = std::max(1, static_cast<int>(worldBounds.height) - 100);
+            targetPosition.x = worldBounds.left + static_cast<float>(grannies.rng[i].nextInt(rangeX) + 50);
+            targetPosition.y = worldBounds.top + static_cast<float>(grannies.rng[i].nextInt(rangeY) + 50);
+            changeTargetTimer = 5.0f;
+        }
+
+        // Move towards target
+        grannies.velocity[i] = steerTowards(i, targetPosition, grannySpeed, dt);
+    }
+
+    // Follows the shared flow field where it reaches Granny i and still
+    // leads (close enough) to target, otherwise walks the room route
+    sf::Vector2f followFlow(size_t i, sf::Vector2f target, float speed, float dt) {
+        if (flowField.distance(target) <= flowFieldSlack) {
+            sf::Vector2f direction = flowField.direction(grannyCenter(i));
+            if (direction.x != 0 || direction.y != 0) {
+                return direction * speed;
+            }
+        }
+        return steerTowards(i, target, speed, dt);
+    }
+
+    void chaseBehavior(size_t i, float dt) {
+        grannies.velocity[i] = followFlow(i, seenPlayerCenter(i), grannySpeed * 1.5f, dt);
+    }
+
+    void searchBehavior(size_t i, float dt) {
+        grannies.velocity[i] = followFlow(i, grannies.lastSeenPosition[i], grannySpeed, dt);
+
+        // Random wandering while searching
+        Rng& rng = grannies.rng[i];
+        if (rng.nextInt(100) < 5) {
+            grannies.lastSeenPosition[i].x += static_cast<float>(rng.nextInt(100) - 50);
+            grannies.lastSeenPosition[i].y += static_cast<float>(rng.nextInt(100) - 50);
+        }
+    }
+
+    // True when a noise made this tick reaches Granny i; from is where it
+    // entered her room
+    bool hearsNoise(size_t i, sf::Vector2f& from) const {
+        if (perception.noise.silent()) return false;
+        sf::Vector2f ear = grannyCenter(i);
+        return perception.noise.heard(navGraph.roomAt(ear), ear, from) > 0;
+    }
+
+    void updateItems() {
+        for (size_t p = 0; p < playerCount(); p++) {
+            sf::FloatRect bounds(playerPositionAt(p), playerSize);
+            for (auto& item : items) {
+                if (!item.collected && item.bounds.intersects(bounds)) {
+                    item.collected = true;
+                    itemsVersion++;
+                    // In a full implementation, add to inventory
+                }
+            }
+        }
+    }
+
+    void updateTime(float dt) {
+        time += dt * 0.1f;
+        if (time >= 24.0f) {
+            time = 7.0f;
+            day++;
+
+            if (day > 5) {
+                gameOver = true;
+            }
+        }
+    }
+
+    void checkWinCondition() {
+        // Check if player has all items and reached exit
+        bool hasAllItems = true;
+        for (const auto& item : items) {
+            if (!item.collected) {
+                hasAllItems = false;
+                break;
+            }
+        }
+
+        for (size_t p = 0; hasAllItems && p < playerCount(); p++) {
+            if (exitArea.contains(playerPositionAt(p))) {
+                gameWon = true;
+            }
+        }
+    }
+
+    void playerCaught() {
+        health -= 25;
+        playerWasCaught = true;
+
+        // Reset positions
+        playerPosition = playerStart = playerSpawn;
+        for (auto& partner : partners) {
+            partner.position = partner.start = playerSpawn;
+        }
+        for (size_t i = 0; i < grannies.size(); i++) {
+            grannies.position[i] = grannies.spawn[i];
+        }
+
+        if (health <= 0) {
+            gameOver = true;
+        }
+    }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "item_types.h"
+#include "render_batch.h"
+
+// Compact sprite ids; each names one region of the atlas
+enum SpriteId : uint16_t {
+    SPRITE_WHITE,       // Solid texel, so untextured quads share the atlas
+    SPRITE_ITEM_FIRST,  // One per ItemType, in the same order
+    SPRITE_GRANNY = SPRITE_ITEM_FIRST + static_cast<uint16_t>(ItemType::COUNT),
+    SPRITE_PLAYER,
+    SPRITE_CLOSET,
+    SPRITE_COUNT
+};
+
+inline SpriteId itemSprite(ItemType type) {
+    return static_cast<SpriteId>(SPRITE_ITEM_FIRST + static_cast<uint16_t>(type));
+}
+
+// Every sprite packed into one texture built at runtime, so the world can
+// be drawn with a single texture bound. Images are set per sprite id, then
+// build() shelf-packs them and uploads the result; building again (for
+// example when a loaded image replaces a placeholder) repacks everything.
+class SpriteAtlas {
+public:
+    SpriteAtlas() : images(SPRITE_COUNT), regions(SPRITE_COUNT) {
+        sf::Image white;
+        white.create(3, 3, sf::Color::White);
+        images[SPRITE_WHITE] = white;
+    }
+
+    void setImage(SpriteId id, const sf::Image& image) {
+        images[id] = image;
+    }
+
+    bool build() {
+        // Tallest first, left to right in rows; a texel of padding stops
+        // neighbours bleeding in
+        std::vector<uint16_t> order;
+        unsigned area = 0, widest = 0;
+        for (uint16_t id = 0; id < SPRITE_COUNT; id++) {
+            sf::Vector2u size = images[id].getSize();
+            if (size.x == 0 || size.y == 0) continue;
+            order.push_back(id);
+            area += (size.x + padding) * (size.y + padding);
+            widest = std::max(widest, size.x + padding);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](uint16_t a, uint16_t b) {
+            return images[a].getSize().y > images[b].getSize().y;
+        });
+
+        unsigned width = 64;
+        while (width * width < area || width < widest) width *= 2;
+        unsigned x = 0, y = 0, rowHeight = 0;
+        std::fill(regions.begin(), regions.end(), sf::IntRect());
+        for (uint16_t id : order) {
+            sf::Vector2u size = images[id].getSize();
+            if (x + size.x + padding > width) {
+                x = 0;
+                y += rowHeight;
+                rowHeight = 0;
+            }
+            regions[id] = sf::IntRect(x, y, size.x, size.y);
+            x += size.x + padding;
+            rowHeight = std::max(rowHeight, size.y + padding);
+        }
+        unsigned height = 64;
+        while (height < y + rowHeight) height *= 2;
+
+        sf::Image atlas;
+        atlas.create(width, height, sf::Color::Transparent);
+        for (uint16_t id : order) {
+            atlas.copy(images[id], regions[id].left, regions[id].top);
+        }
+        return atlasTexture.loadFromImage(atlas);
+    }
+
+    const sf::Texture& texture() const { return atlasTexture; }
+
+    // Texel rectangle of a sprite in the atlas
+    sf::IntRect region(SpriteId id) const { return regions[id]; }
+
+    // Two triangles covering bounds, textured with sprite id
+    void appendSprite(sf::VertexArray& vertices, const sf::FloatRect& bounds, SpriteId id,
+                      sf::Color tint = sf::Color::White) const {
+        appendQuad(vertices, bounds, tint, sf::FloatRect(regions[id]));
+    }
+
+    // Flat-coloured quad that still uses the atlas texture (its white texel)
+    void appendSolid(sf::VertexArray& vertices, const sf::FloatRect& bounds, sf::Color color) const {
+        const sf::IntRect& r = regions[SPRITE_WHITE];
+        sf::FloatRect centre(r.left + 1.5f, r.top + 1.5f, 0, 0);
+        appendQuad(vertices, bounds, color, centre);
+    }
+
+private:
+    static constexpr unsigned padding = 1;
+
+    std::vector<sf::Image> images;
+    std::vector<sf::IntRect> regions;
+    sf::Texture atlasTexture;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer, single-consumer triple buffer. The writer
+// fills back() and publish()es it; the reader calls update() and then
+// reads front(). Neither side ever waits: the writer always has a free
+// slot and the reader always sees the newest complete value, skipping any
+// it was too slow to see.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : writeIndex(0), middle(1), readIndex(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& back() { return slots[writeIndex]; }
+
+    void publish() {
+        writeIndex = middle.exchange(static_cast<uint8_t>(writeIndex | fresh), std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader side. Returns true when a newer value was swapped in.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& front() const { return slots[readIndex]; }
+
+private:
+    static constexpr uint8_t indexMask = 3;
+    static constexpr uint8_t fresh = 4; // Middle slot holds a value the reader has not taken
+
+    T slots[3];
+    uint8_t writeIndex;
+    std::atomic<uint8_t> middle;
+    uint8_t readIndex;
+};
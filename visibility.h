@@ -0,0 +1,403 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include "wall_grid.h"
+
+// Region visible from a point within a radius, computed by an angular sweep
+// over the wall edges facing the viewer. The walls near the viewer are
+// gathered from the WallGrid when one is given, otherwise from the flat
+// wall list. Each wall edge is clipped to the light's disc and becomes a
+// start and end event in angle order; crossings between overlapping walls
+// add events too, so between two consecutive events the nearest edge never
+// changes and one triangle covers the whole gap.
+//
+// The result is a fan around origin(): consecutive points() with the origin
+// form the lit triangles. Scratch buffers are kept between calls, so a
+// steady-state compute() does not allocate.
+class VisibilityPolygon {
+public:
+    VisibilityPolygon() : pass(0), nearest(noSegment), rescan(true) {}
+
+    // Full circle when halfAngle >= pi, otherwise a cone around facing
+    // (radians, as atan2)
+    void compute(sf::Vector2f origin, float radius, const std::vector<sf::FloatRect>& walls,
+                 const WallGrid* grid = nullptr, float facing = 0, float halfAngle = pi) {
+        viewer = origin;
+        rim.clear();
+        segments.clear();
+        events.clear();
+        if (radius <= 0) return;
+
+        // Angles are measured from the seam, where the sweep starts
+        bool cone = halfAngle < pi;
+        float seamAngle = cone ? facing - halfAngle : -pi;
+        seam = sf::Vector2f(std::cos(seamAngle), std::sin(seamAngle));
+
+        // Quarter turns keep every span under half a turn, which lets a
+        // span's middle be the sum of its end directions
+        sf::Vector2f quarter = seam;
+        for (int i = 0; i < 4; i++) {
+            events.push_back({static_cast<float>(i), noSegment, quarter});
+            quarter = sf::Vector2f(-quarter.y, quarter.x);
+        }
+        float limit = 4;
+        sf::Vector2f limitDirection = seam;
+        if (cone) {
+            float end = facing + halfAngle;
+            limitDirection = sf::Vector2f(std::cos(end), std::sin(end));
+            limit = pseudoAngle(limitDirection);
+        }
+
+        gatherWalls(origin, radius, walls, grid);
+        buildSegments(origin, radius, walls);
+        addCrossings(origin, radius, walls, grid);
+        sweep(origin, radius, limit, limitDirection);
+    }
+
+    sf::Vector2f origin() const { return viewer; }
+    const std::vector<sf::Vector2f>& points() const { return rim; }
+
+    // Wall edges that took part in the last sweep
+    size_t segmentCount() const { return segments.size(); }
+
+private:
+    static constexpr float pi = 3.14159265358979f;
+    static constexpr uint32_t noSegment = 0xFFFFFFFFu;
+    static constexpr uint32_t crossing = 0xFFFFFFFEu;
+    // Longest arc drawn as one triangle where nothing blocks the light
+    static constexpr float arcStep = 2 * pi / 48;
+
+    struct Segment {
+        sf::Vector2f a, b; // a is where the sweep meets it first
+        float startKey, endKey;
+    };
+
+    // Sorted by key, a pseudo-angle from the seam in [0, 4) that grows
+    // with the true angle, so no trigonometry is needed per endpoint
+    struct Event {
+        float key;
+        uint32_t segment;      // Or crossing, or noSegment for fixed directions
+        sf::Vector2f direction; // Unit vector from the viewer
+    };
+
+    sf::Vector2f viewer;
+    sf::Vector2f seam;
+    std::vector<sf::Vector2f> rim;
+    std::vector<uint32_t> nearby;  // Indices of walls near the viewer
+    std::vector<uint32_t> seen;    // Pass stamp per wall, to drop duplicates
+    uint32_t pass;
+    std::vector<Segment> segments;
+    std::vector<Event> events;
+    std::vector<uint64_t> order;   // Key bits above event index, sorted
+    std::vector<uint64_t> sortScratch;
+    std::vector<uint32_t> active;  // Segments crossing the current ray
+    std::vector<uint32_t> slot;    // Position of each segment in active
+    std::vector<uint32_t> added;   // Activated since the last span
+    uint32_t nearest;              // Nearest active segment, or noSegment
+    bool rescan;                   // nearest must be found from scratch
+
+    // Pseudo-angle of a direction relative to the seam
+    float pseudoAngle(sf::Vector2f d) const {
+        float x = d.x * seam.x + d.y * seam.y;
+        float y = d.y * seam.x - d.x * seam.y;
+        float key;
+        if (y >= 0) key = x >= 0 ? y / (x + y) : 1 - x / (y - x);
+        else key = x < 0 ? 2 - y / (-x - y) : 3 + x / (x - y);
+        return key < 4 ? key + 0.0f : 0; // + 0 folds -0 into +0 for sortEvents()
+    }
+
+    Event makeEvent(sf::Vector2f origin, sf::Vector2f point, uint32_t segment) const {
+        sf::Vector2f d = point - origin;
+        float length = std::sqrt(d.x * d.x + d.y * d.y);
+        if (length > 0) d /= length;
+        return {pseudoAngle(d), segment, d};
+    }
+
+    void gatherWalls(sf::Vector2f origin, float radius, const std::vector<sf::FloatRect>& walls,
+                     const WallGrid* grid) {
+        nearby.clear();
+        sf::FloatRect area(origin.x - radius, origin.y - radius, 2 * radius, 2 * radius);
+        if (!grid) {
+            for (uint32_t i = 0; i < walls.size(); i++) {
+                if (walls[i].intersects(area)) nearby.push_back(i);
+            }
+            return;
+        }
+
+        // Walls spanning several cells are reported once per cell
+        nextPass(walls.size());
+        grid->anyInRect(area, [&](uint32_t i) {
+            if (seen[i] != pass) {
+                seen[i] = pass;
+                nearby.push_back(i);
+            }
+            return false;
+        });
+    }
+
+    void nextPass(size_t wallCount) {
+        if (seen.size() != wallCount || ++pass == 0) {
+            seen.assign(wallCount, 0);
+            pass = 1;
+        }
+    }
+
+    // Clips p-q to the disc; false when it lies outside
+    static bool clipToDisc(sf::Vector2f origin, float radius, sf::Vector2f& p, sf::Vector2f& q) {
+        sf::Vector2f d = q - p;
+        sf::Vector2f f = p - origin;
+        float a = d.x * d.x + d.y * d.y;
+        float b = 2 * (f.x * d.x + f.y * d.y);
+        float c = f.x * f.x + f.y * f.y - radius * radius;
+        float discriminant = b * b - 4 * a * c;
+        if (a == 0 || discriminant <= 0) return false;
+        float root = std::sqrt(discriminant);
+        float s0 = std::max(0.0f, (-b - root) / (2 * a));
+        float s1 = std::min(1.0f, (-b + root) / (2 * a));
+        if (s0 >= s1) return false;
+        sf::Vector2f start = p + d * s0;
+        q = p + d * s1;
+        p = start;
+        return true;
+    }
+
+    void addSegment(sf::Vector2f origin, float radius, sf::Vector2f p, sf::Vector2f q) {
+        if (!clipToDisc(origin, radius, p, q)) return;
+        // Orient so the sweep (increasing angle) meets p first; edges seen
+        // exactly edge-on hide nothing
+        float turn = (p.x - origin.x) * (q.y - origin.y) - (p.y - origin.y) * (q.x - origin.x);
+        if (std::abs(turn) < 1e-6f) return;
+        if (turn < 0) std::swap(p, q);
+
+        uint32_t index = static_cast<uint32_t>(segments.size());
+        Event start = makeEvent(origin, p, index);
+        Event end = makeEvent(origin, q, index);
+        segments.push_back({p, q, start.key, end.key});
+        events.push_back(start);
+        events.push_back(end);
+    }
+
+    void buildSegments(sf::Vector2f origin, float radius, const std::vector<sf::FloatRect>& walls) {
+        for (uint32_t i : nearby) {
+            const sf::FloatRect& wall = walls[i];
+            float left = wall.left, top = wall.top;
+            float right = left + wall.width, bottom = top + wall.height;
+            // Only the edges facing the viewer can be the nearest
+            if (origin.y < top) addSegment(origin, radius, {left, top}, {right, top});
+            if (origin.y > bottom) addSegment(origin, radius, {left, bottom}, {right, bottom});
+            if (origin.x < left) addSegment(origin, radius, {left, top}, {left, bottom});
+            if (origin.x > right) addSegment(origin, radius, {right, top}, {right, bottom});
+        }
+    }
+
+    static bool isCorner(const sf::FloatRect& wall, sf::Vector2f point) {
+        return (point.x == wall.left || point.x == wall.left + wall.width) &&
+               (point.y == wall.top || point.y == wall.top + wall.height);
+    }
+
+    void addOverlap(sf::Vector2f origin, float radius, const sf::FloatRect& first, const sf::FloatRect& second) {
+        sf::FloatRect overlap;
+        if (!first.intersects(second, overlap)) return;
+        sf::Vector2f corners[4] = {
+            {overlap.left, overlap.top},
+            {overlap.left + overlap.width, overlap.top},
+            {overlap.left, overlap.top + overlap.height},
+            {overlap.left + overlap.width, overlap.top + overlap.height}};
+        for (const auto& corner : corners) {
+            // A wall's own corner is an endpoint event already
+            if (isCorner(first, corner) || isCorner(second, corner)) continue;
+            sf::Vector2f d = corner - origin;
+            if (d.x * d.x + d.y * d.y < radius * radius) {
+                events.push_back(makeEvent(origin, corner, crossing));
+            }
+        }
+    }
+
+    // Edges of two overlapping walls cross only at corners of their
+    // overlap, so those corners are where the nearest edge can switch
+    void addCrossings(sf::Vector2f origin, float radius, const std::vector<sf::FloatRect>& walls,
+                      const WallGrid* grid) {
+        if (grid) {
+            // Pairs share a grid cell; seen marks the walls near the viewer,
+            // so each pair is taken once, from its lower index
+            for (uint32_t i : nearby) {
+                grid->anyInRect(walls[i], [&](uint32_t j) {
+                    if (j > i && seen[j] == pass) addOverlap(origin, radius, walls[i], walls[j]);
+                    return false;
+                });
+            }
+            return;
+        }
+
+        // Sort and sweep by left edge
+        std::sort(nearby.begin(), nearby.end(), [&](uint32_t a, uint32_t b) {
+            return walls[a].left < walls[b].left;
+        });
+        for (size_t i = 0; i < nearby.size(); i++) {
+            const sf::FloatRect& first = walls[nearby[i]];
+            for (size_t j = i + 1; j < nearby.size(); j++) {
+                const sf::FloatRect& second = walls[nearby[j]];
+                if (second.left > first.left + first.width) break;
+                addOverlap(origin, radius, first, second);
+            }
+        }
+    }
+
+    // Distance along a unit direction to the line through segment
+    static float rayDistance(sf::Vector2f origin, sf::Vector2f direction, const Segment& segment) {
+        sf::Vector2f edge = segment.b - segment.a;
+        sf::Vector2f toStart = segment.a - origin;
+        float denominator = direction.x * edge.y - direction.y * edge.x;
+        if (denominator == 0) return 1e30f;
+        return (toStart.x * edge.y - toStart.y * edge.x) / denominator;
+    }
+
+    void addActive(uint32_t segment) {
+        slot[segment] = static_cast<uint32_t>(active.size());
+        active.push_back(segment);
+        added.push_back(segment);
+    }
+
+    void removeActive(uint32_t segment) {
+        if (segment == nearest) rescan = true;
+        uint32_t position = slot[segment];
+        active[position] = active.back();
+        slot[active[position]] = position;
+        active.pop_back();
+        slot[segment] = noSegment;
+    }
+
+    void findNearest(sf::Vector2f origin, sf::Vector2f direction, const std::vector<uint32_t>& candidates,
+                     float& nearestDistance) {
+        for (uint32_t segment : candidates) {
+            if (slot[segment] == noSegment) continue; // Ended in the same event group
+            float distance = rayDistance(origin, direction, segments[segment]);
+            if (distance > 0 && distance < nearestDistance) {
+                nearestDistance = distance;
+                nearest = segment;
+            }
+        }
+    }
+
+    // Lit span between two directions less than half a turn apart
+    void emitSpan(sf::Vector2f origin, float radius, sf::Vector2f from, sf::Vector2f to) {
+        sf::Vector2f middle = from + to;
+        float length = std::sqrt(middle.x * middle.x + middle.y * middle.y);
+        if (length == 0) return;
+        middle /= length;
+
+        // Segments that do not cross keep their depth order wherever both
+        // are under the ray, so the nearest one only has to be searched for
+        // again when it ends or at a crossing; otherwise it is compared
+        // with the newly added segments alone
+        float nearestDistance = radius;
+        if (rescan) {
+            nearest = noSegment;
+            findNearest(origin, middle, active, nearestDistance);
+        } else {
+            if (nearest != noSegment) nearestDistance = rayDistance(origin, middle, segments[nearest]);
+            findNearest(origin, middle, added, nearestDistance);
+        }
+        added.clear();
+        rescan = false;
+
+        if (nearest != noSegment) {
+            rim.push_back(origin + from * rayDistance(origin, from, segments[nearest]));
+            rim.push_back(origin + to * rayDistance(origin, to, segments[nearest]));
+            return;
+        }
+
+        // Open arc of the light's edge, turned in equal steps
+        float angle = std::atan2(from.x * to.y - from.y * to.x, from.x * to.x + from.y * to.y);
+        int steps = std::max(1, static_cast<int>(std::ceil(angle / arcStep)));
+        sf::Vector2f turn(std::cos(angle / steps), std::sin(angle / steps));
+        sf::Vector2f direction = from;
+        rim.push_back(origin + direction * radius);
+        for (int i = 1; i < steps; i++) {
+            direction = sf::Vector2f(direction.x * turn.x - direction.y * turn.y,
+                                     direction.x * turn.y + direction.y * turn.x);
+            rim.push_back(origin + direction * radius);
+        }
+        rim.push_back(origin + to * radius);
+    }
+
+    // Keys are non-negative floats, so their bit patterns sort like the
+    // values: three 11-bit radix passes over the upper word for large sets
+    void sortEvents() {
+        size_t count = events.size();
+        order.resize(count);
+        sortScratch.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, &events[i].key, sizeof(bits));
+            order[i] = (static_cast<uint64_t>(bits) << 32) | i;
+        }
+        if (count < 512) {
+            std::sort(order.begin(), order.end()); // Cheaper than clearing the buckets
+            return;
+        }
+        for (int shift = 32; shift < 64; shift += 11) {
+            uint32_t counts[2048] = {};
+            for (uint64_t entry : order) {
+                counts[(entry >> shift) & 2047]++;
+            }
+            uint32_t total = 0;
+            for (uint32_t& bucket : counts) {
+                uint32_t size = bucket;
+                bucket = total;
+                total += size;
+            }
+            for (uint64_t entry : order) {
+                sortScratch[counts[(entry >> shift) & 2047]++] = entry;
+            }
+            order.swap(sortScratch);
+        }
+    }
+
+    const Event& sortedEvent(size_t i) const {
+        return events[static_cast<uint32_t>(order[i])];
+    }
+
+    void sweep(sf::Vector2f origin, float radius, float limit, sf::Vector2f limitDirection) {
+        sortEvents();
+
+        // Segments already under the ray at the seam start active
+        active.clear();
+        added.clear();
+        nearest = noSegment;
+        rescan = true;
+        slot.assign(segments.size(), noSegment);
+        for (uint32_t i = 0; i < segments.size(); i++) {
+            if (segments[i].startKey > segments[i].endKey) addActive(i);
+        }
+
+        float previous = 0;
+        sf::Vector2f previousDirection = seam;
+        size_t next = 0;
+        while (next < events.size() && sortedEvent(next).key < limit) {
+            const Event& event = sortedEvent(next);
+            if (event.key > previous) {
+                emitSpan(origin, radius, previousDirection, event.direction);
+                previous = event.key;
+                previousDirection = event.direction;
+            }
+            // Apply every event at this angle before looking again
+            for (; next < events.size() && sortedEvent(next).key == previous; next++) {
+                uint32_t segment = sortedEvent(next).segment;
+                if (segment == crossing) rescan = true;
+                if (segment >= crossing) continue;
+                if (slot[segment] == noSegment) addActive(segment);
+                else removeActive(segment);
+            }
+        }
+        if (limit > previous) {
+            emitSpan(origin, radius, previousDirection, limitDirection);
+        }
+    }
+};
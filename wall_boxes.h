@@ -0,0 +1,316 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Wall AABBs packed as a structure of arrays, so the narrow phase can test
+// 4 (SSE) or 8 (AVX) walls per instruction
+struct WallBoxes {
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+
+    size_t size() const { return minX.size(); }
+
+    void clear() {
+        minX.clear();
+        minY.clear();
+        maxX.clear();
+        maxY.clear();
+    }
+
+    void reserve(size_t count) {
+        minX.reserve(count);
+        minY.reserve(count);
+        maxX.reserve(count);
+        maxY.reserve(count);
+    }
+
+    void push_back(const sf::FloatRect& rect) {
+        float right = rect.left + rect.width;
+        float bottom = rect.top + rect.height;
+        minX.push_back(std::min(rect.left, right));
+        minY.push_back(std::min(rect.top, bottom));
+        maxX.push_back(std::max(rect.left, right));
+        maxY.push_back(std::max(rect.top, bottom));
+    }
+
+    void assign(const std::vector<sf::FloatRect>& rects) {
+        clear();
+        reserve(rects.size());
+        for (const auto& rect : rects) {
+            push_back(rect);
+        }
+    }
+};
+
+// Segment p1-p2 prepared for slab tests: one division per query instead of
+// one per wall edge
+struct SegmentQuery {
+    float x1, y1, x2, y2;
+    float invDx, invDy;
+    bool parallelX, parallelY;
+    bool empty;
+
+    SegmentQuery(sf::Vector2f p1, sf::Vector2f p2)
+        : x1(p1.x), y1(p1.y), x2(p2.x), y2(p2.y),
+          invDx(0), invDy(0), parallelX(p2.x == p1.x), parallelY(p2.y == p1.y),
+          empty(p1 == p2) {
+        if (!parallelX) invDx = 1.0f / (p2.x - p1.x);
+        if (!parallelY) invDy = 1.0f / (p2.y - p1.y);
+    }
+};
+
+// Axis-aligned query box with the strict overlap rule of sf::FloatRect::intersects
+struct BoxQuery {
+    float minX, minY, maxX, maxY;
+    bool empty;
+
+    explicit BoxQuery(const sf::FloatRect& rect) {
+        float right = rect.left + rect.width;
+        float bottom = rect.top + rect.height;
+        minX = std::min(rect.left, right);
+        minY = std::min(rect.top, bottom);
+        maxX = std::max(rect.left, right);
+        maxY = std::max(rect.top, bottom);
+        empty = !(minX < maxX) || !(minY < maxY);
+    }
+};
+
+// Reference line-of-sight test: the segment blocks when it crosses one of
+// the four rectangle edges (a segment entirely inside the rectangle does not)
+inline bool lineIntersectsLine(sf::Vector2f l1p1, sf::Vector2f l1p2, sf::Vector2f l2p1, sf::Vector2f l2p2) {
+    // Implementation of line-line intersection
+    float den = (l1p1.x - l1p2.x) * (l2p1.y - l2p2.y) - (l1p1.y - l1p2.y) * (l2p1.x - l2p2.x);
+    if (den == 0) return false;
+
+    float t = ((l1p1.x - l2p1.x) * (l2p1.y - l2p2.y) - (l1p1.y - l2p1.y) * (l2p1.x - l2p2.x)) / den;
+    float u = -((l1p1.x - l1p2.x) * (l1p1.y - l2p1.y) - (l1p1.y - l1p2.y) * (l1p1.x - l2p1.x)) / den;
+
+    return t >= 0 && t <= 1 && u >= 0 && u <= 1;
+}
+
+inline bool lineIntersectsRect(sf::Vector2f p1, sf::Vector2f p2, sf::FloatRect rect) {
+    // Check if line intersects with rectangle
+    return lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top), sf::Vector2f(rect.left + rect.width, rect.top)) ||
+           lineIntersectsLine(p1, p2, sf::Vector2f(rect.left + rect.width, rect.top), sf::Vector2f(rect.left + rect.width, rect.top + rect.height)) ||
+           lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top + rect.height), sf::Vector2f(rect.left + rect.width, rect.top + rect.height)) ||
+           lineIntersectsLine(p1, p2, sf::Vector2f(rect.left, rect.top), sf::Vector2f(rect.left, rect.top + rect.height));
+}
+
+// Slab test with the same edge-crossing semantics as lineIntersectsRect().
+// That test never counts an edge parallel to the segment, so a segment
+// lying along an edge only hits if it reaches one of the two edges across
+// it: on the axis the segment does not move along, the endpoints count as
+// inside even on the boundary. min/max are written as the SSE minps/maxps
+// select so every kernel below produces bit-identical results.
+inline bool segmentHitsBox(const SegmentQuery& q, float minX, float minY, float maxX, float maxY) {
+    float tNear = 0.0f;
+    float tFar = 1.0f;
+
+    if (q.parallelX) {
+        if (!(q.x1 >= minX && q.x1 <= maxX)) return false;
+    } else {
+        float t1 = (minX - q.x1) * q.invDx;
+        float t2 = (maxX - q.x1) * q.invDx;
+        float lo = t1 < t2 ? t1 : t2;
+        float hi = t1 > t2 ? t1 : t2;
+        tNear = tNear > lo ? tNear : lo;
+        tFar = tFar < hi ? tFar : hi;
+    }
+    if (q.parallelY) {
+        if (!(q.y1 >= minY && q.y1 <= maxY)) return false;
+    } else {
+        float t1 = (minY - q.y1) * q.invDy;
+        float t2 = (maxY - q.y1) * q.invDy;
+        float lo = t1 < t2 ? t1 : t2;
+        float hi = t1 > t2 ? t1 : t2;
+        tNear = tNear > lo ? tNear : lo;
+        tFar = tFar < hi ? tFar : hi;
+    }
+    if (!(tNear <= tFar)) return false;
+
+    // Both endpoints strictly inside means no edge is crossed
+    bool inside1 = (q.parallelX || (q.x1 > minX && q.x1 < maxX)) && (q.parallelY || (q.y1 > minY && q.y1 < maxY));
+    bool inside2 = (q.parallelX || (q.x2 > minX && q.x2 < maxX)) && (q.parallelY || (q.y2 > minY && q.y2 < maxY));
+    return !(inside1 && inside2);
+}
+
+inline bool boxOverlapsBox(const BoxQuery& q, float minX, float minY, float maxX, float maxY) {
+    return q.minX < maxX && minX < q.maxX && q.minY < maxY && minY < q.maxY;
+}
+
+inline bool anySegmentHitScalar(const WallBoxes& boxes, size_t begin, size_t end, const SegmentQuery& q) {
+    if (q.empty) return false;
+    for (size_t i = begin; i < end; i++) {
+        if (segmentHitsBox(q, boxes.minX[i], boxes.minY[i], boxes.maxX[i], boxes.maxY[i])) return true;
+    }
+    return false;
+}
+
+inline bool anyBoxOverlapScalar(const WallBoxes& boxes, size_t begin, size_t end, const BoxQuery& q) {
+    if (q.empty) return false;
+    for (size_t i = begin; i < end; i++) {
+        if (boxOverlapsBox(q, boxes.minX[i], boxes.minY[i], boxes.maxX[i], boxes.maxY[i])) return true;
+    }
+    return false;
+}
+
+#if defined(__SSE2__)
+inline bool anySegmentHitSse(const WallBoxes& boxes, size_t begin, size_t end, const SegmentQuery& q) {
+    if (q.empty) return false;
+    const __m128 x1 = _mm_set1_ps(q.x1), y1 = _mm_set1_ps(q.y1);
+    const __m128 x2 = _mm_set1_ps(q.x2), y2 = _mm_set1_ps(q.y2);
+    const __m128 invDx = _mm_set1_ps(q.invDx), invDy = _mm_set1_ps(q.invDy);
+    const __m128 zero = _mm_set1_ps(0.0f), one = _mm_set1_ps(1.0f);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 minX = _mm_loadu_ps(&boxes.minX[i]);
+        __m128 minY = _mm_loadu_ps(&boxes.minY[i]);
+        __m128 maxX = _mm_loadu_ps(&boxes.maxX[i]);
+        __m128 maxY = _mm_loadu_ps(&boxes.maxY[i]);
+        __m128 tNear = zero, tFar = one;
+        __m128 hit = _mm_cmpeq_ps(zero, zero);
+
+        if (q.parallelX) {
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(x1, minX), _mm_cmple_ps(x1, maxX)));
+        } else {
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(minX, x1), invDx);
+            __m128 t2 = _mm_mul_ps(_mm_sub_ps(maxX, x1), invDx);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t1, t2));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t1, t2));
+        }
+        if (q.parallelY) {
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(y1, minY), _mm_cmple_ps(y1, maxY)));
+        } else {
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(minY, y1), invDy);
+            __m128 t2 = _mm_mul_ps(_mm_sub_ps(maxY, y1), invDy);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t1, t2));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t1, t2));
+        }
+        hit = _mm_and_ps(hit, _mm_cmple_ps(tNear, tFar));
+
+        __m128 all = _mm_cmpeq_ps(zero, zero);
+        __m128 inside1 = _mm_and_ps(q.parallelX ? all : _mm_and_ps(_mm_cmpgt_ps(x1, minX), _mm_cmplt_ps(x1, maxX)),
+                                    q.parallelY ? all : _mm_and_ps(_mm_cmpgt_ps(y1, minY), _mm_cmplt_ps(y1, maxY)));
+        __m128 inside2 = _mm_and_ps(q.parallelX ? all : _mm_and_ps(_mm_cmpgt_ps(x2, minX), _mm_cmplt_ps(x2, maxX)),
+                                    q.parallelY ? all : _mm_and_ps(_mm_cmpgt_ps(y2, minY), _mm_cmplt_ps(y2, maxY)));
+        hit = _mm_andnot_ps(_mm_and_ps(inside1, inside2), hit);
+        if (_mm_movemask_ps(hit)) return true;
+    }
+    return anySegmentHitScalar(boxes, i, end, q);
+}
+
+inline bool anyBoxOverlapSse(const WallBoxes& boxes, size_t begin, size_t end, const BoxQuery& q) {
+    if (q.empty) return false;
+    const __m128 qMinX = _mm_set1_ps(q.minX), qMinY = _mm_set1_ps(q.minY);
+    const __m128 qMaxX = _mm_set1_ps(q.maxX), qMaxY = _mm_set1_ps(q.maxY);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_and_ps(_mm_cmplt_ps(qMinX, _mm_loadu_ps(&boxes.maxX[i])),
+                              _mm_cmplt_ps(_mm_loadu_ps(&boxes.minX[i]), qMaxX));
+        __m128 y = _mm_and_ps(_mm_cmplt_ps(qMinY, _mm_loadu_ps(&boxes.maxY[i])),
+                              _mm_cmplt_ps(_mm_loadu_ps(&boxes.minY[i]), qMaxY));
+        if (_mm_movemask_ps(_mm_and_ps(x, y))) return true;
+    }
+    return anyBoxOverlapScalar(boxes, i, end, q);
+}
+#endif
+
+#if defined(__AVX__)
+inline bool anySegmentHitAvx(const WallBoxes& boxes, size_t begin, size_t end, const SegmentQuery& q) {
+    if (q.empty) return false;
+    const __m256 x1 = _mm256_set1_ps(q.x1), y1 = _mm256_set1_ps(q.y1);
+    const __m256 x2 = _mm256_set1_ps(q.x2), y2 = _mm256_set1_ps(q.y2);
+    const __m256 invDx = _mm256_set1_ps(q.invDx), invDy = _mm256_set1_ps(q.invDy);
+    const __m256 zero = _mm256_set1_ps(0.0f), one = _mm256_set1_ps(1.0f);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 minX = _mm256_loadu_ps(&boxes.minX[i]);
+        __m256 minY = _mm256_loadu_ps(&boxes.minY[i]);
+        __m256 maxX = _mm256_loadu_ps(&boxes.maxX[i]);
+        __m256 maxY = _mm256_loadu_ps(&boxes.maxY[i]);
+        __m256 tNear = zero, tFar = one;
+        __m256 hit = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+        if (q.parallelX) {
+            hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(x1, minX, _CMP_GE_OQ), _mm256_cmp_ps(x1, maxX, _CMP_LE_OQ)));
+        } else {
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(minX, x1), invDx);
+            __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(maxX, x1), invDx);
+            tNear = _mm256_max_ps(tNear, _mm256_min_ps(t1, t2));
+            tFar = _mm256_min_ps(tFar, _mm256_max_ps(t1, t2));
+        }
+        if (q.parallelY) {
+            hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(y1, minY, _CMP_GE_OQ), _mm256_cmp_ps(y1, maxY, _CMP_LE_OQ)));
+        } else {
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(minY, y1), invDy);
+            __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(maxY, y1), invDy);
+            tNear = _mm256_max_ps(tNear, _mm256_min_ps(t1, t2));
+            tFar = _mm256_min_ps(tFar, _mm256_max_ps(t1, t2));
+        }
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ));
+
+        __m256 all = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        __m256 inside1 = _mm256_and_ps(
+            q.parallelX ? all : _mm256_and_ps(_mm256_cmp_ps(x1, minX, _CMP_GT_OQ), _mm256_cmp_ps(x1, maxX, _CMP_LT_OQ)),
+            q.parallelY ? all : _mm256_and_ps(_mm256_cmp_ps(y1, minY, _CMP_GT_OQ), _mm256_cmp_ps(y1, maxY, _CMP_LT_OQ)));
+        __m256 inside2 = _mm256_and_ps(
+            q.parallelX ? all : _mm256_and_ps(_mm256_cmp_ps(x2, minX, _CMP_GT_OQ), _mm256_cmp_ps(x2, maxX, _CMP_LT_OQ)),
+            q.parallelY ? all : _mm256_and_ps(_mm256_cmp_ps(y2, minY, _CMP_GT_OQ), _mm256_cmp_ps(y2, maxY, _CMP_LT_OQ)));
+        hit = _mm256_andnot_ps(_mm256_and_ps(inside1, inside2), hit);
+        if (_mm256_movemask_ps(hit)) return true;
+    }
+    return anySegmentHitSse(boxes, i, end, q);
+}
+
+inline bool anyBoxOverlapAvx(const WallBoxes& boxes, size_t begin, size_t end, const BoxQuery& q) {
+    if (q.empty) return false;
+    const __m256 qMinX = _mm256_set1_ps(q.minX), qMinY = _mm256_set1_ps(q.minY);
+    const __m256 qMaxX = _mm256_set1_ps(q.maxX), qMaxY = _mm256_set1_ps(q.maxY);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_and_ps(_mm256_cmp_ps(qMinX, _mm256_loadu_ps(&boxes.maxX[i]), _CMP_LT_OQ),
+                                 _mm256_cmp_ps(_mm256_loadu_ps(&boxes.minX[i]), qMaxX, _CMP_LT_OQ));
+        __m256 y = _mm256_and_ps(_mm256_cmp_ps(qMinY, _mm256_loadu_ps(&boxes.maxY[i]), _CMP_LT_OQ),
+                                 _mm256_cmp_ps(_mm256_loadu_ps(&boxes.minY[i]), qMaxY, _CMP_LT_OQ));
+        if (_mm256_movemask_ps(_mm256_and_ps(x, y))) return true;
+    }
+    return anyBoxOverlapSse(boxes, i, end, q);
+}
+#endif
+
+// Widest kernel available in this build
+inline bool anySegmentHit(const WallBoxes& boxes, size_t begin, size_t end, const SegmentQuery& q) {
+#if defined(__AVX__)
+    return anySegmentHitAvx(boxes, begin, end, q);
+#elif defined(__SSE2__)
+    return anySegmentHitSse(boxes, begin, end, q);
+#else
+    return anySegmentHitScalar(boxes, begin, end, q);
+#endif
+}
+
+inline bool anyBoxOverlap(const WallBoxes& boxes, size_t begin, size_t end, const BoxQuery& q) {
+#if defined(__AVX__)
+    return anyBoxOverlapAvx(boxes, begin, end, q);
+#elif defined(__SSE2__)
+    return anyBoxOverlapSse(boxes, begin, end, q);
+#else
+    return anyBoxOverlapScalar(boxes, begin, end, q);
+#endif
+}
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include "wall_boxes.h"
+
+// Static uniform grid over the wall rectangles, built once after the map is
+// created. Each cell stores the indices of the walls overlapping it, packed
+// into one flat array (cellStart[c]..cellStart[c + 1]), alongside a copy of
+// their AABBs in the same order so a cell can be tested with the SIMD kernels
+// from wall_boxes.h.
+//
+// The callback queries only hand candidate indices to the caller. A wall
+// spanning several cells may be reported more than once, which keeps queries
+// free of shared scratch state.
+class WallGrid {
+public:
+    WallGrid() : cellSize(64.0f), columns(0), rows(0) {}
+
+    void build(const std::vector<sf::FloatRect>& walls, float size = 64.0f) {
+        cellSize = size;
+        cellStart.clear();
+        cellWalls.clear();
+        cellBoxes.clear();
+        columns = rows = 0;
+        if (walls.empty()) return;
+
+        // Grid covers the bounding box of all walls
+        float minX = walls[0].left, minY = walls[0].top;
+        float maxX = minX, maxY = minY;
+        for (const auto& wall : walls) {
+            minX = std::min(minX, wall.left);
+            minY = std::min(minY, wall.top);
+            maxX = std::max(maxX, wall.left + wall.width);
+            maxY = std::max(maxY, wall.top + wall.height);
+        }
+        origin = sf::Vector2f(minX - cellPadding, minY - cellPadding);
+        columns = static_cast<int>((maxX - minX + 2 * cellPadding) / cellSize) + 1;
+        rows = static_cast<int>((maxY - minY + 2 * cellPadding) / cellSize) + 1;
+
+        // Count, prefix-sum, then fill
+        cellStart.assign(columns * rows + 1, 0);
+        for (const auto& wall : walls) {
+            forEachCell(padded(wall), [&](int cell) { cellStart[cell + 1]++; });
+        }
+        for (size_t i = 1; i < cellStart.size(); i++) {
+            cellStart[i] += cellStart[i - 1];
+        }
+        cellWalls.resize(cellStart.back());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < walls.size(); i++) {
+            forEachCell(padded(walls[i]), [&](int cell) { cellWalls[fill[cell]++] = i; });
+        }
+        cellBoxes.reserve(cellWalls.size());
+        for (uint32_t wall : cellWalls) {
+            cellBoxes.push_back(walls[wall]);
+        }
+    }
+
+    // True when area overlaps any wall (same rule as sf::FloatRect::intersects)
+    bool overlapsBox(const sf::FloatRect& area) const {
+        BoxQuery query(area);
+        bool hit = false;
+        forEachCell(area, [&](int cell) {
+            hit = anyBoxOverlap(cellBoxes, cellStart[cell], cellStart[cell + 1], query);
+            return hit;
+        });
+        return hit;
+    }
+
+    // True when the segment p1-p2 crosses the edge of any wall
+    bool segmentBlocked(sf::Vector2f p1, sf::Vector2f p2) const {
+        SegmentQuery query(p1, p2);
+        return walkCells(p1, p2, [&](int cell) {
+            return anySegmentHit(cellBoxes, cellStart[cell], cellStart[cell + 1], query);
+        });
+    }
+
+    // Moves box by delta one axis at a time, stopping each axis where the
+    // box would touch a wall, so it slides along walls instead of stopping
+    // dead. The whole path is swept, so no step is long enough to pass
+    // through a wall. Returns the distance actually moved.
+    sf::Vector2f moveBox(sf::FloatRect box, sf::Vector2f delta) const {
+        sf::Vector2f moved;
+        moved.x = sweepAxis(box, delta.x, 0);
+        box.left += moved.x;
+        moved.y = sweepAxis(box, delta.y, 1);
+        return moved;
+    }
+
+    // How far box can travel by delta along one axis (0 = x, 1 = y) before
+    // touching a wall. Walls it already overlaps are ignored, so a box
+    // pushed into one can still get out.
+    float sweepAxis(const sf::FloatRect& box, float delta, int axis) const {
+        if (delta == 0) return 0;
+        float low = axis == 0 ? box.left : box.top;
+        float high = low + (axis == 0 ? box.width : box.height);
+        float sideLow = axis == 0 ? box.top : box.left;
+        float sideHigh = sideLow + (axis == 0 ? box.height : box.width);
+        const std::vector<float>& wallLow = axis == 0 ? cellBoxes.minX : cellBoxes.minY;
+        const std::vector<float>& wallHigh = axis == 0 ? cellBoxes.maxX : cellBoxes.maxY;
+        const std::vector<float>& wallSideLow = axis == 0 ? cellBoxes.minY : cellBoxes.minX;
+        const std::vector<float>& wallSideHigh = axis == 0 ? cellBoxes.maxY : cellBoxes.maxX;
+
+        sf::FloatRect swept = box;
+        (axis == 0 ? swept.width : swept.height) += std::abs(delta);
+        if (delta < 0) (axis == 0 ? swept.left : swept.top) += delta;
+
+        float allowed = std::abs(delta);
+        forEachCell(swept, [&](int cell) {
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+                // Only walls beside the path, with the strict overlap rule
+                if (wallSideLow[i] >= sideHigh || wallSideHigh[i] <= sideLow) continue;
+                if (delta > 0 && wallLow[i] >= high - contactSlop) {
+                    allowed = std::min(allowed, std::max(0.0f, wallLow[i] - high));
+                } else if (delta < 0 && wallHigh[i] <= low + contactSlop) {
+                    allowed = std::min(allowed, std::max(0.0f, low - wallHigh[i]));
+                }
+            }
+        });
+        return delta > 0 ? allowed : -allowed;
+    }
+
+    // First wall face on the ray start + direction * t, for t in [0, maxT).
+    // Returns its t (maxT when nothing is that close) and sets side to 0
+    // for a face across x (left or right side of a wall), 1 across y.
+    // Walls the start is inside are ignored.
+    float castRay(sf::Vector2f start, sf::Vector2f direction, float maxT, int& side) const {
+        float best = maxT;
+        side = 0;
+        bool parallelX = direction.x == 0, parallelY = direction.y == 0;
+        float invDx = parallelX ? 0 : 1.0f / direction.x;
+        float invDy = parallelY ? 0 : 1.0f / direction.y;
+        walkCells(start, start + direction * maxT, [&](int cell) {
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+                float nearX = -INFINITY, farX = INFINITY, nearY = -INFINITY, farY = INFINITY;
+                if (parallelX) {
+                    if (!(start.x >= cellBoxes.minX[i] && start.x <= cellBoxes.maxX[i])) continue;
+                } else {
+                    float t1 = (cellBoxes.minX[i] - start.x) * invDx;
+                    float t2 = (cellBoxes.maxX[i] - start.x) * invDx;
+                    nearX = std::min(t1, t2);
+                    farX = std::max(t1, t2);
+                }
+                if (parallelY) {
+                    if (!(start.y >= cellBoxes.minY[i] && start.y <= cellBoxes.maxY[i])) continue;
+                } else {
+                    float t1 = (cellBoxes.minY[i] - start.y) * invDy;
+                    float t2 = (cellBoxes.maxY[i] - start.y) * invDy;
+                    nearY = std::min(t1, t2);
+                    farY = std::max(t1, t2);
+                }
+                float tNear = std::max(nearX, nearY);
+                if (tNear >= 0 && tNear <= std::min(farX, farY) && tNear < best) {
+                    best = tNear;
+                    side = nearX >= nearY ? 0 : 1;
+                }
+            }
+
+            // A hit inside this cell beats anything in the cells after it
+            int cx = cell % columns, cy = cell / columns;
+            float exitX = parallelX ? INFINITY
+                : (origin.x + (cx + (direction.x > 0 ? 1 : 0)) * cellSize - start.x) * invDx;
+            float exitY = parallelY ? INFINITY
+                : (origin.y + (cy + (direction.y > 0 ? 1 : 0)) * cellSize - start.y) * invDy;
+            return best <= std::min(exitX, exitY);
+        });
+        return best;
+    }
+
+    // Calls test(wallIndex) for walls near area until one returns true
+    template <typename Test>
+    bool anyInRect(const sf::FloatRect& area, Test&& test) const {
+        bool hit = false;
+        forEachCell(area, [&](int cell) {
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1] && !hit; i++) {
+                hit = test(cellWalls[i]);
+            }
+            return hit;
+        });
+        return hit;
+    }
+
+    // Walks the cells crossed by the segment p1-p2 (DDA) and calls
+    // test(wallIndex) for their walls until one returns true
+    template <typename Test>
+    bool anyAlongSegment(sf::Vector2f p1, sf::Vector2f p2, Test&& test) const {
+        return walkCells(p1, p2, [&](int cell) {
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+                if (test(cellWalls[i])) return true;
+            }
+            return false;
+        });
+    }
+
+private:
+    // Walls are inserted slightly enlarged so that rays grazing a cell
+    // corner or boundary never miss a wall touching it
+    static constexpr float cellPadding = 0.5f;
+
+    // A box this close to a wall counts as touching it rather than inside
+    // it, so rounding after a stop cannot let the next sweep through
+    static constexpr float contactSlop = 0.01f;
+
+    float cellSize;
+    sf::Vector2f origin;
+    int columns;
+    int rows;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellWalls;
+    WallBoxes cellBoxes;
+
+    // Visits the cells crossed by the segment p1-p2 in order (DDA) until
+    // visit returns true
+    template <typename Visit>
+    bool walkCells(sf::Vector2f p1, sf::Vector2f p2, Visit&& visit) const {
+        if (columns == 0 || !clipToGrid(p1, p2)) return false;
+
+        float x = (p1.x - origin.x) / cellSize;
+        float y = (p1.y - origin.y) / cellSize;
+        float dx = (p2.x - p1.x) / cellSize;
+        float dy = (p2.y - p1.y) / cellSize;
+        int cx = clampColumn(static_cast<int>(std::floor(x)));
+        int cy = clampRow(static_cast<int>(std::floor(y)));
+        int endX = clampColumn(static_cast<int>(std::floor(x + dx)));
+        int endY = clampRow(static_cast<int>(std::floor(y + dy)));
+
+        int stepX = dx > 0 ? 1 : -1;
+        int stepY = dy > 0 ? 1 : -1;
+        float deltaX = dx != 0 ? std::abs(1.0f / dx) : INFINITY;
+        float deltaY = dy != 0 ? std::abs(1.0f / dy) : INFINITY;
+        float nextX = dx != 0 ? (dx > 0 ? cx + 1 - x : x - cx) * deltaX : INFINITY;
+        float nextY = dy != 0 ? (dy > 0 ? cy + 1 - y : y - cy) * deltaY : INFINITY;
+
+        // Bounded by the Manhattan cell distance in case rounding skips the end cell
+        int remaining = std::abs(endX - cx) + std::abs(endY - cy);
+        while (true) {
+            if (visit(cy * columns + cx)) return true;
+            if (remaining-- <= 0) return false;
+
+            if (nextX < nextY) {
+                cx += stepX;
+                nextX += deltaX;
+            } else {
+                cy += stepY;
+                nextY += deltaY;
+            }
+            if (cx < 0 || cx >= columns || cy < 0 || cy >= rows) return false;
+        }
+    }
+
+    static sf::FloatRect padded(const sf::FloatRect& rect) {
+        return sf::FloatRect(rect.left - cellPadding, rect.top - cellPadding,
+                             rect.width + 2 * cellPadding, rect.height + 2 * cellPadding);
+    }
+
+    int clampColumn(int x) const { return std::max(0, std::min(columns - 1, x)); }
+    int clampRow(int y) const { return std::max(0, std::min(rows - 1, y)); }
+
+    // Visits cells overlapping rect; visit returns true to stop early
+    template <typename Visit>
+    void forEachCell(const sf::FloatRect& rect, Visit&& visit) const {
+        if (columns == 0) return;
+        float x0 = (rect.left - origin.x) / cellSize;
+        float y0 = (rect.top - origin.y) / cellSize;
+        float x1 = (rect.left + rect.width - origin.x) / cellSize;
+        float y1 = (rect.top + rect.height - origin.y) / cellSize;
+        if (x1 < 0 || y1 < 0 || x0 >= columns || y0 >= rows) return;
+
+        int minX = clampColumn(static_cast<int>(std::floor(x0)));
+        int minY = clampRow(static_cast<int>(std::floor(y0)));
+        int maxX = clampColumn(static_cast<int>(std::floor(x1)));
+        int maxY = clampRow(static_cast<int>(std::floor(y1)));
+        for (int cy = minY; cy <= maxY; cy++) {
+            for (int cx = minX; cx <= maxX; cx++) {
+                if (callVisit(visit, cy * columns + cx)) return;
+            }
+        }
+    }
+
+    // Lets build() pass visitors that return void
+    template <typename Visit>
+    static bool callVisit(Visit& visit, int cell) {
+        if constexpr (std::is_same<decltype(visit(cell)), void>::value) {
+            visit(cell);
+            return false;
+        } else {
+            return visit(cell);
+        }
+    }
+
+    // Liang-Barsky clip of p1-p2 against the grid bounds
+    bool clipToGrid(sf::Vector2f& p1, sf::Vector2f& p2) const {
+        float minX = origin.x, minY = origin.y;
+        float maxX = origin.x + columns * cellSize, maxY = origin.y + rows * cellSize;
+        float dx = p2.x - p1.x, dy = p2.y - p1.y;
+        float t0 = 0, t1 = 1;
+        float p[4] = {-dx, dx, -dy, dy};
+        float q[4] = {p1.x - minX, maxX - p1.x, p1.y - minY, maxY - p1.y};
+        for (int i = 0; i < 4; i++) {
+            if (p[i] == 0) {
+                if (q[i] < 0) return false;
+            } else {
+                float t = q[i] / p[i];
+                if (p[i] < 0) t0 = std::max(t0, t);
+                else t1 = std::min(t1, t);
+            }
+        }
+        if (t0 > t1) return false;
+        sf::Vector2f start = p1;
+        p1 = start + sf::Vector2f(dx, dy) * t0;
+        p2 = start + sf::Vector2f(dx, dy) * t1;
+        return true;
+    }
+};
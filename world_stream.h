@@ -0,0 +1,424 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "render_batch.h"
+#include "sprite_atlas.h"
+
+// Map geometry streamed in square chunks around the view, for maps too
+// big to bake whole. An object belongs to the chunk holding its centre,
+// and that chunk's bounds grow to cover it, so culling by chunk bounds
+// never drops a visible object. build() only
+// indexes the map, 4 bytes per object. Chunks within loadRadius of the
+// view centre, and of where the view will be lookahead seconds from now,
+// are baked on a background thread and uploaded a few per frame. Baked
+// chunks live in a fixed pool of slots, each sized for the largest chunk,
+// so memory depends on the radius rather than the map and streaming does
+// not allocate. A slot is taken back from the chunk farthest behind the
+// view only when a new chunk needs it.
+class WorldStream {
+public:
+    struct Stats {
+        unsigned chunks = 0;    // Holding at least one object
+        unsigned slots = 0;
+        unsigned resident = 0;  // Baked and uploaded
+        unsigned pending = 0;   // Queued, baking or waiting to upload
+        uint64_t loads = 0;     // Since build
+        uint64_t evictions = 0;
+        uint64_t misses = 0;    // Chunks in view but not resident, summed over draws
+        size_t poolBytes = 0;   // Vertices held by the slot pool
+    };
+
+    static constexpr float lookahead = 1.0f;    // Seconds of movement prefetched
+    static constexpr unsigned uploadsPerFrame = 2;
+
+    WorldStream() : chunkSize(1024.0f), loadRadius(1000.0f), columns(0), rows(0), overhang(0), maxVertices(0),
+                    walls(nullptr), hidingSpots(nullptr), queueHead(0), queueCount(0), busy(false), stopping(false) {
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    ~WorldStream() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    WorldStream(const WorldStream&) = delete;
+    WorldStream& operator=(const WorldStream&) = delete;
+
+    // Indexes the map and bakes the chunks around center right away, so the
+    // first frame is complete. walls and hidingSpots must not change while
+    // this stream uses them. Building again drops every chunk.
+    void build(const std::vector<sf::FloatRect>& wallRects, const std::vector<sf::FloatRect>& closetRects,
+               const sf::FloatRect& area, const SpriteAtlas& atlas, sf::Vector2f center,
+               float size = 1024.0f, float radius = 1000.0f) {
+        {
+            // Let any bake in flight finish; the worker then sleeps until
+            // the next request
+            std::unique_lock<std::mutex> lock(mutex);
+            queueCount = 0;
+            idle.wait(lock, [this] { return !busy; });
+        }
+
+        walls = &wallRects;
+        hidingSpots = &closetRects;
+        const sf::IntRect& white = atlas.region(SPRITE_WHITE);
+        wallTexels = sf::FloatRect(white.left + 1.5f, white.top + 1.5f, 0, 0);
+        closetTexels = sf::FloatRect(atlas.region(SPRITE_CLOSET));
+        chunkSize = size;
+        loadRadius = radius;
+        origin = sf::Vector2f(area.left, area.top);
+        columns = std::max(1, static_cast<int>(std::ceil(area.width / chunkSize)));
+        rows = std::max(1, static_cast<int>(std::ceil(area.height / chunkSize)));
+        counters = Stats();
+
+        // Counting sort of objects by chunk
+        size_t chunkCount = static_cast<size_t>(columns) * rows;
+        uint32_t objectCount = static_cast<uint32_t>(walls->size() + hidingSpots->size());
+        chunkFirst.assign(chunkCount + 1, 0);
+        chunkBounds.assign(chunkCount, sf::FloatRect());
+        overhang = 0;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            chunkFirst[chunkOf(object(i)) + 1]++;
+        }
+        for (size_t c = 0; c < chunkCount; c++) {
+            chunkFirst[c + 1] += chunkFirst[c];
+        }
+        objects.assign(objectCount, 0);
+        std::vector<uint32_t> fill(chunkFirst.begin(), chunkFirst.end() - 1);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            const sf::FloatRect& bounds = object(i);
+            int c = chunkOf(bounds);
+            grow(c, bounds, fill[c] == chunkFirst[c]);
+            objects[fill[c]++] = i;
+        }
+
+        maxVertices = 0;
+        for (size_t c = 0; c < chunkCount; c++) {
+            unsigned count = chunkObjects(static_cast<int>(c));
+            counters.chunks += count > 0;
+            maxVertices = std::max<size_t>(maxVertices, count * 6);
+        }
+
+        // Enough slots for everything within reach of the view now and of
+        // where it is heading, whichever way that is
+        int span = static_cast<int>(std::ceil(2 * (loadRadius + chunkSize / 2 + overhang) / chunkSize)) + 1;
+        size_t slotCount = std::min<size_t>(chunkCount, 2 * static_cast<size_t>(span) * span);
+        slots = std::vector<Slot>(slotCount);
+        for (Slot& slot : slots) {
+            slot.vertices.resize(maxVertices); // Then cleared, keeping the capacity
+            slot.vertices.clear();
+            slot.useBuffer = sf::VertexBuffer::isAvailable() && maxVertices > 0 && slot.buffer.create(maxVertices);
+        }
+        queue.assign(slotCount, 0);
+        queueHead = 0;
+        chunkSlot.assign(chunkCount, -1);
+        wanted.clear();
+        wanted.reserve(slotCount);
+        counters.slots = static_cast<unsigned>(slotCount);
+        counters.poolBytes = slotCount * maxVertices * sizeof(sf::Vertex);
+
+        // Baked here rather than on the worker, so nothing pops in
+        keepCenter = keepAhead = center;
+        collectWanted(center, loadRadius);
+        for (const Wanted& want : wanted) {
+            int s = claimSlot(want.chunk);
+            if (s < 0) break;
+            bake(slots[s]);
+            upload(slots[s]);
+        }
+    }
+
+    // Requests the chunks around center and ahead along velocity (units
+    // per second), and uploads up to uploadsPerFrame that have finished
+    // baking. Call once per frame, before draw().
+    void update(sf::Vector2f center, sf::Vector2f velocity) {
+        if (slots.empty()) return;
+        uploadBaked();
+
+        // Nearest first, then the ones ahead
+        keepCenter = center;
+        keepAhead = center + velocity * lookahead;
+        collectWanted(keepCenter, loadRadius);
+        request();
+        if (keepAhead != keepCenter) {
+            collectWanted(keepAhead, loadRadius);
+            request();
+        }
+    }
+
+    // Draws the resident chunks overlapping visible; counts are per object
+    CullCounts draw(sf::RenderTarget& target, const sf::FloatRect& visible, sf::RenderStates states) {
+        CullCounts counts;
+        forChunks(visible, [&](int c) {
+            int s = chunkSlot[c];
+            if (s >= 0 && slots[s].resident) {
+                const Slot& slot = slots[s];
+                if (slot.useBuffer) {
+                    target.draw(slot.buffer, 0, slot.vertexCount, states);
+                } else if (slot.vertexCount > 0) {
+                    target.draw(&slot.vertices[0], slot.vertexCount, sf::Triangles, states);
+                }
+                counts.drawn += chunkObjects(c);
+            } else {
+                counters.misses++;
+            }
+        });
+        counts.culled = static_cast<unsigned>(objects.size()) - counts.drawn;
+        return counts;
+    }
+
+    // Chunks overlapping visible that are not resident yet
+    unsigned missing(const sf::FloatRect& visible) const {
+        unsigned count = 0;
+        forChunks(visible, [&](int c) { count += chunkSlot[c] < 0 || !slots[chunkSlot[c]].resident; });
+        return count;
+    }
+
+    // Chunk an object with these bounds belongs to, and whether it is drawn
+    int chunkOf(const sf::FloatRect& bounds) const {
+        int column = clampColumn(static_cast<int>(std::floor((bounds.left + bounds.width / 2 - origin.x) / chunkSize)));
+        int row = clampRow(static_cast<int>(std::floor((bounds.top + bounds.height / 2 - origin.y) / chunkSize)));
+        return row * columns + column;
+    }
+
+    bool resident(int chunk) const {
+        return chunkSlot[chunk] >= 0 && slots[chunkSlot[chunk]].resident;
+    }
+
+    Stats stats() const {
+        Stats result = counters;
+        for (const Slot& slot : slots) {
+            result.resident += slot.resident;
+            result.pending += slot.queued;
+        }
+        return result;
+    }
+
+private:
+    struct Slot {
+        int chunk = -1;
+        bool queued = false;   // Owned by the worker until baked
+        bool baked = false;    // Set by the worker, under the mutex
+        bool resident = false;
+        bool useBuffer = false;
+        size_t vertexCount = 0;
+        sf::VertexArray vertices{sf::Triangles};
+        sf::VertexBuffer buffer{sf::Triangles, sf::VertexBuffer::Dynamic};
+    };
+
+    struct Wanted {
+        int chunk;
+        float distance;
+    };
+
+    float chunkSize;
+    float loadRadius;
+    sf::Vector2f origin;
+    int columns;
+    int rows;
+    float overhang; // How far any chunk's contents reach past its cell
+    size_t maxVertices;
+
+    // Index, fixed at build: objects of chunk c are
+    // objects[chunkFirst[c]..chunkFirst[c + 1]), walls first then closets
+    const std::vector<sf::FloatRect>* walls;
+    const std::vector<sf::FloatRect>* hidingSpots;
+    sf::FloatRect wallTexels;
+    sf::FloatRect closetTexels;
+    std::vector<uint32_t> chunkFirst;
+    std::vector<uint32_t> objects;
+    std::vector<sf::FloatRect> chunkBounds;
+
+    // Main thread only, apart from the slots' queued vertices
+    std::vector<Slot> slots;
+    std::vector<int32_t> chunkSlot; // -1 if not in a slot
+    std::vector<Wanted> wanted;
+    sf::Vector2f keepCenter; // Where the view is and will be, as of the last update
+    sf::Vector2f keepAhead;
+    Stats counters;
+
+    // Requests for the worker, a ring of slot indices
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<int32_t> queue;
+    size_t queueHead;
+    size_t queueCount;
+    bool busy;
+    bool stopping;
+    std::thread worker;
+
+    const sf::FloatRect& object(uint32_t i) const {
+        return i < walls->size() ? (*walls)[i] : (*hidingSpots)[i - walls->size()];
+    }
+
+    unsigned chunkObjects(int c) const { return chunkFirst[c + 1] - chunkFirst[c]; }
+
+    void grow(int c, const sf::FloatRect& bounds, bool first) {
+        sf::FloatRect& chunk = chunkBounds[c];
+        if (first) chunk = bounds;
+        float right = std::max(chunk.left + chunk.width, bounds.left + bounds.width);
+        float bottom = std::max(chunk.top + chunk.height, bounds.top + bounds.height);
+        chunk.left = std::min(chunk.left, bounds.left);
+        chunk.top = std::min(chunk.top, bounds.top);
+        chunk.width = right - chunk.left;
+        chunk.height = bottom - chunk.top;
+
+        sf::Vector2f cell(origin.x + (c % columns) * chunkSize, origin.y + (c / columns) * chunkSize);
+        overhang = std::max({overhang, cell.x - chunk.left, cell.y - chunk.top,
+                             chunk.left + chunk.width - cell.x - chunkSize,
+                             chunk.top + chunk.height - cell.y - chunkSize});
+    }
+
+    int clampColumn(int x) const { return std::max(0, std::min(columns - 1, x)); }
+    int clampRow(int y) const { return std::max(0, std::min(rows - 1, y)); }
+
+    float distance(sf::Vector2f point, int c) const {
+        const sf::FloatRect& bounds = chunkBounds[c];
+        float dx = std::max({bounds.left - point.x, 0.0f, point.x - bounds.left - bounds.width});
+        float dy = std::max({bounds.top - point.y, 0.0f, point.y - bounds.top - bounds.height});
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    // Calls fn(chunk) for every non-empty chunk whose bounds overlap area
+    template <typename Fn>
+    void forChunks(const sf::FloatRect& area, Fn&& fn) const {
+        if (objects.empty()) return;
+        int minColumn = clampColumn(static_cast<int>(std::floor((area.left - overhang - origin.x) / chunkSize)));
+        int maxColumn = clampColumn(static_cast<int>(std::floor((area.left + area.width + overhang - origin.x) / chunkSize)));
+        int minRow = clampRow(static_cast<int>(std::floor((area.top - overhang - origin.y) / chunkSize)));
+        int maxRow = clampRow(static_cast<int>(std::floor((area.top + area.height + overhang - origin.y) / chunkSize)));
+        for (int row = minRow; row <= maxRow; row++) {
+            for (int column = minColumn; column <= maxColumn; column++) {
+                int c = row * columns + column;
+                if (chunkObjects(c) > 0 && chunkBounds[c].intersects(area)) fn(c);
+            }
+        }
+    }
+
+    // Chunks within radius of point that are not in a slot, nearest first
+    void collectWanted(sf::Vector2f point, float radius) {
+        wanted.clear();
+        sf::FloatRect area(point.x - radius, point.y - radius, 2 * radius, 2 * radius);
+        forChunks(area, [&](int c) {
+            float d = distance(point, c);
+            if (d <= radius && chunkSlot[c] < 0 && wanted.size() < wanted.capacity()) wanted.push_back({c, d});
+        });
+        std::sort(wanted.begin(), wanted.end(), [](const Wanted& a, const Wanted& b) { return a.distance < b.distance; });
+    }
+
+    void request() {
+        for (const Wanted& want : wanted) {
+            int s = claimSlot(want.chunk);
+            if (s < 0) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue[(queueHead + queueCount) % queue.size()] = s;
+                queueCount++;
+            }
+            wake.notify_one();
+        }
+    }
+
+    // A free slot, or the one holding the chunk farthest from the view that
+    // neither the view nor the prefetch still wants; -1 if there is none
+    int claimSlot(int chunk) {
+        int best = -1;
+        float keep = loadRadius + chunkSize / 2; // Hysteresis, so edges do not thrash
+        float bestDistance = keep;
+        for (size_t s = 0; s < slots.size(); s++) {
+            const Slot& slot = slots[s];
+            if (slot.queued) continue;
+            if (slot.chunk < 0) {
+                best = static_cast<int>(s);
+                break;
+            }
+            if (distance(keepAhead, slot.chunk) <= keep) continue;
+            float d = distance(keepCenter, slot.chunk);
+            if (d > bestDistance) {
+                best = static_cast<int>(s);
+                bestDistance = d;
+            }
+        }
+        if (best < 0) return -1;
+
+        Slot& slot = slots[best];
+        if (slot.chunk >= 0) {
+            chunkSlot[slot.chunk] = -1;
+            counters.evictions++;
+        }
+        slot.chunk = chunk;
+        slot.queued = true;
+        slot.resident = false;
+        chunkSlot[chunk] = best;
+        return best;
+    }
+
+    void bake(Slot& slot) const {
+        slot.vertices.clear();
+        for (uint32_t k = chunkFirst[slot.chunk]; k < chunkFirst[slot.chunk + 1]; k++) {
+            uint32_t i = objects[k];
+            if (i < walls->size()) {
+                appendQuad(slot.vertices, (*walls)[i], sf::Color(100, 100, 100), wallTexels);
+            } else {
+                appendQuad(slot.vertices, object(i), sf::Color::White, closetTexels);
+            }
+        }
+        slot.vertexCount = slot.vertices.getVertexCount();
+    }
+
+    void upload(Slot& slot) {
+        if (slot.useBuffer && slot.vertexCount > 0) {
+            slot.buffer.update(&slot.vertices[0], slot.vertexCount, 0);
+        }
+        slot.queued = false;
+        slot.resident = true;
+        counters.loads++;
+    }
+
+    // A few per frame, so a burst of chunks does not stall one frame
+    void uploadBaked() {
+        int ready[uploadsPerFrame];
+        unsigned count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t s = 0; s < slots.size() && count < uploadsPerFrame; s++) {
+                if (slots[s].baked) {
+                    slots[s].baked = false;
+                    ready[count++] = static_cast<int>(s);
+                }
+            }
+        }
+        for (unsigned i = 0; i < count; i++) {
+            upload(slots[ready[i]]);
+        }
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || queueCount > 0; });
+            if (stopping) return;
+            Slot& slot = slots[queue[queueHead]];
+            queueHead = (queueHead + 1) % queue.size();
+            queueCount--;
+            busy = true;
+            lock.unlock();
+            bake(slot);
+            lock.lock();
+            busy = false;
+            slot.baked = true;
+            idle.notify_all();
+        }
+    }
+};